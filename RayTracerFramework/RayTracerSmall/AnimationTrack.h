@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Vec3.h"
+#include "Sphere.h"
+
+//How a keyframe blends into the next keyframe of its track
+enum Interpolation {
+	INTERPOLATION_STEP,
+	INTERPOLATION_LINEAR,
+	INTERPOLATION_CUBIC
+};
+
+//The sphere properties that can be animated
+enum TrackProperty {
+	TRACK_POSITION,
+	TRACK_RADIUS,
+	TRACK_SURFACE_COLOR,
+	TRACK_EMISSION_COLOR,
+	TRACK_TRANSPARENCY,
+	TRACK_REFLECTION,
+	TRACK_COUNT
+};
+
+//Converts the "interpolation" attribute of a keyframe, anything unknown is linear
+inline Interpolation InterpolationFromString(const std::string& name)
+{
+	if (name == "step") return INTERPOLATION_STEP;
+	if (name == "cubic") return INTERPOLATION_CUBIC;
+	return INTERPOLATION_LINEAR;
+}
+
+//Converts a key of the "keyframes" object, returns TRACK_COUNT if the name is unknown
+inline TrackProperty TrackPropertyFromString(const std::string& name)
+{
+	if (name == "position") return TRACK_POSITION;
+	if (name == "radius") return TRACK_RADIUS;
+	if (name == "surfaceColor") return TRACK_SURFACE_COLOR;
+	if (name == "emissionColor" || name == "emmisionColor") return TRACK_EMISSION_COLOR;
+	if (name == "transparency") return TRACK_TRANSPARENCY;
+	if (name == "reflection") return TRACK_REFLECTION;
+	return TRACK_COUNT;
+}
+
+//True for the properties stored as a Vec3f, false for the float ones
+inline bool IsVec3Track(TrackProperty property)
+{
+	return property == TRACK_POSITION || property == TRACK_SURFACE_COLOR || property == TRACK_EMISSION_COLOR;
+}
+
+template<typename T>
+struct Keyframe {
+	float frame;
+	T value;
+	//Interpolation used between this key and the next one
+	Interpolation interpolation;
+};
+
+//A sorted list of keyframes for one property. Evaluate works on any frame in any order, there is no
+//state carried between frames so nothing accumulates over a long sequence.
+template<typename T>
+class AnimationTrack
+{
+public:
+	//Inserts a key keeping the list sorted by frame. A key on an existing frame replaces it
+	void AddKey(float frame, const T& value, Interpolation interpolation = INTERPOLATION_LINEAR)
+	{
+		Keyframe<T> key = { frame, value, interpolation };
+		auto it = std::lower_bound(_keys.begin(), _keys.end(), frame, [](const Keyframe<T>& k, float f) { return k.frame < f; });
+		if (it != _keys.end() && it->frame == frame) *it = key;
+		else _keys.insert(it, key);
+	}
+
+	bool IsEmpty() const { return _keys.empty(); }
+	size_t GetKeyCount() const { return _keys.size(); }
+	const Keyframe<T>& GetKey(size_t index) const { return _keys[index]; }
+
+	//Returns the value of the track at a frame. O(log k) in the number of keys
+	T Evaluate(float frame) const
+	{
+		if (frame <= _keys.front().frame) return _keys.front().value;
+		if (frame >= _keys.back().frame) return _keys.back().value;
+
+		//First key after the frame, the one before it starts the segment we are in
+		size_t next = std::upper_bound(_keys.begin(), _keys.end(), frame, [](float f, const Keyframe<T>& k) { return f < k.frame; }) - _keys.begin();
+		size_t current = next - 1;
+
+		const Keyframe<T>& k1 = _keys[current];
+		const Keyframe<T>& k2 = _keys[next];
+		float t = (frame - k1.frame) / (k2.frame - k1.frame);
+
+		switch (k1.interpolation) {
+		case INTERPOLATION_STEP:
+			return k1.value;
+		case INTERPOLATION_CUBIC:
+			return Cubic(current, next, t);
+		default:
+			return k1.value + (k2.value - k1.value) * t;
+		}
+	}
+
+private:
+	//Cubic hermite spline through k1 and k2. The tangents are catmull-rom tangents scaled for uneven key
+	//spacing. The first and last keys stand in for their missing neighbour, so their tangent is the slope of
+	//the segment they end and the curve leaves them at that speed rather than easing in or out
+	T Cubic(size_t current, size_t next, float t) const
+	{
+		const Keyframe<T>& k1 = _keys[current];
+		const Keyframe<T>& k2 = _keys[next];
+		const Keyframe<T>& k0 = current > 0 ? _keys[current - 1] : k1;
+		const Keyframe<T>& k3 = next + 1 < _keys.size() ? _keys[next + 1] : k2;
+
+		float span = k2.frame - k1.frame;
+		T m1 = k0.frame != k2.frame ? (k2.value - k0.value) * (span / (k2.frame - k0.frame)) : T(0);
+		T m2 = k1.frame != k3.frame ? (k3.value - k1.value) * (span / (k3.frame - k1.frame)) : T(0);
+
+		float t2 = t * t;
+		float t3 = t2 * t;
+		float h00 = 2 * t3 - 3 * t2 + 1;
+		float h10 = t3 - 2 * t2 + t;
+		float h01 = -2 * t3 + 3 * t2;
+		float h11 = t3 - t2;
+
+		return k1.value * h00 + m1 * h10 + k2.value * h01 + m2 * h11;
+	}
+
+	std::vector<Keyframe<T>> _keys;
+};
+
+//All of the tracks for one sphere. Tracks without keys leave the property at its starting value
+struct SphereAnimation {
+	AnimationTrack<Vec3f> position;
+	AnimationTrack<float> radius;
+	AnimationTrack<Vec3f> surfaceColor;
+	AnimationTrack<Vec3f> emissionColor;
+	AnimationTrack<float> transparency;
+	AnimationTrack<float> reflection;
+
+	//Adds a key to one of the tracks. Float tracks only read values[0]
+	void AddKey(TrackProperty property, float frame, const float* values, Interpolation interpolation)
+	{
+		Vec3f vec(values[0], values[1], values[2]);
+		switch (property) {
+		case TRACK_POSITION: position.AddKey(frame, vec, interpolation); break;
+		case TRACK_RADIUS: radius.AddKey(frame, values[0], interpolation); break;
+		case TRACK_SURFACE_COLOR: surfaceColor.AddKey(frame, vec, interpolation); break;
+		case TRACK_EMISSION_COLOR: emissionColor.AddKey(frame, vec, interpolation); break;
+		case TRACK_TRANSPARENCY: transparency.AddKey(frame, values[0], interpolation); break;
+		case TRACK_REFLECTION: reflection.AddKey(frame, values[0], interpolation); break;
+		default: break;
+		}
+	}
+
+	//Writes the animated properties of a frame into a sphere
+	void Apply(float frame, Sphere& sphere) const
+	{
+		if (!position.IsEmpty()) sphere._center = position.Evaluate(frame);
+		if (!radius.IsEmpty()) {
+			sphere._radius = radius.Evaluate(frame);
+			sphere._radiusSqr = sphere._radius * sphere._radius;
+		}
+		if (!surfaceColor.IsEmpty()) sphere._surfaceColor = surfaceColor.Evaluate(frame);
+		if (!emissionColor.IsEmpty()) sphere._emissionColor = emissionColor.Evaluate(frame);
+		if (!transparency.IsEmpty()) sphere._transparency = transparency.Evaluate(frame);
+		if (!reflection.IsEmpty()) sphere._reflection = reflection.Evaluate(frame);
+	}
+};
@@ -0,0 +1,131 @@
+#include "SelfTest.h"
+#include "AnimationTrack.h"
+#include "JSONReader.h"
+#include <cmath>
+
+static bool Near(float a, float b)
+{
+	return std::fabs(a - b) < 1e-4f;
+}
+
+void SelfTest::TestAnimationTrack()
+{
+	//Keys added out of order are sorted, and a key on an existing frame replaces it
+	{
+		AnimationTrack<float> track;
+		track.AddKey(10.0f, 5.0f);
+		track.AddKey(0.0f, 1.0f);
+		track.AddKey(10.0f, 10.0f);
+		SELF_CHECK(track.GetKeyCount() == 2);
+		SELF_CHECK(track.GetKey(0).frame == 0.0f && track.GetKey(1).value == 10.0f);
+	}
+
+	//Step holds the key's value until the next key
+	{
+		AnimationTrack<float> track;
+		track.AddKey(0.0f, 1.0f, INTERPOLATION_STEP);
+		track.AddKey(10.0f, 5.0f, INTERPOLATION_STEP);
+		SELF_CHECK(track.Evaluate(0.0f) == 1.0f);
+		SELF_CHECK(track.Evaluate(9.9f) == 1.0f);
+		SELF_CHECK(track.Evaluate(10.0f) == 5.0f);
+	}
+
+	//Linear, on a float and a Vec3f track
+	{
+		AnimationTrack<float> track;
+		track.AddKey(0.0f, 0.0f);
+		track.AddKey(10.0f, 10.0f);
+		track.AddKey(20.0f, 0.0f);
+		SELF_CHECK(Near(track.Evaluate(2.5f), 2.5f));
+		SELF_CHECK(Near(track.Evaluate(15.0f), 5.0f));
+
+		AnimationTrack<Vec3f> position;
+		position.AddKey(0.0f, Vec3f(0.0f, 2.0f, -20.0f));
+		position.AddKey(4.0f, Vec3f(8.0f, 2.0f, -40.0f));
+		Vec3f halfway = position.Evaluate(2.0f);
+		SELF_CHECK(Near(halfway.x, 4.0f) && Near(halfway.y, 2.0f) && Near(halfway.z, -30.0f));
+	}
+
+	//The interpolation of the key at the start of a segment is the one used for it
+	{
+		AnimationTrack<float> track;
+		track.AddKey(0.0f, 0.0f, INTERPOLATION_LINEAR);
+		track.AddKey(10.0f, 10.0f, INTERPOLATION_STEP);
+		track.AddKey(20.0f, 0.0f);
+		SELF_CHECK(Near(track.Evaluate(5.0f), 5.0f));
+		SELF_CHECK(track.Evaluate(15.0f) == 10.0f);
+	}
+
+	//Cubic passes through its keys, keys on a line give the line, and two keys alone give a straight segment
+	//because the end keys' tangents are the slope of their segment
+	{
+		AnimationTrack<float> line;
+		line.AddKey(0.0f, 0.0f, INTERPOLATION_CUBIC);
+		line.AddKey(10.0f, 10.0f, INTERPOLATION_CUBIC);
+		line.AddKey(30.0f, 30.0f, INTERPOLATION_CUBIC);
+		SELF_CHECK(Near(line.Evaluate(5.0f), 5.0f));
+		SELF_CHECK(Near(line.Evaluate(10.0f), 10.0f));
+		SELF_CHECK(Near(line.Evaluate(22.5f), 22.5f));
+
+		AnimationTrack<float> segment;
+		segment.AddKey(0.0f, 2.0f, INTERPOLATION_CUBIC);
+		segment.AddKey(8.0f, 6.0f, INTERPOLATION_CUBIC);
+		SELF_CHECK(Near(segment.Evaluate(2.0f), 3.0f));
+
+		//Tangent of 10 at the first key and 0 at the peak: h10 * 10 + h01 * 10 = 0.125 * 10 + 0.5 * 10
+		AnimationTrack<float> peak;
+		peak.AddKey(0.0f, 0.0f, INTERPOLATION_CUBIC);
+		peak.AddKey(10.0f, 10.0f, INTERPOLATION_CUBIC);
+		peak.AddKey(20.0f, 0.0f, INTERPOLATION_CUBIC);
+		SELF_CHECK(Near(peak.Evaluate(5.0f), 6.25f));
+		SELF_CHECK(Near(peak.Evaluate(10.0f), 10.0f));
+		SELF_CHECK(Near(peak.Evaluate(15.0f), 6.25f));
+	}
+
+	//Frames before the first key and after the last one hold the end values
+	{
+		AnimationTrack<float> track;
+		track.AddKey(2.0f, 3.0f, INTERPOLATION_CUBIC);
+		track.AddKey(6.0f, 7.0f, INTERPOLATION_CUBIC);
+		SELF_CHECK(track.Evaluate(-5.0f) == 3.0f);
+		SELF_CHECK(track.Evaluate(100.0f) == 7.0f);
+
+		AnimationTrack<float> single;
+		single.AddKey(4.0f, 1.5f);
+		SELF_CHECK(single.Evaluate(0.0f) == 1.5f && single.Evaluate(9.0f) == 1.5f);
+	}
+
+	//Scenes with only start and end values start the tracks at frame -1, so frame 0 has already moved one step
+	//and the last frame is at the end value, the same as adding the old per frame deltas before each frame
+	{
+		JSONSphereInfo info(1, 4);
+		info.sphereArr[0]._center = Vec3f(0.0f, 0.0f, -20.0f);
+		info.sphereArr[0]._surfaceColor = Vec3f(1.0f, 0.0f, 0.0f);
+		info.sphereEndPositions[0] = Vec3f(8.0f, 0.0f, -20.0f);
+		info.sphereEndColor[0] = Vec3f(0.0f, 0.0f, 1.0f);
+		info.CalculateSphereMovements();
+		info.CalculateSphereColor();
+		info.BuildLegacyTracks();
+
+		Sphere sphere;
+		bool matchesDeltas = true;
+		Vec3f center = info.sphereArr[0]._center;
+		Vec3f color = info.sphereArr[0]._surfaceColor;
+		for (int frame = 0; frame < info.frameCount; ++frame) {
+			center = center + info.sphereMovementsPerFrame[0];
+			color = color + info.sphereColorPerFrame[0];
+			info.EvaluateFrame(frame, &sphere);
+			matchesDeltas = matchesDeltas && Near(sphere._center.x, center.x) && Near(sphere._surfaceColor.x, color.x) && Near(sphere._surfaceColor.z, color.z);
+		}
+		SELF_CHECK(matchesDeltas);
+
+		info.EvaluateFrame(0, &sphere);
+		SELF_CHECK(Near(sphere._center.x, 2.0f));
+		info.EvaluateFrame(3, &sphere);
+		SELF_CHECK(Near(sphere._center.x, 8.0f) && Near(sphere._surfaceColor.z, 1.0f));
+		//Past the last frame the sphere stays at its end position
+		info.EvaluateFrame(10, &sphere);
+		SELF_CHECK(Near(sphere._center.x, 8.0f));
+		info.Cleanup();
+	}
+}
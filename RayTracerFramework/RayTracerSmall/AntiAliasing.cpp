@@ -0,0 +1,82 @@
+#include "AntiAliasing.h"
+#include <algorithm>
+#include <cmath>
+
+Vec3f AntiAliasing::Clamp(const Vec3f& color)
+{
+	return Vec3f(std::min(color.x, 1.0f), std::min(color.y, 1.0f), std::min(color.z, 1.0f));
+}
+
+float AntiAliasing::Contrast(const Vec3f& a, const Vec3f& b)
+{
+	Vec3f ca = Clamp(a);
+	Vec3f cb = Clamp(b);
+	return std::max(std::fabs(ca.x - cb.x), std::max(std::fabs(ca.y - cb.y), std::fabs(ca.z - cb.z)));
+}
+
+float AntiAliasing::EdgeScore(const RenderConfig& config, const Vec3f& a, int idA, const Vec3f& b, int idB)
+{
+	float contrast = Contrast(a, b);
+	if (idA != idB) return 1.0f + contrast;
+	return contrast > config.aaThreshold ? contrast : 0.0f;
+}
+
+void AntiAliasing::FindEdges(const RenderConfig& config, const Vec3f* const* rows, const int* const* ids, unsigned startY, unsigned endY, std::vector<int>& pixels)
+{
+	pixels.clear();
+	const unsigned width = config.width;
+
+	//Scores of one row of tiles, 0 for pixels that are not edges
+	std::vector<float> scores((size_t)AA_TILE_SIZE * width);
+	std::vector<int> tileEdges;
+	for (unsigned tileY = startY; tileY < endY; ) {
+		//Rows of tiles start on multiples of the tile size, the first and last are cut short by startY and endY
+		const unsigned tileEndY = std::min(endY, (tileY / AA_TILE_SIZE + 1) * AA_TILE_SIZE);
+
+		for (unsigned y = tileY; y < tileEndY; ++y) {
+			const Vec3f* row = rows[y];
+			const int* rowIds = ids[y];
+			//Neighbours in rows that are outside the frame or not available are left out
+			const Vec3f* above = y > 0 ? rows[y - 1] : nullptr;
+			const int* aboveIds = y > 0 ? ids[y - 1] : nullptr;
+			const Vec3f* below = y + 1 < config.height ? rows[y + 1] : nullptr;
+			const int* belowIds = y + 1 < config.height ? ids[y + 1] : nullptr;
+			float* rowScores = &scores[(size_t)(y - tileY) * width];
+			for (unsigned x = 0; x < width; ++x) {
+				float score = 0.0f;
+				if (x > 0) score = std::max(score, EdgeScore(config, row[x], rowIds[x], row[x - 1], rowIds[x - 1]));
+				if (x + 1 < width) score = std::max(score, EdgeScore(config, row[x], rowIds[x], row[x + 1], rowIds[x + 1]));
+				if (above != nullptr) score = std::max(score, EdgeScore(config, row[x], rowIds[x], above[x], aboveIds[x]));
+				if (below != nullptr) score = std::max(score, EdgeScore(config, row[x], rowIds[x], below[x], belowIds[x]));
+				rowScores[x] = score;
+			}
+		}
+
+		for (unsigned tileX = 0; tileX < width; tileX += AA_TILE_SIZE) {
+			const unsigned tileEndX = std::min(width, tileX + AA_TILE_SIZE);
+			const int budget = (int)(config.aaBudget * (tileEndX - tileX) * (tileEndY - tileY));
+			if (budget <= 0) continue;
+
+			//Indices into the scores of the row of tiles
+			tileEdges.clear();
+			for (unsigned y = tileY; y < tileEndY; ++y) {
+				for (unsigned x = tileX; x < tileEndX; ++x) {
+					int s = (int)((y - tileY) * width + x);
+					if (scores[s] > 0.0f) tileEdges.push_back(s);
+				}
+			}
+
+			if ((int)tileEdges.size() > budget) {
+				std::nth_element(tileEdges.begin(), tileEdges.begin() + budget, tileEdges.end(),
+					[&scores](int a, int b) { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); });
+				tileEdges.resize(budget);
+			}
+			for (int s : tileEdges) pixels.push_back((int)(tileY * width) + s);
+		}
+
+		tileY = tileEndY;
+	}
+
+	//Back into memory order for the tracing pass
+	std::sort(pixels.begin(), pixels.end());
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include "RenderConfig.h"
+
+//Side of the square tiles of the frame the supersampling budget is shared out over. The tiles are fixed to the
+//frame, so the pixels picked do not depend on how the rows were split between workers
+#define AA_TILE_SIZE 16
+
+//Finds the pixels of a frame that are worth more than one sample. A pixel is an edge if a neighbour's
+//primary ray hit a different object or the two colours differ by more than config.aaThreshold
+class AntiAliasing
+{
+public:
+	//rows[y] and ids[y] are row y of the frame's colours and the objects hit through each pixel (-1 for the
+	//background), nullptr for rows that are not available. Searches rows startY to endY, comparing their pixels
+	//with neighbours above and below them too, and fills pixels with the frame indices to supersample in
+	//ascending order. Each AA_TILE_SIZE tile gets at most config.aaBudget of its pixels, object edges are kept
+	//over contrast edges when the budget runs out, then the highest contrast, then the first in memory order
+	static void FindEdges(const RenderConfig& config, const Vec3f* const* rows, const int* const* ids, unsigned startY, unsigned endY, std::vector<int>& pixels);
+
+	//Offset inside the pixel of sample i along one side of the n x n grid
+	static float GridOffset(int i, int n) { return (i + 0.5f) / n; }
+
+	//Colours are clamped before they are averaged, the same as when they are written out, so a
+	//bright background sample does not bleed further into an edge than it would on screen
+	static Vec3f Clamp(const Vec3f& color);
+
+private:
+	static float Contrast(const Vec3f& a, const Vec3f& b);
+	//0 if the pair is not an edge, above 1 if it is an object edge, otherwise their contrast
+	static float EdgeScore(const RenderConfig& config, const Vec3f& a, int idA, const Vec3f& b, int idB);
+};
@@ -0,0 +1,130 @@
+#include "SelfTest.h"
+#include "AntiAliasing.h"
+#include <algorithm>
+
+//A frame in one buffer with the row tables FindEdges reads
+struct TestFrame {
+	unsigned width;
+	unsigned height;
+	std::vector<Vec3f> colors;
+	std::vector<int> ids;
+	std::vector<const Vec3f*> rows;
+	std::vector<const int*> rowIds;
+
+	TestFrame(unsigned w, unsigned h) : width(w), height(h), colors((size_t)w * h), ids((size_t)w * h, 0), rows(h), rowIds(h)
+	{
+		for (unsigned y = 0; y < h; ++y) {
+			rows[y] = &colors[(size_t)y * w];
+			rowIds[y] = &ids[(size_t)y * w];
+		}
+	}
+
+	//Black and white squares of the given size, every border between them is a contrast edge
+	void Checker(unsigned size)
+	{
+		for (unsigned y = 0; y < height; ++y) {
+			for (unsigned x = 0; x < width; ++x) colors[(size_t)y * width + x] = Vec3f((x / size + y / size) % 2 == 0 ? 1.0f : 0.0f);
+		}
+	}
+};
+
+static std::vector<int> Edges(const RenderConfig& config, const TestFrame& frame, unsigned startY, unsigned endY)
+{
+	std::vector<int> pixels;
+	AntiAliasing::FindEdges(config, frame.rows.data(), frame.rowIds.data(), startY, endY, pixels);
+	return pixels;
+}
+
+static bool Sorted(const std::vector<int>& pixels)
+{
+	return std::adjacent_find(pixels.begin(), pixels.end(), [](int a, int b) { return a >= b; }) == pixels.end();
+}
+
+void SelfTest::TestAntiAliasing()
+{
+	RenderConfig config(AA_TILE_SIZE * 2, AA_TILE_SIZE * 2, 1);
+	config.aaBudget = 0.1f;
+	config.aaThreshold = 0.2f;
+	const int tileBudget = (int)(config.aaBudget * AA_TILE_SIZE * AA_TILE_SIZE);
+
+	//A flat frame has no edges
+	{
+		TestFrame frame(config.width, config.height);
+		SELF_CHECK(Edges(config, frame, 0, config.height).empty());
+	}
+
+	//Every pixel is an edge, each tile stops at its budget and the indices come back in memory order
+	{
+		TestFrame frame(config.width, config.height);
+		frame.Checker(1);
+		std::vector<int> pixels = Edges(config, frame, 0, config.height);
+		SELF_CHECK((int)pixels.size() == tileBudget * 4);
+		SELF_CHECK(Sorted(pixels));
+		std::vector<int> firstTile;
+		for (int p : pixels) if (p % config.width < AA_TILE_SIZE && p / config.width < AA_TILE_SIZE) firstTile.push_back(p);
+		SELF_CHECK((int)firstTile.size() == tileBudget);
+		//The scores are all the same, so the first tile keeps its first row and the start of its second
+		bool firstInMemoryOrder = (int)firstTile.size() == tileBudget;
+		for (int i = 0; firstInMemoryOrder && i < tileBudget; ++i) {
+			int expected = i < AA_TILE_SIZE ? i : (int)config.width + i - AA_TILE_SIZE;
+			firstInMemoryOrder = firstTile[i] == expected;
+		}
+		SELF_CHECK(firstInMemoryOrder);
+
+		//No budget, no edges
+		RenderConfig noBudget = config;
+		noBudget.aaBudget = 0.0f;
+		SELF_CHECK(Edges(noBudget, frame, 0, config.height).empty());
+	}
+
+	//Object edges are kept over contrast edges when the budget runs out, even when those have more contrast
+	{
+		TestFrame frame(config.width, config.height);
+		frame.Checker(1);
+		for (unsigned y = 0; y < config.height; ++y) {
+			for (unsigned x = 0; x < config.width; ++x) frame.ids[(size_t)y * config.width + x] = x < 4 ? 1 : 2;
+		}
+		std::vector<int> pixels = Edges(config, frame, 0, AA_TILE_SIZE);
+		//The object edge runs between columns 3 and 4 of the first tile, 32 pixels for its budget of 25
+		SELF_CHECK((int)pixels.size() == tileBudget * 2);
+		bool onObjectEdge = true;
+		for (int p : pixels) {
+			unsigned x = p % config.width;
+			if (x < AA_TILE_SIZE) onObjectEdge = onObjectEdge && (x == 3 || x == 4);
+		}
+		SELF_CHECK(onObjectEdge);
+	}
+
+	//Contrast below the threshold is not an edge
+	{
+		TestFrame frame(config.width, config.height);
+		for (unsigned y = 0; y < config.height; ++y) frame.colors[(size_t)y * config.width + 5] = Vec3f(0.1f);
+		SELF_CHECK(Edges(config, frame, 0, config.height).empty());
+		frame.colors[5] = Vec3f(0.5f);
+		SELF_CHECK(Edges(config, frame, 0, config.height).size() == 4);
+	}
+
+	//Searching the frame a row of tiles at a time finds the same edges as searching it whole, the rows either
+	//side of a part are still compared
+	{
+		TestFrame frame(config.width, config.height);
+		frame.Checker(3);
+		std::vector<int> whole = Edges(config, frame, 0, config.height);
+		std::vector<int> parts = Edges(config, frame, 0, AA_TILE_SIZE);
+		std::vector<int> lower = Edges(config, frame, AA_TILE_SIZE, config.height);
+		parts.insert(parts.end(), lower.begin(), lower.end());
+		SELF_CHECK((int)whole.size() == tileBudget * 4);
+		SELF_CHECK(Sorted(whole));
+		SELF_CHECK(parts == whole);
+	}
+
+	//A row that is not available is left out of the comparisons, an edge against it is not found
+	{
+		TestFrame frame(config.width, config.height);
+		for (unsigned x = 0; x < config.width; ++x) frame.colors[(size_t)AA_TILE_SIZE * config.width + x] = Vec3f(1.0f);
+		SELF_CHECK(Edges(config, frame, 0, AA_TILE_SIZE).size() == config.width);
+		frame.rows[AA_TILE_SIZE] = nullptr;
+		frame.rowIds[AA_TILE_SIZE] = nullptr;
+		SELF_CHECK(Edges(config, frame, 0, AA_TILE_SIZE).empty());
+	}
+}
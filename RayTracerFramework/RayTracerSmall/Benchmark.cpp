@@ -0,0 +1,567 @@
+#include "Benchmark.h"
+#include "BinaryScene.h"
+#include "HeapManager.h"
+#include "JSONReader.h"
+#include "MemoryManager.h"
+#include "MemoryPool.h"
+#include "PerfCounters.h"
+#include "RayTable.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+//Random float between min and max, rand is seeded by main so the scenes are the same each run
+static float RandomRange(float min, float max)
+{
+	return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+//Sums every value the renderer uses so two loaders can be checked against each other
+static double Checksum(const JSONSphereInfo& info)
+{
+	double sum = info.frameCount;
+	for (int i = 0; i < info.sphereCount; ++i) {
+		const Sphere& s = info.sphereArr[i];
+		sum += s._center.x + s._center.y + s._center.z + s._radius + s._reflection + s._transparency;
+		sum += s._surfaceColor.x + s._surfaceColor.y + s._surfaceColor.z;
+		sum += s._emissionColor.x + s._emissionColor.y + s._emissionColor.z;
+		sum += info.sphereMovementsPerFrame[i].x + info.sphereMovementsPerFrame[i].y + info.sphereMovementsPerFrame[i].z;
+		sum += info.sphereColorPerFrame[i].x + info.sphereColorPerFrame[i].y + info.sphereColorPerFrame[i].z;
+	}
+	return sum;
+}
+
+void Benchmark::WriteSceneFile(const std::string& path, int sphereCount, int frameCount)
+{
+	std::ofstream ofs(path, std::ios::out);
+	ofs << "{\n  \"frameCount\": " << frameCount << ",\n  \"sphereCount\": " << sphereCount << ",\n  \"spheres\": [\n";
+
+	for (int i = 0; i < sphereCount; ++i) {
+		float x = RandomRange(-50.0f, 50.0f);
+		float y = RandomRange(-40.0f, 40.0f);
+		float z = RandomRange(-200.0f, -60.0f);
+		ofs << "    {\n";
+		ofs << "      \"startPos\": [ " << x << ", " << y << ", " << z << " ],\n";
+		ofs << "      \"endPos\": [ " << x + RandomRange(-10.0f, 10.0f) << ", " << y << ", " << z << " ],\n";
+		ofs << "      \"radius\": " << RandomRange(0.2f, 2.0f) << ",\n";
+		ofs << "      \"surfaceColor\": [ " << RandomRange(0.0f, 1.0f) << ", " << RandomRange(0.0f, 1.0f) << ", " << RandomRange(0.0f, 1.0f) << " ],\n";
+		ofs << "      \"reflection\": " << RandomRange(0.0f, 1.0f) << ",\n";
+		ofs << "      \"transparency\": " << RandomRange(0.0f, 1.0f) << ",\n";
+		ofs << "      \"emmisionColor\": [ 0.0, 0.0, 0.0 ],\n";
+		ofs << "      \"endSurfaceColor\": [ " << RandomRange(0.0f, 1.0f) << ", " << RandomRange(0.0f, 1.0f) << ", " << RandomRange(0.0f, 1.0f) << " ]\n";
+		ofs << (i + 1 < sphereCount ? "    },\n" : "    }\n");
+	}
+
+	ofs << "  ],\n  \"version\": \"1.0\"\n}\n";
+	ofs.close();
+}
+
+void Benchmark::SceneLoading(const std::vector<int>& sphereCounts)
+{
+	Heap& defaultHeap = HeapManager::GetDefaultHeap();
+
+	std::cout << std::left << std::setw(10) << "SPHERES" << std::setw(10) << "LOADER"
+		<< std::right << std::setw(12) << "TIME (ms)" << std::setw(16) << "PEAK HEAP (MB)" << std::setw(16) << "CHECKSUM" << std::endl;
+
+	for (int sphereCount : sphereCounts) {
+		std::string jsonPath = "bench_" + std::to_string(sphereCount) + ".json";
+		std::string binaryPath = "bench_" + std::to_string(sphereCount) + ".rtscene";
+		WriteSceneFile(jsonPath, sphereCount, 200);
+
+		for (int loader = 0; loader < 4; ++loader) {
+			const char* loaderName = "";
+			long long baseMemory = defaultHeap.GetAmountAllocated();
+			defaultHeap.ResetPeak();
+
+			Timer timer;
+			JSONSphereInfo* info = nullptr;
+			BinaryScene* scene = nullptr;
+
+			switch (loader) {
+			case 0:
+				loaderName = "DOM";
+				info = JSONReader::LoadSphereInfoFromFile(jsonPath.c_str());
+				break;
+			case 1:
+				loaderName = "SAX";
+				info = JSONReader::StreamSphereInfoFromFile(jsonPath.c_str());
+				break;
+			case 2:
+				//Opening the mapping only, the arrays are usable in place from here
+				loaderName = "MMAP";
+				scene = BinaryScene::Open(binaryPath.c_str());
+				break;
+			case 3:
+				//Mapping and expanding the arrays into the structures the renderer uses
+				loaderName = "BINARY";
+				scene = BinaryScene::Open(binaryPath.c_str());
+				if (scene != nullptr) info = scene->CreateSphereInfo();
+				break;
+			}
+
+			float time = timer.Peek();
+			double peakMB = (double)(defaultHeap.GetPeak() - baseMemory) / (1024.0 * 1024.0);
+
+			//The json loaders and the expanded binary scene give sphere info, the mapping alone only the scene
+			if (loader == 2 ? scene == nullptr : info == nullptr) {
+				std::cout << "[ERROR: Benchmark.cpp: the " << loaderName << " loader could not load the " << sphereCount << " sphere scene" << std::endl;
+				if (info != nullptr) {
+					info->Cleanup();
+					delete info;
+				}
+				delete scene;
+				continue;
+			}
+
+			//Compile the binary scene once the streaming load has been measured
+			if (loader == 1) BinaryScene::Write(*info, binaryPath.c_str());
+
+			std::cout << std::left << std::setw(10) << sphereCount << std::setw(10) << loaderName
+				<< std::right << std::fixed << std::setprecision(2) << std::setw(12) << time * 1000.0f << std::setw(16) << peakMB;
+			if (info != nullptr) std::cout << std::setw(16) << std::setprecision(1) << Checksum(*info);
+			std::cout << std::defaultfloat << std::endl;
+
+			if (info != nullptr) {
+				info->Cleanup();
+				delete info;
+			}
+			delete scene;
+		}
+
+		remove(jsonPath.c_str());
+		remove(binaryPath.c_str());
+	}
+}
+
+void Benchmark::TraceThroughput(const RenderConfig& config, const Scene& scene, TraceFunction trace)
+{
+	//Best of several runs, the first one also warms the caches
+	const int runs = 5;
+	const double rays = (double)config.width * config.height;
+
+	std::cout << "Trace throughput, Vec3f: " << VEC3_SIMD_NAME << ", math: " << GetMathModeName(config.mathMode) << ", " << config.width << "x" << config.height
+		<< ", " << scene.sphereCount << " spheres, " << scene.planeCount << " planes, max depth " << config.rayLimits.maxDepth << "\n\n";
+	std::cout << std::left << std::setw(8) << "RUN" << std::right << std::setw(14) << "TIME (ms)" << std::setw(14) << "MRAYS/S" << std::setw(18) << "CHECKSUM" << "\n";
+
+	double bestSeconds = 0.0;
+	for (int run = 0; run < runs; ++run) {
+		double checksum = 0.0;
+		Timer timer;
+		for (unsigned y = 0; y < config.height; ++y) {
+			const RowRays rays(config, y);
+			for (unsigned x = 0; x < config.width; ++x) {
+				Vec3f raydir = rays.Direction(x);
+				Normalize(config.mathMode, raydir);
+				Vec3f color = trace(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f);
+				//Summing the colors keeps the compiler from dropping the work and shows whether two builds agree
+				checksum += color.x + color.y + color.z;
+			}
+		}
+		double seconds = timer.Mark();
+		if (run == 0 || seconds < bestSeconds) bestSeconds = seconds;
+
+		std::cout << std::left << std::setw(8) << run << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(14) << seconds * 1000.0 << std::setw(14) << rays / seconds / 1e6
+			<< std::setw(18) << std::setprecision(4) << checksum << std::defaultfloat << "\n";
+	}
+
+	std::cout << "\nBest: " << std::fixed << std::setprecision(2) << rays / bestSeconds / 1e6 << " Mrays/s" << std::defaultfloat << std::endl;
+}
+
+float Benchmark::TraceFrame(const RenderConfig& config, MathMode mode, const Scene& scene, TraceFunction trace, unsigned char* pixels)
+{
+	Timer timer;
+	size_t index = 0;
+	for (unsigned y = 0; y < config.height; ++y) {
+		const RowRays rays(config, y);
+		for (unsigned x = 0; x < config.width; ++x) {
+			Vec3f raydir = rays.Direction(x);
+			Normalize(mode, raydir);
+			Vec3f color = trace(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f);
+
+			//Same conversion as WriteSector so the comparison is of what ends up in the file
+			pixels[index++] = (unsigned char)((1.0f < color.x ? 1.0f : color.x) * 255);
+			pixels[index++] = (unsigned char)((1.0f < color.y ? 1.0f : color.y) * 255);
+			pixels[index++] = (unsigned char)((1.0f < color.z ? 1.0f : color.z) * 255);
+		}
+	}
+	return timer.Mark();
+}
+
+void Benchmark::MathModes(const RenderConfig& config, const Scene& scene, const TraceFunction* traces)
+{
+	const size_t byteCount = (size_t)config.width * config.height * 3;
+	unsigned char* exactPixels = new unsigned char[byteCount];
+	unsigned char* pixels = new unsigned char[byteCount];
+
+	std::cout << "Math modes, Vec3f: " << VEC3_SIMD_NAME << ", " << config.width << "x" << config.height
+		<< ", " << scene.sphereCount << " spheres, " << scene.planeCount << " planes, max depth " << config.rayLimits.maxDepth << "\n\n";
+	std::cout << std::left << std::setw(10) << "MODE" << std::right << std::setw(14) << "TIME (ms)" << std::setw(12) << "SPEEDUP"
+		<< std::setw(12) << "PSNR (dB)" << std::setw(12) << "MAX DIFF" << std::setw(16) << "PIXELS DIFF %" << "\n";
+
+	float exactSeconds = 0.0f;
+	for (int m = 0; m < MATH_MODE_COUNT; ++m) {
+		MathMode mode = (MathMode)m;
+		unsigned char* target = mode == MATH_EXACT ? exactPixels : pixels;
+
+		//Best of three so a context switch does not decide the result
+		float seconds = 0.0f;
+		for (int run = 0; run < 3; ++run) {
+			float runSeconds = TraceFrame(config, mode, scene, traces[m], target);
+			if (run == 0 || runSeconds < seconds) seconds = runSeconds;
+		}
+		if (mode == MATH_EXACT) exactSeconds = seconds;
+
+		std::cout << std::left << std::setw(10) << GetMathModeName(mode) << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(14) << seconds * 1000.0f << std::setw(12) << exactSeconds / seconds;
+		PrintDifference(target, exactPixels, byteCount);
+
+		std::string path = std::string("math_") + GetMathModeName(mode) + ".ppm";
+		std::ofstream ofs(path, std::ios::out | std::ios::binary);
+		ofs << "P6\n" << config.width << " " << config.height << "\n255\n";
+		ofs.write((const char*)target, byteCount);
+	}
+	std::cout << std::endl;
+
+	delete[] exactPixels;
+	delete[] pixels;
+}
+
+void Benchmark::PrintDifference(const unsigned char* pixels, const unsigned char* reference, size_t byteCount)
+{
+	//Difference against the reference frame, over every channel
+	double squaredError = 0.0;
+	int maxDiff = 0;
+	size_t pixelsDiffering = 0;
+	for (size_t i = 0; i < byteCount; i += 3) {
+		bool differs = false;
+		for (size_t c = i; c < i + 3; ++c) {
+			int diff = std::abs((int)pixels[c] - (int)reference[c]);
+			squaredError += (double)diff * diff;
+			if (diff > maxDiff) maxDiff = diff;
+			if (diff != 0) differs = true;
+		}
+		if (differs) pixelsDiffering++;
+	}
+	double mse = squaredError / byteCount;
+
+	std::cout << std::right << std::fixed << std::setprecision(2);
+	if (mse == 0.0) std::cout << std::setw(12) << "inf";
+	else std::cout << std::setw(12) << 10.0 * log10(255.0 * 255.0 / mse);
+	std::cout << std::setw(12) << maxDiff << std::setw(16) << 100.0 * pixelsDiffering / (byteCount / 3) << std::defaultfloat << "\n";
+}
+
+void Benchmark::RayTermination(const RenderConfig& config, const Scene& scene, TraceFunction trace)
+{
+	const size_t byteCount = (size_t)config.width * config.height * 3;
+	unsigned char* fullPixels = new unsigned char[byteCount];
+	unsigned char* pixels = new unsigned char[byteCount];
+	const float thresholds[] = { 0.01f, 0.05f, 0.1f, 0.2f };
+
+	std::cout << "Ray termination, math: " << GetMathModeName(config.mathMode) << ", " << config.width << "x" << config.height
+		<< ", " << scene.sphereCount << " spheres, " << scene.planeCount << " planes, max depth " << config.rayLimits.maxDepth << "\n\n";
+	std::cout << std::left << std::setw(12) << "CUTOFF" << std::setw(10) << "ROULETTE" << std::right << std::setw(14) << "TIME (ms)" << std::setw(12) << "SPEEDUP"
+		<< std::setw(12) << "PSNR (dB)" << std::setw(12) << "MAX DIFF" << std::setw(16) << "PIXELS DIFF %" << "\n";
+
+	//Full depth first, then each threshold as a plain cutoff and with russian roulette
+	float fullSeconds = 0.0f;
+	const int runCount = 1 + 2 * (int)(sizeof(thresholds) / sizeof(thresholds[0]));
+	for (int r = 0; r < runCount; ++r) {
+		RenderConfig runConfig = config;
+		runConfig.rayLimits.minThroughput = r == 0 ? 0.0f : thresholds[(r - 1) / 2];
+		runConfig.rayLimits.russianRoulette = r != 0 && (r - 1) % 2 == 1;
+		unsigned char* target = r == 0 ? fullPixels : pixels;
+
+		//Best of three so a context switch does not decide the result
+		float seconds = 0.0f;
+		for (int run = 0; run < 3; ++run) {
+			float runSeconds = TraceFrame(runConfig, config.mathMode, scene, trace, target);
+			if (run == 0 || runSeconds < seconds) seconds = runSeconds;
+		}
+		if (r == 0) fullSeconds = seconds;
+
+		std::cout << std::left << std::setw(12) << (r == 0 ? std::string("none") : std::to_string(runConfig.rayLimits.minThroughput).substr(0, 4))
+			<< std::setw(10) << (runConfig.rayLimits.russianRoulette ? "on" : "off")
+			<< std::right << std::fixed << std::setprecision(2) << std::setw(14) << seconds * 1000.0f << std::setw(12) << fullSeconds / seconds;
+		PrintDifference(target, fullPixels, byteCount);
+	}
+	std::cout << std::endl;
+
+	delete[] fullPixels;
+	delete[] pixels;
+}
+
+//Keeps the reads of the loop and page benchmarks from being optimised away
+static volatile float benchmarkSink = 0.0f;
+
+void Benchmark::RenderLoops(const RenderConfig& config, const Scene& scene, SectorFunction render)
+{
+	const int runs = 3;
+	const size_t pixelCount = (size_t)config.width * config.height;
+	const double rays = (double)pixelCount;
+
+	std::cout << "Render loops, math: " << GetMathModeName(config.mathMode) << ", " << config.width << "x" << config.height
+		<< ", " << scene.sphereCount << " spheres, " << scene.planeCount << " planes\n\n";
+	std::cout << std::left << std::setw(12) << "LAYOUT" << std::setw(14) << "SCHEDULE" << std::right << std::setw(14) << "TIME (ms)"
+		<< std::setw(14) << "MRAYS/S" << std::setw(12) << "SAME" << "\n";
+
+	//Primary rays alone, the part of the loop the layouts share that RowRays replaced
+	for (int rowRays = 0; rowRays < 2; ++rowRays) {
+		float best = 0.0f;
+		float sum = 0.0f;
+		for (int run = 0; run < runs; ++run) {
+			Timer timer;
+			for (unsigned y = 0; y < config.height; ++y) {
+				const RowRays row(config, y);
+				for (unsigned x = 0; x < config.width; ++x) {
+					Vec3f raydir;
+					if (rowRays) {
+						raydir = row.Direction(x);
+					}
+					else {
+						float xx = (2 * ((x + 0.5) * config.invWidth) - 1) * config.angle * config.aspectRatio;
+						float yy = (1 - 2 * ((y + 0.5) * config.invHeight)) * config.angle;
+						raydir = Vec3f(xx, yy, -1);
+					}
+					Normalize(config.mathMode, raydir);
+					sum += raydir.x;
+				}
+			}
+			float seconds = timer.Mark();
+			if (run == 0 || seconds < best) best = seconds;
+		}
+		benchmarkSink = benchmarkSink + sum;
+		std::cout << std::left << std::setw(12) << "rays only" << std::setw(14) << (rowRays ? "RowRays" : "per pixel") << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(14) << best * 1000.0f << std::setw(14) << rays / best / 1e6 << std::setw(12) << "-" << std::defaultfloat << "\n";
+	}
+
+	//Both layouts are given the whole frame from row 0, so their buffers line up
+	Vec3f* reference = new Vec3f[pixelCount];
+	Vec3f* image = new Vec3f[pixelCount];
+	int* ids = new int[pixelCount];
+	const ContainerMode layouts[] = { CONTAINERS_MULTIPLE, CONTAINERS_SINGULAR };
+#if defined _WIN32
+	const int scheduleCount = 2;
+#else
+	//parallel_for needs the windows concurrency runtime
+	const int scheduleCount = 1;
+#endif
+	for (int l = 0; l < 2; ++l) {
+		for (int schedule = 0; schedule < scheduleCount; ++schedule) {
+			RenderConfig loopConfig = config;
+			loopConfig.containerMode = layouts[l];
+			loopConfig.useParallelFor = schedule == 1;
+			Vec3f* target = l == 0 && schedule == 0 ? reference : image;
+
+			float best = 0.0f;
+			for (int run = 0; run < runs; ++run) {
+				Timer timer;
+				render(loopConfig, 0, 0, loopConfig.width, loopConfig.height, scene, target, ids);
+				float seconds = timer.Mark();
+				if (run == 0 || seconds < best) best = seconds;
+			}
+
+			bool same = target == reference || memcmp(target, reference, pixelCount * sizeof(Vec3f)) == 0;
+			std::cout << std::left << std::setw(12) << (l == 0 ? "multiple" : "singular") << std::setw(14) << (schedule == 0 ? "serial" : "parallel for")
+				<< std::right << std::fixed << std::setprecision(2) << std::setw(14) << best * 1000.0f << std::setw(14) << rays / best / 1e6
+				<< std::setw(12) << (same ? "yes" : "NO") << std::defaultfloat << "\n";
+		}
+	}
+	std::cout << std::endl;
+
+	delete[] ids;
+	delete[] image;
+	delete[] reference;
+}
+
+//Sums the primary rays of a frame made as the render loops make them, compiled for the math mode like the loops
+template<MathMode mode>
+static float SumComputedRays(const RenderConfig& config)
+{
+	float sum = 0.0f;
+	for (unsigned y = 0; y < config.height; ++y) {
+		const RowRays rays(config, y);
+		for (unsigned x = 0; x < config.width; ++x) {
+			Vec3f raydir = rays.Direction(x);
+			Normalize<mode>(raydir);
+			sum += raydir.x + raydir.y + raydir.z;
+		}
+	}
+	return sum;
+}
+
+static float SumComputedRays(const RenderConfig& config)
+{
+	switch (config.mathMode) {
+	case MATH_FAST: return SumComputedRays<MATH_FAST>(config);
+	case MATH_FASTEST: return SumComputedRays<MATH_FASTEST>(config);
+	default: return SumComputedRays<MATH_EXACT>(config);
+	}
+}
+
+static float SumTableRays(const RenderConfig& config, const RayTable& table)
+{
+	float sum = 0.0f;
+	for (unsigned y = 0; y < config.height; ++y) {
+		for (unsigned x = 0; x < config.width; ++x) {
+			Vec3f raydir = table.GetDirection(x, y);
+			sum += raydir.x + raydir.y + raydir.z;
+		}
+	}
+	return sum;
+}
+
+void Benchmark::RayTables(const RenderConfig& config, const std::vector<std::pair<unsigned, unsigned>>& resolutions)
+{
+	const int runs = 5;
+
+	std::cout << "Ray tables, math: " << GetMathModeName(config.mathMode) << ", fov " << config.fov << ", one thread\n\n";
+	std::cout << std::left << std::setw(12) << "SIZE" << std::right << std::setw(12) << "TABLE (MB)" << std::setw(12) << "MAKE (ms)"
+		<< std::setw(14) << "COMPUTE (ms)" << std::setw(12) << "READ (ms)" << std::setw(10) << "SPEEDUP" << std::setw(14) << "PAID BACK IN" << "\n";
+
+	for (const std::pair<unsigned, unsigned>& resolution : resolutions) {
+		RenderConfig sizeConfig(resolution.first, resolution.second, config.threadCount, config.fov);
+		sizeConfig.mathMode = config.mathMode;
+
+		Timer makeTimer;
+		RayTable* table = new RayTable(sizeConfig);
+		float makeSeconds = makeTimer.Mark();
+
+		//Best of several runs, the first one also warms the caches
+		float computeSeconds = 0.0f;
+		float readSeconds = 0.0f;
+		for (int run = 0; run < runs; ++run) {
+			Timer timer;
+			float computed = SumComputedRays(sizeConfig);
+			float seconds = timer.Mark();
+			if (run == 0 || seconds < computeSeconds) computeSeconds = seconds;
+
+			float read = SumTableRays(sizeConfig, *table);
+			seconds = timer.Mark();
+			if (run == 0 || seconds < readSeconds) readSeconds = seconds;
+
+			//The same rays both ways, or the table would change the frames
+			if (computed != read) std::cout << "[WARNING: Benchmark.cpp: the ray table does not match the computed rays" << std::endl;
+			benchmarkSink = benchmarkSink + computed + read;
+		}
+
+		std::string size = std::to_string(resolution.first) + "x" + std::to_string(resolution.second);
+		std::cout << std::left << std::setw(12) << size << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << RayTable::GetSize(sizeConfig) / (1024.0 * 1024.0) << std::setw(12) << makeSeconds * 1000.0f
+			<< std::setw(14) << computeSeconds * 1000.0f << std::setw(12) << readSeconds * 1000.0f << std::setw(10) << computeSeconds / readSeconds;
+		//Frames before the time saved reading covers the time taken making the table
+		if (readSeconds < computeSeconds) std::cout << std::setw(7) << (int)ceil(makeSeconds / (computeSeconds - readSeconds)) << " frames";
+		else std::cout << std::setw(14) << "never";
+		std::cout << std::defaultfloat << "\n";
+
+		delete table;
+	}
+	std::cout << std::endl;
+}
+
+void Benchmark::PageSizes(const RenderConfig& config)
+{
+	const int workerCount = (int)config.threadCount;
+	const unsigned width = config.width;
+	//Each worker's band, the pools are sized for the larger chunks of the cost balancing
+	const unsigned rows = (config.height + workerCount - 1) / workerCount;
+	const char* passNames[] = { "rows", "columns", "convert" };
+	const int passCount = 3;
+	const int runCount = 5;
+	Heap& heap = HeapManager::GetDefaultHeap();
+
+	std::cout << "Page sizes, " << width << "x" << config.height << ", " << workerCount << " workers, "
+		<< (config.vec3Size + config.charSize) * workerCount / (1024 * 1024) << " MB of frame buffers\n\n";
+	std::cout << std::left << std::setw(26) << "PAGES" << std::setw(10) << "PASS" << std::right << std::setw(14) << "TIME (ms)"
+		<< std::setw(18) << "dTLB-load-miss" << std::setw(18) << "dTLB-store-miss" << "\n";
+
+	for (int huge = 0; huge < 2; ++huge) {
+		MemoryPool* chunkPool = new MemoryPool(&heap, workerCount, (unsigned long)config.vec3Size, huge == 1);
+		MemoryPool* charPool = new MemoryPool(&heap, workerCount, (unsigned long)config.charSize, huge == 1);
+		if (huge == 1 && chunkPool->GetPageKind() == PAGES_DEFAULT) {
+			std::cout << "[WARNING: Benchmark.cpp: huge pages are not available, the second run uses 4KB pages as well" << std::endl;
+		}
+
+		std::vector<Vec3f*> chunks(workerCount);
+		std::vector<char*> chars(workerCount);
+		for (int w = 0; w < workerCount; ++w) {
+			chunks[w] = (Vec3f*)chunkPool->Alloc((unsigned long)config.vec3Size);
+			chars[w] = (char*)charPool->Alloc((unsigned long)config.charSize);
+			//Touched once first, so the page faults are not part of the timings
+			std::fill(chunks[w], chunks[w] + (size_t)width * rows, Vec3f(0));
+			memset(chars[w], 0, config.charSize);
+		}
+
+		for (int pass = 0; pass < passCount; ++pass) {
+			float best = 0.0f;
+			PerfSample total;
+			for (int run = 0; run < runCount; ++run) {
+				PerfCounters counters;
+				Timer timer;
+				counters.Start();
+				if (pass == 0) {
+					//Every worker writes its next row in turn, as they do when they run side by side
+					for (unsigned y = 0; y < rows; ++y) {
+						for (int w = 0; w < workerCount; ++w) {
+							Vec3f* row = chunks[w] + (size_t)y * width;
+							for (unsigned x = 0; x < width; ++x) row[x] = Vec3f((float)x * config.invWidth, (float)y / rows, (float)run);
+						}
+					}
+				}
+				else if (pass == 1) {
+					//Each step down a column is a row further on, a new 4KB page for rows wider than 256 pixels
+					float sum = 0.0f;
+					for (int w = 0; w < workerCount; ++w) {
+						for (unsigned x = 0; x < width; ++x) {
+							for (unsigned y = 1; y < rows; ++y) {
+								sum += chunks[w][(size_t)y * width + x].x - chunks[w][(size_t)(y - 1) * width + x].x;
+							}
+						}
+					}
+					benchmarkSink = benchmarkSink + sum;
+				}
+				else {
+					for (int w = 0; w < workerCount; ++w) {
+						const Vec3f* chunk = chunks[w];
+						char* charArray = chars[w];
+						for (size_t i = 0; i < (size_t)width * rows; ++i) {
+							charArray[i * 3] = (unsigned char)((1.0f < chunk[i].x ? 1.0f : chunk[i].x) * 255);
+							charArray[i * 3 + 1] = (unsigned char)((1.0f < chunk[i].y ? 1.0f : chunk[i].y) * 255);
+							charArray[i * 3 + 2] = (unsigned char)((1.0f < chunk[i].z ? 1.0f : chunk[i].z) * 255);
+						}
+					}
+				}
+				float seconds = timer.Peek();
+				total.Accumulate(counters.Stop());
+				if (run == 0 || seconds < best) best = seconds;
+			}
+
+			std::cout << std::left << std::setw(26) << HugePages::GetKindName(chunkPool->GetPageKind()) << std::setw(10) << passNames[pass]
+				<< std::right << std::fixed << std::setprecision(2) << std::setw(14) << best * 1000.0f;
+			for (int e = PERF_DTLB_LOAD_MISSES; e <= PERF_DTLB_STORE_MISSES; ++e) {
+				if (total.valid[e]) std::cout << std::setw(18) << total.values[e] / runCount;
+				else std::cout << std::setw(18) << "n/a";
+			}
+			std::cout << std::defaultfloat << "\n";
+		}
+
+		//Transparent huge pages are only a hint, this shows how much the kernel actually gave
+		long long transparentBytes = HugePages::GetTransparentHugeBytes();
+		if (huge == 1 && transparentBytes >= 0) {
+			std::cout << "AnonHugePages: " << transparentBytes / 1024 << " kB" << "\n";
+		}
+
+		for (int w = 0; w < workerCount; ++w) {
+			chunkPool->Free(chunks[w]);
+			charPool->Free(chars[w]);
+		}
+		delete chunkPool;
+		delete charPool;
+	}
+	std::cout << "(dTLB misses are per pass, averaged over " << runCount << " runs)" << std::endl;
+}
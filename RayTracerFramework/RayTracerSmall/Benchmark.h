@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "RenderConfig.h"
+#include "Scene.h"
+
+//Signature of trace() in main.cpp
+typedef Vec3f(*TraceFunction)(const Vec3f& rayorig, const Vec3f& raydir, const Scene& scene, const int& depth, const RayLimits& limits, const float& throughput);
+//Signature of RenderSector() in main.cpp
+typedef void(*SectorFunction)(const RenderConfig& config, const unsigned int& startX, const unsigned int& startY, const unsigned int& endX, const unsigned int& endY, const Scene& scene, Vec3f* image, int* ids);
+
+//Stand alone benchmarks that can be run from the command line instead of rendering an animation
+class Benchmark
+{
+public:
+	//Generates json scenes with each sphere count and times the DOM, streaming and binary loaders on them
+	static void SceneLoading(const std::vector<int>& sphereCounts);
+
+	//Traces every primary ray of one frame on the calling thread, several times, and reports rays per second.
+	//The Vec3f version in use is printed with the results. For the scalar numbers to compare against, build
+	//again with VEC3_NO_SIMD defined (see Vec3.h) and run the same scene and options; the checksums should agree
+	static void TraceThroughput(const RenderConfig& config, const Scene& scene, TraceFunction trace);
+
+	//Renders one frame with trace compiled for each math mode (traces is indexed by MathMode), writes them to
+	//math_<mode>.ppm and reports the time of each and its PSNR against the exact frame
+	static void MathModes(const RenderConfig& config, const Scene& scene, const TraceFunction* traces);
+
+	//Renders one frame at full depth, then with several throughput cutoffs with and without russian roulette,
+	//and reports the time of each and its PSNR against the full depth frame
+	static void RayTermination(const RenderConfig& config, const Scene& scene, TraceFunction trace);
+
+	//Renders the first frame through every output layout and schedule of the render loop on the calling thread
+	//and reports the time of each, checking they give the same pixels. Also times making the primary rays alone,
+	//per pixel in double as the loops used to and a row at a time with RowRays
+	static void RenderLoops(const RenderConfig& config, const Scene& scene, SectorFunction render);
+
+	//At each frame size, times making every primary ray of a frame against reading them from a RayTable, on the
+	//calling thread, and how long the table takes to make. Shows where the table outgrows the caches and reading
+	//it costs more memory bandwidth than working the rays out saves
+	static void RayTables(const RenderConfig& config, const std::vector<std::pair<unsigned, unsigned>>& resolutions);
+
+	//Creates the frame buffer pools of a multiple container render on 4KB pages and then on huge pages, and times
+	//the workers' buffer passes over each: writing rows, reading down columns as the edge detection does and
+	//converting to chars. Reports the time and dTLB misses of each pass, the misses need perf counters (linux)
+	static void PageSizes(const RenderConfig& config);
+
+private:
+	//Traces one frame on the calling thread into 8 bit rgb, returns the time taken in seconds
+	static float TraceFrame(const RenderConfig& config, MathMode mode, const Scene& scene, TraceFunction trace, unsigned char* pixels);
+
+	//Outputs the PSNR, largest channel difference and share of pixels that differ between two frames
+	static void PrintDifference(const unsigned char* pixels, const unsigned char* reference, size_t byteCount);
+
+	//Writes a json scene with randomly placed spheres
+	static void WriteSceneFile(const std::string& path, int sphereCount, int frameCount);
+};
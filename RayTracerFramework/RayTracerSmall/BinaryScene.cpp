@@ -0,0 +1,462 @@
+#include "BinaryScene.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#if defined _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char sceneMagic[4] = { 'R', 'T', 'S', 'C' };
+static const uint32_t sceneEndianCheck = 0x01020304;
+
+//Copies a track value into the value array of a binary keyframe
+static void StoreValue(const Vec3f& value, float* out)
+{
+	out[0] = value.x;
+	out[1] = value.y;
+	out[2] = value.z;
+}
+
+static void StoreValue(float value, float* out)
+{
+	out[0] = value;
+	out[1] = 0.0f;
+	out[2] = 0.0f;
+}
+
+template<typename T>
+static void AppendTrack(const AnimationTrack<T>& track, uint32_t sphere, TrackProperty property, std::vector<BinaryKeyframe>& keyframes)
+{
+	for (size_t i = 0; i < track.GetKeyCount(); ++i) {
+		const Keyframe<T>& key = track.GetKey(i);
+		BinaryKeyframe binaryKey;
+		binaryKey.sphere = sphere;
+		binaryKey.property = property;
+		binaryKey.frame = key.frame;
+		binaryKey.interpolation = key.interpolation;
+		StoreValue(key.value, binaryKey.value);
+		binaryKey.reserved = 0;
+		keyframes.push_back(binaryKey);
+	}
+}
+
+//Rounds a byte offset up to the array alignment
+static uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + BINARY_SCENE_ALIGNMENT - 1) & ~(uint64_t)(BINARY_SCENE_ALIGNMENT - 1);
+}
+
+//True if bytes starting at offset lie inside a file of size bytes. offset + bytes is never worked out as
+//a header with huge values would wrap it around to a small number
+static bool InsideFile(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+	return offset <= size && bytes <= size - offset;
+}
+
+BinaryScene* BinaryScene::Open(const char* filepath)
+{
+	BinaryScene* scene = new BinaryScene();
+
+#if defined _WIN32
+	HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cout << "[ERROR: BinaryScene.cpp: could not open " << filepath << std::endl;
+		delete scene;
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		std::cout << "[ERROR: BinaryScene.cpp: could not read the size of " << filepath << std::endl;
+		CloseHandle(file);
+		delete scene;
+		return nullptr;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+	scene->_fileHandle = file;
+	scene->_mappingHandle = mapping;
+	scene->_size = (size_t)fileSize.QuadPart;
+	scene->_data = (const char*)view;
+	scene->_mapped = view != NULL;
+#else
+	int fd = open(filepath, O_RDONLY);
+	if (fd == -1) {
+		std::cout << "[ERROR: BinaryScene.cpp: could not open " << filepath << std::endl;
+		delete scene;
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		std::cout << "[ERROR: BinaryScene.cpp: could not read the size of " << filepath << std::endl;
+		close(fd);
+		delete scene;
+		return nullptr;
+	}
+	scene->_size = (size_t)st.st_size;
+
+	void* view = scene->_size > 0 ? mmap(nullptr, scene->_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	//The mapping keeps its own reference to the file
+	close(fd);
+
+	if (view != MAP_FAILED) {
+		scene->_data = (const char*)view;
+		scene->_mapped = true;
+	}
+#endif
+
+	if (!scene->_mapped) {
+		//Some file systems cannot be mapped, read the file into an aligned buffer instead
+		std::ifstream file(filepath, std::ios::in | std::ios::binary);
+		char* buffer = scene->AllocateAligned(scene->_size);
+		if (!file.is_open() || !file.read(buffer, scene->_size)) {
+			std::cout << "[ERROR: BinaryScene.cpp: could not read " << filepath << std::endl;
+			delete scene;
+			return nullptr;
+		}
+	}
+
+	scene->_header = (const BinarySceneHeader*)scene->_data;
+
+	if (!scene->Validate(filepath)) {
+		delete scene;
+		return nullptr;
+	}
+
+	return scene;
+}
+
+BinaryScene* BinaryScene::FromMemory(const char* data, size_t size)
+{
+	BinaryScene* scene = new BinaryScene();
+
+	char* buffer = scene->AllocateAligned(size);
+	memcpy(buffer, data, size);
+	scene->_size = size;
+	scene->_header = (const BinarySceneHeader*)scene->_data;
+
+	if (!scene->Validate("scene in memory")) {
+		delete scene;
+		return nullptr;
+	}
+
+	return scene;
+}
+
+char* BinaryScene::AllocateAligned(size_t size)
+{
+	//operator new only aligns to 16 bytes, the extra is room to move the start up to the alignment
+	_buffer = new char[size + BINARY_SCENE_ALIGNMENT];
+	char* aligned = (char*)(((uintptr_t)_buffer + BINARY_SCENE_ALIGNMENT - 1) & ~(uintptr_t)(BINARY_SCENE_ALIGNMENT - 1));
+	_data = aligned;
+	return aligned;
+}
+
+bool BinaryScene::Validate(const char* filepath) const
+{
+	if (_data == nullptr || _size < sizeof(BinarySceneHeader)) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " is too small to be a binary scene" << std::endl;
+		return false;
+	}
+
+	if (memcmp(_header->magic, sceneMagic, sizeof(sceneMagic)) != 0) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " is not a binary scene" << std::endl;
+		return false;
+	}
+
+	if (_header->endianCheck != sceneEndianCheck) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " was written with a different byte order" << std::endl;
+		return false;
+	}
+
+	if (_header->version != BINARY_SCENE_VERSION || _header->headerSize != sizeof(BinarySceneHeader)) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " has version " << _header->version << ", expected " << BINARY_SCENE_VERSION << ". Convert the json scene again" << std::endl;
+		return false;
+	}
+
+	if (_header->fileSize != _size) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " is truncated" << std::endl;
+		return false;
+	}
+
+	//Every array has to be aligned and lie completely inside the file
+	uint64_t arrayBytes = (uint64_t)_header->sphereCount * sizeof(float);
+	for (int i = 0; i < SCENE_ARRAY_COUNT; ++i) {
+		uint64_t offset = _header->arrayOffsets[i];
+		if (offset % BINARY_SCENE_ALIGNMENT != 0 || !InsideFile(offset, arrayBytes, _size)) {
+			std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " has an invalid array offset" << std::endl;
+			return false;
+		}
+	}
+
+	uint64_t keyframeBytes = (uint64_t)_header->keyframeCount * sizeof(BinaryKeyframe);
+	if (_header->keyframeOffset % BINARY_SCENE_ALIGNMENT != 0 || !InsideFile(_header->keyframeOffset, keyframeBytes, _size)) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " has an invalid keyframe offset" << std::endl;
+		return false;
+	}
+
+	uint64_t planeBytes = (uint64_t)_header->planeCount * sizeof(BinaryPlane);
+	if (_header->planeOffset % BINARY_SCENE_ALIGNMENT != 0 || !InsideFile(_header->planeOffset, planeBytes, _size)) {
+		std::cout << "[ERROR: BinaryScene.cpp: " << filepath << " has an invalid plane offset" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+BinaryScene::~BinaryScene()
+{
+	Unmap();
+}
+
+void BinaryScene::Unmap()
+{
+	if (_data == nullptr) return;
+
+	if (_mapped) {
+#if defined _WIN32
+		UnmapViewOfFile(_data);
+#else
+		munmap((void*)_data, _size);
+#endif
+	}
+	else {
+		delete[] _buffer;
+		_buffer = nullptr;
+	}
+
+#if defined _WIN32
+	if (_mappingHandle != NULL) CloseHandle((HANDLE)_mappingHandle);
+	if (_fileHandle != NULL) CloseHandle((HANDLE)_fileHandle);
+	_mappingHandle = nullptr;
+	_fileHandle = nullptr;
+#endif
+
+	_data = nullptr;
+	_header = nullptr;
+}
+
+const float* BinaryScene::GetArray(BinarySceneArray arr) const
+{
+	return (const float*)(_data + _header->arrayOffsets[arr]);
+}
+
+JSONSphereInfo* BinaryScene::CreateSphereInfo() const
+{
+	int noSpheres = GetSphereCount();
+	int noFrames = GetFrameCount();
+	JSONSphereInfo* animInfo = new JSONSphereInfo(noSpheres, noFrames);
+
+	const float* posX = GetArray(SCENE_POSITION_X);
+	const float* posY = GetArray(SCENE_POSITION_Y);
+	const float* posZ = GetArray(SCENE_POSITION_Z);
+	const float* radius = GetArray(SCENE_RADIUS);
+	const float* surfR = GetArray(SCENE_SURFACE_R);
+	const float* surfG = GetArray(SCENE_SURFACE_G);
+	const float* surfB = GetArray(SCENE_SURFACE_B);
+	const float* emisR = GetArray(SCENE_EMISSION_R);
+	const float* emisG = GetArray(SCENE_EMISSION_G);
+	const float* emisB = GetArray(SCENE_EMISSION_B);
+	const float* transparency = GetArray(SCENE_TRANSPARENCY);
+	const float* reflection = GetArray(SCENE_REFLECTION);
+	const float* moveX = GetArray(SCENE_MOVEMENT_X);
+	const float* moveY = GetArray(SCENE_MOVEMENT_Y);
+	const float* moveZ = GetArray(SCENE_MOVEMENT_Z);
+	const float* colorR = GetArray(SCENE_COLOR_DELTA_R);
+	const float* colorG = GetArray(SCENE_COLOR_DELTA_G);
+	const float* colorB = GetArray(SCENE_COLOR_DELTA_B);
+
+	for (int i = 0; i < noSpheres; ++i) {
+		Sphere& sphere = animInfo->sphereArr[i];
+		sphere._center = Vec3f(posX[i], posY[i], posZ[i]);
+		sphere._radius = radius[i];
+		sphere._radiusSqr = radius[i] * radius[i];
+		sphere._surfaceColor = Vec3f(surfR[i], surfG[i], surfB[i]);
+		sphere._emissionColor = Vec3f(emisR[i], emisG[i], emisB[i]);
+		sphere._transparency = transparency[i];
+		sphere._reflection = reflection[i];
+
+		//The per frame values are stored directly, the end values are only kept for completeness
+		animInfo->sphereMovementsPerFrame[i] = Vec3f(moveX[i], moveY[i], moveZ[i]);
+		animInfo->sphereColorPerFrame[i] = Vec3f(colorR[i], colorG[i], colorB[i]);
+		animInfo->sphereEndPositions[i] = sphere._center + animInfo->sphereMovementsPerFrame[i] * (float)noFrames;
+		animInfo->sphereEndColor[i] = sphere._surfaceColor + animInfo->sphereColorPerFrame[i] * (float)noFrames;
+	}
+
+	const BinaryKeyframe* keyframes = GetKeyframes();
+	for (int i = 0; i < GetKeyframeCount(); ++i) {
+		const BinaryKeyframe& key = keyframes[i];
+		if (key.sphere >= (uint32_t)noSpheres || key.property >= TRACK_COUNT) continue;
+		animInfo->sphereAnimations[key.sphere].AddKey((TrackProperty)key.property, key.frame, key.value, (Interpolation)key.interpolation);
+	}
+
+	//The normal is already unit length and the offset already computed, copy them without Set()
+	const BinaryPlane* planes = GetPlanes();
+	for (int i = 0; i < GetPlaneCount(); ++i) {
+		const BinaryPlane& binaryPlane = planes[i];
+		Plane plane;
+		plane._normal = Vec3f(binaryPlane.normal[0], binaryPlane.normal[1], binaryPlane.normal[2]);
+		plane._offset = binaryPlane.offset;
+		plane._surfaceColor = Vec3f(binaryPlane.surfaceColor[0], binaryPlane.surfaceColor[1], binaryPlane.surfaceColor[2]);
+		plane._emissionColor = Vec3f(binaryPlane.emissionColor[0], binaryPlane.emissionColor[1], binaryPlane.emissionColor[2]);
+		plane._transparency = binaryPlane.transparency;
+		plane._reflection = binaryPlane.reflection;
+		animInfo->planes.push_back(plane);
+	}
+
+	//Spheres written without tracks get the same start to end animation as the json loaders give them
+	animInfo->BuildLegacyTracks();
+	return animInfo;
+}
+
+bool BinaryScene::Write(const JSONSphereInfo& info, const char* filepath)
+{
+	std::ofstream ofs(filepath, std::ios::out | std::ios::binary);
+	if (!ofs.is_open()) {
+		std::cout << "[ERROR: BinaryScene.cpp: could not create " << filepath << std::endl;
+		return false;
+	}
+
+	Write(info, ofs);
+	ofs.close();
+	return true;
+}
+
+void BinaryScene::Write(const JSONSphereInfo& info, std::ostream& out)
+{
+	BinarySceneHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+	header.endianCheck = sceneEndianCheck;
+	header.version = BINARY_SCENE_VERSION;
+	header.headerSize = sizeof(BinarySceneHeader);
+	header.frameCount = info.frameCount;
+	header.sphereCount = info.sphereCount;
+	header.alignment = BINARY_SCENE_ALIGNMENT;
+
+	//Lay out the arrays one after another, each starting on an aligned offset
+	uint64_t arrayBytes = (uint64_t)info.sphereCount * sizeof(float);
+	uint64_t offset = AlignOffset(sizeof(BinarySceneHeader));
+	for (int i = 0; i < SCENE_ARRAY_COUNT; ++i) {
+		header.arrayOffsets[i] = offset;
+		offset = AlignOffset(offset + arrayBytes);
+	}
+
+	//Flatten every animation track into one keyframe array
+	std::vector<BinaryKeyframe> keyframes;
+	for (int i = 0; i < info.sphereCount; ++i) {
+		const SphereAnimation& anim = info.sphereAnimations[i];
+		AppendTrack(anim.position, i, TRACK_POSITION, keyframes);
+		AppendTrack(anim.radius, i, TRACK_RADIUS, keyframes);
+		AppendTrack(anim.surfaceColor, i, TRACK_SURFACE_COLOR, keyframes);
+		AppendTrack(anim.emissionColor, i, TRACK_EMISSION_COLOR, keyframes);
+		AppendTrack(anim.transparency, i, TRACK_TRANSPARENCY, keyframes);
+		AppendTrack(anim.reflection, i, TRACK_REFLECTION, keyframes);
+	}
+	header.keyframeCount = (uint32_t)keyframes.size();
+	header.keyframeOffset = offset;
+	offset = AlignOffset(offset + keyframes.size() * sizeof(BinaryKeyframe));
+
+	std::vector<BinaryPlane> planes;
+	for (const Plane& plane : info.planes) {
+		BinaryPlane binaryPlane;
+		StoreValue(plane._normal, binaryPlane.normal);
+		binaryPlane.offset = plane._offset;
+		StoreValue(plane._surfaceColor, binaryPlane.surfaceColor);
+		StoreValue(plane._emissionColor, binaryPlane.emissionColor);
+		binaryPlane.transparency = plane._transparency;
+		binaryPlane.reflection = plane._reflection;
+		planes.push_back(binaryPlane);
+	}
+	header.planeCount = (uint32_t)planes.size();
+	header.planeOffset = offset;
+	offset = AlignOffset(offset + planes.size() * sizeof(BinaryPlane));
+
+	header.fileSize = offset;
+
+	out.write((const char*)&header, sizeof(header));
+
+	//Gather each property into a temporary array before writing it out
+	float* column = new float[info.sphereCount > 0 ? info.sphereCount : 1];
+	const char padding[BINARY_SCENE_ALIGNMENT] = {};
+	uint64_t written = sizeof(header);
+
+	for (int arr = 0; arr < SCENE_ARRAY_COUNT; ++arr) {
+		//Pad up to the start of this array
+		out.write(padding, header.arrayOffsets[arr] - written);
+		written = header.arrayOffsets[arr];
+
+		for (int i = 0; i < info.sphereCount; ++i) {
+			const Sphere& sphere = info.sphereArr[i];
+			const Vec3f& movement = info.sphereMovementsPerFrame[i];
+			const Vec3f& colorDelta = info.sphereColorPerFrame[i];
+
+			switch (arr) {
+			case SCENE_POSITION_X: column[i] = sphere._center.x; break;
+			case SCENE_POSITION_Y: column[i] = sphere._center.y; break;
+			case SCENE_POSITION_Z: column[i] = sphere._center.z; break;
+			case SCENE_RADIUS: column[i] = sphere._radius; break;
+			case SCENE_SURFACE_R: column[i] = sphere._surfaceColor.x; break;
+			case SCENE_SURFACE_G: column[i] = sphere._surfaceColor.y; break;
+			case SCENE_SURFACE_B: column[i] = sphere._surfaceColor.z; break;
+			case SCENE_EMISSION_R: column[i] = sphere._emissionColor.x; break;
+			case SCENE_EMISSION_G: column[i] = sphere._emissionColor.y; break;
+			case SCENE_EMISSION_B: column[i] = sphere._emissionColor.z; break;
+			case SCENE_TRANSPARENCY: column[i] = sphere._transparency; break;
+			case SCENE_REFLECTION: column[i] = sphere._reflection; break;
+			case SCENE_MOVEMENT_X: column[i] = movement.x; break;
+			case SCENE_MOVEMENT_Y: column[i] = movement.y; break;
+			case SCENE_MOVEMENT_Z: column[i] = movement.z; break;
+			case SCENE_COLOR_DELTA_R: column[i] = colorDelta.x; break;
+			case SCENE_COLOR_DELTA_G: column[i] = colorDelta.y; break;
+			case SCENE_COLOR_DELTA_B: column[i] = colorDelta.z; break;
+			}
+		}
+
+		out.write((const char*)column, arrayBytes);
+		written += arrayBytes;
+	}
+
+	out.write(padding, header.keyframeOffset - written);
+	written = header.keyframeOffset;
+	if (!keyframes.empty()) {
+		out.write((const char*)keyframes.data(), keyframes.size() * sizeof(BinaryKeyframe));
+		written += keyframes.size() * sizeof(BinaryKeyframe);
+	}
+
+	out.write(padding, header.planeOffset - written);
+	written = header.planeOffset;
+	if (!planes.empty()) {
+		out.write((const char*)planes.data(), planes.size() * sizeof(BinaryPlane));
+		written += planes.size() * sizeof(BinaryPlane);
+	}
+
+	//Pad the end of the file so it is a whole number of alignment blocks
+	out.write(padding, header.fileSize - written);
+
+	delete[] column;
+}
+
+bool BinaryScene::ConvertFromJSON(const char* jsonPath, const char* binaryPath)
+{
+	JSONSphereInfo* info = JSONReader::StreamSphereInfoFromFile(jsonPath);
+	if (info == nullptr) return false;
+
+	bool result = Write(*info, binaryPath);
+
+	if (result) {
+		std::cout << "Converted " << jsonPath << " (" << info->sphereCount << " spheres, " << info->planes.size() << " planes, " << info->frameCount << " frames) to " << binaryPath << std::endl;
+	}
+
+	info->Cleanup();
+	delete info;
+	return result;
+}
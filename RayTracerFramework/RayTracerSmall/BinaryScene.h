@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include "JSONReader.h"
+
+//Version of the binary scene layout. Bump this whenever the header or the array list changes
+#define BINARY_SCENE_VERSION 3
+//Every array in the file starts on a boundary of this many bytes so it can be loaded straight into SIMD registers
+#define BINARY_SCENE_ALIGNMENT 64
+
+//The structure of arrays stored in a binary scene, each one holds sphereCount floats
+enum BinarySceneArray {
+	SCENE_POSITION_X,
+	SCENE_POSITION_Y,
+	SCENE_POSITION_Z,
+	SCENE_RADIUS,
+	SCENE_SURFACE_R,
+	SCENE_SURFACE_G,
+	SCENE_SURFACE_B,
+	SCENE_EMISSION_R,
+	SCENE_EMISSION_G,
+	SCENE_EMISSION_B,
+	SCENE_TRANSPARENCY,
+	SCENE_REFLECTION,
+	//Per frame movement of each sphere
+	SCENE_MOVEMENT_X,
+	SCENE_MOVEMENT_Y,
+	SCENE_MOVEMENT_Z,
+	//Per frame change of the surface color of each sphere
+	SCENE_COLOR_DELTA_R,
+	SCENE_COLOR_DELTA_G,
+	SCENE_COLOR_DELTA_B,
+	SCENE_ARRAY_COUNT
+};
+
+//Fixed size header at the start of every binary scene file
+struct BinarySceneHeader {
+	//"RTSC"
+	char magic[4];
+	//Written as 0x01020304, lets us reject files created on a machine with a different byte order
+	uint32_t endianCheck;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t frameCount;
+	uint32_t sphereCount;
+	uint32_t alignment;
+	uint32_t keyframeCount;
+	uint32_t planeCount;
+	uint32_t reserved;
+	//Total size of the file, used to detect truncated files
+	uint64_t fileSize;
+	//Byte offset of the keyframe array
+	uint64_t keyframeOffset;
+	//Byte offset of the plane array
+	uint64_t planeOffset;
+	//Byte offset of each array from the start of the file
+	uint64_t arrayOffsets[SCENE_ARRAY_COUNT];
+};
+
+//One key of one sphere's animation track, stored after the sphere arrays
+struct BinaryKeyframe {
+	uint32_t sphere;
+	//TrackProperty
+	uint32_t property;
+	float frame;
+	//Interpolation
+	uint32_t interpolation;
+	//Float tracks only use value[0]
+	float value[3];
+	uint32_t reserved;
+};
+
+//One plane of the scene, planes are few so they are stored as whole structures after the keyframes
+struct BinaryPlane {
+	float normal[3];
+	float offset;
+	float surfaceColor[3];
+	float emissionColor[3];
+	float transparency;
+	float reflection;
+};
+
+//A compiled scene that is memory mapped and validated in place, so no text is parsed. The arrays point straight
+//into the mapping, but the renderer works on Sphere structures, so CreateSphereInfo still copies every sphere
+//out of them once (O(n) in the sphere count) and the mapping can be closed after that.
+class BinaryScene
+{
+public:
+	//Maps and validates a binary scene file, returns nullptr if the file is missing or invalid
+	static BinaryScene* Open(const char* filepath);
+
+	//Validates a binary scene held in memory, such as one received over a socket. The data is copied
+	static BinaryScene* FromMemory(const char* data, size_t size);
+
+	//Writes the animation information to a binary scene file
+	static bool Write(const JSONSphereInfo& info, const char* filepath);
+	//Writes the animation information in the binary scene layout to any stream
+	static void Write(const JSONSphereInfo& info, std::ostream& out);
+
+	//Converts a json scene to a binary scene
+	static bool ConvertFromJSON(const char* jsonPath, const char* binaryPath);
+
+	~BinaryScene();
+
+	int GetFrameCount() const { return _header->frameCount; }
+	int GetSphereCount() const { return _header->sphereCount; }
+
+	//Returns a pointer to one of the arrays inside the mapped file
+	const float* GetArray(BinarySceneArray arr) const;
+	int GetKeyframeCount() const { return _header->keyframeCount; }
+	const BinaryKeyframe* GetKeyframes() const { return (const BinaryKeyframe*)(_data + _header->keyframeOffset); }
+	int GetPlaneCount() const { return _header->planeCount; }
+	const BinaryPlane* GetPlanes() const { return (const BinaryPlane*)(_data + _header->planeOffset); }
+
+	//Builds the animation information the renderer uses by copying every sphere out of the mapped arrays.
+	//The result does not point into the mapping, so the scene can be deleted afterwards
+	JSONSphereInfo* CreateSphereInfo() const;
+
+	BinaryScene(const BinaryScene&) = delete;
+	BinaryScene& operator=(const BinaryScene&) = delete;
+private:
+	BinaryScene() = default;
+
+	bool Validate(const char* filepath) const;
+	void Unmap();
+	//Copies size bytes into a new buffer whose start is moved up to BINARY_SCENE_ALIGNMENT, for the fallbacks
+	//that cannot map the file. Returns a pointer to the copy
+	char* AllocateAligned(size_t size);
+
+	const BinarySceneHeader* _header = nullptr;
+	const char* _data = nullptr;
+	size_t _size = 0;
+
+	//true if the file is mapped, false if we had to fall back to reading it into memory
+	bool _mapped = false;
+	//The allocation the fallbacks read into, _data is this moved up to the alignment
+	char* _buffer = nullptr;
+#if defined _WIN32
+	void* _fileHandle = nullptr;
+	void* _mappingHandle = nullptr;
+#endif
+};
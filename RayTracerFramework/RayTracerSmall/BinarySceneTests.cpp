@@ -0,0 +1,128 @@
+#include "SelfTest.h"
+#include "BinaryScene.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+//Three spheres, one with a keyframe track, and a floor
+static JSONSphereInfo* CreateTestScene()
+{
+	JSONSphereInfo* info = new JSONSphereInfo(3, 10);
+	for (int i = 0; i < info->sphereCount; ++i) {
+		info->sphereArr[i] = Sphere(Vec3f((float)i, 1.0f, -20.0f), 1.0f + i, Vec3f(0.5f, 0.25f, 0.125f), 0.5f, 0.25f * i);
+		info->sphereEndPositions[i] = info->sphereArr[i]._center + Vec3f(10.0f, 0.0f, 0.0f);
+		info->sphereEndColor[i] = info->sphereArr[i]._surfaceColor;
+	}
+	info->sphereAnimations[1].position.AddKey(0.0f, Vec3f(0.0f, 2.0f, -20.0f));
+	info->sphereAnimations[1].position.AddKey(9.0f, Vec3f(4.0f, 2.0f, -20.0f), INTERPOLATION_CUBIC);
+
+	Plane floor;
+	floor.Set(Vec3f(0.0f, 1.0f, 0.0f), Vec3f(0.0f, -4.0f, 0.0f));
+	info->planes.push_back(floor);
+
+	info->CalculateSphereMovements();
+	info->CalculateSphereColor();
+	return info;
+}
+
+//Overwrites a field of the header in a written scene
+template<typename T>
+static std::string Patch(std::string data, size_t offset, T value)
+{
+	memcpy(&data[offset], &value, sizeof(value));
+	return data;
+}
+
+static bool Accepts(const std::string& data)
+{
+	BinaryScene* scene = BinaryScene::FromMemory(data.data(), data.size());
+	delete scene;
+	return scene != nullptr;
+}
+
+static bool ArraysAligned(const BinaryScene& scene)
+{
+	for (int i = 0; i < SCENE_ARRAY_COUNT; ++i) {
+		if ((size_t)scene.GetArray((BinarySceneArray)i) % BINARY_SCENE_ALIGNMENT != 0) return false;
+	}
+	return true;
+}
+
+void SelfTest::TestBinaryScene()
+{
+	JSONSphereInfo* info = CreateTestScene();
+	std::ostringstream out;
+	BinaryScene::Write(*info, out);
+	const std::string data = out.str();
+
+	//A scene that was just written is accepted and holds what was written
+	BinaryScene* scene = BinaryScene::FromMemory(data.data(), data.size());
+	SELF_CHECK(scene != nullptr);
+	if (scene != nullptr) {
+		SELF_CHECK(scene->GetSphereCount() == 3);
+		SELF_CHECK(scene->GetFrameCount() == 10);
+		SELF_CHECK(scene->GetKeyframeCount() == 2);
+		SELF_CHECK(scene->GetPlaneCount() == 1);
+		SELF_CHECK(ArraysAligned(*scene));
+		SELF_CHECK(scene->GetArray(SCENE_RADIUS)[2] == 3.0f);
+		SELF_CHECK(scene->GetArray(SCENE_MOVEMENT_X)[0] == info->sphereMovementsPerFrame[0].x);
+
+		JSONSphereInfo* loaded = scene->CreateSphereInfo();
+		SELF_CHECK(loaded->sphereCount == 3 && loaded->frameCount == 10 && loaded->planes.size() == 1);
+		SELF_CHECK(loaded->sphereArr[2]._center.x == 2.0f && loaded->sphereArr[2]._radiusSqr == 9.0f);
+		SELF_CHECK(loaded->sphereArr[2]._transparency == 0.5f);
+		SELF_CHECK(loaded->sphereAnimations[1].position.GetKeyCount() == 2);
+		SELF_CHECK(loaded->planes[0]._offset == info->planes[0]._offset);
+		loaded->Cleanup();
+		delete loaded;
+		delete scene;
+	}
+
+	//The copy is aligned whatever the alignment of the data it was given
+	std::string shifted = " " + data;
+	scene = BinaryScene::FromMemory(shifted.data() + 1, data.size());
+	SELF_CHECK(scene != nullptr && ArraysAligned(*scene));
+	delete scene;
+
+	//Too short, or not a scene of this version and byte order
+	SELF_CHECK(!Accepts(""));
+	SELF_CHECK(!Accepts(data.substr(0, sizeof(BinarySceneHeader) - 1)));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, magic), 'X')));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, endianCheck), (uint32_t)0x04030201)));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, version), (uint32_t)BINARY_SCENE_VERSION + 1)));
+
+	//Cut short, with and without the size in the header agreeing
+	const std::string truncated = data.substr(0, data.size() - BINARY_SCENE_ALIGNMENT);
+	SELF_CHECK(!Accepts(truncated));
+	SELF_CHECK(!Accepts(Patch(truncated, offsetof(BinarySceneHeader, fileSize), (uint64_t)truncated.size())));
+
+	//Offsets that are misaligned, past the end, or so large that adding the array size wraps around
+	const size_t firstArray = offsetof(BinarySceneHeader, arrayOffsets);
+	const size_t lastArray = firstArray + sizeof(uint64_t) * (SCENE_ARRAY_COUNT - 1);
+	SELF_CHECK(!Accepts(Patch(data, firstArray, (uint64_t)sizeof(BinarySceneHeader) + 4)));
+	SELF_CHECK(!Accepts(Patch(data, lastArray, (uint64_t)data.size())));
+	SELF_CHECK(!Accepts(Patch(data, lastArray, ~(uint64_t)(BINARY_SCENE_ALIGNMENT - 1))));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, keyframeOffset), ~(uint64_t)(BINARY_SCENE_ALIGNMENT - 1))));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, planeOffset), (uint64_t)data.size())));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, sphereCount), (uint32_t)0x40000000)));
+	SELF_CHECK(!Accepts(Patch(data, offsetof(BinarySceneHeader, keyframeCount), (uint32_t)0xFFFFFFFF)));
+
+	//The same from files, which are mapped
+	const char* path = "selftest_scene.rtscene";
+	SELF_CHECK(BinaryScene::Write(*info, path));
+	scene = BinaryScene::Open(path);
+	SELF_CHECK(scene != nullptr && scene->GetSphereCount() == 3 && ArraysAligned(*scene));
+	delete scene;
+
+	{
+		std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		ofs.write(truncated.data(), truncated.size());
+	}
+	SELF_CHECK(BinaryScene::Open(path) == nullptr);
+	remove(path);
+	SELF_CHECK(BinaryScene::Open(path) == nullptr);
+
+	info->Cleanup();
+	delete info;
+}
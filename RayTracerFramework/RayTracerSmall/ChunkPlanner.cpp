@@ -0,0 +1,162 @@
+#include "ChunkPlanner.h"
+#include <algorithm>
+
+ChunkPlanner::ChunkPlanner(const RenderConfig& config)
+{
+	_height = config.height;
+	_maxChunkRows = config.chunkHeight;
+	_mode = config.balanceMode;
+	_workerChunks.resize(config.threadCount);
+	_rowTimes.resize(config.height, 0.0f);
+
+	PlanEven();
+}
+
+void ChunkPlanner::Plan()
+{
+	if (_mode == BALANCE_COST) PlanFromCosts();
+	else if (_mode == BALANCE_LPT) PlanLongestFirst();
+	else PlanEven();
+}
+
+unsigned ChunkPlanner::GetRowCount(unsigned worker) const
+{
+	unsigned rows = 0;
+	for (const Chunk& chunk : _workerChunks[worker]) rows += chunk.GetRowCount();
+	return rows;
+}
+
+double ChunkPlanner::GetCost(const Chunk& chunk) const
+{
+	double cost = 0.0;
+	for (unsigned y = chunk.startY; y < chunk.endY; ++y) cost += _rowTimes[y];
+	return cost;
+}
+
+void ChunkPlanner::RecordChunkTime(const Chunk& chunk, float seconds)
+{
+	if (chunk.GetRowCount() == 0) return;
+
+	float rowTime = seconds / chunk.GetRowCount();
+	for (unsigned y = chunk.startY; y < chunk.endY; ++y) _rowTimes[y] = rowTime;
+}
+
+void ChunkPlanner::PlanEven()
+{
+	unsigned count = (unsigned)_workerChunks.size();
+	unsigned rows = _height / count;
+	unsigned remainder = _height % count;
+
+	//The first "remainder" bands take one extra row each, so no band is more than a row taller than another
+	unsigned startY = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		unsigned endY = startY + rows + (i < remainder ? 1 : 0);
+		_workerChunks[i].assign(1, { startY, endY });
+		startY = endY;
+	}
+}
+
+void ChunkPlanner::PlanFromCosts()
+{
+	unsigned count = (unsigned)_workerChunks.size();
+
+	//Running total of the row times, prefix[y] is the time of every row above y
+	std::vector<double> prefix(_height + 1, 0.0);
+	for (unsigned y = 0; y < _height; ++y) prefix[y + 1] = prefix[y] + _rowTimes[y];
+
+	double total = prefix[_height];
+	//Nothing measured yet, or fewer rows than bands
+	if (total <= 0.0 || _height < count) {
+		PlanEven();
+		return;
+	}
+
+	//A band can be no shorter than its share of the time. It can have to be longer when the buffers cannot hold
+	//enough of the cheap rows, so the longest band the plan can have is found by bisection
+	double low = total / count;
+	double high = total;
+	for (int i = 0; i < COST_PLAN_STEPS; ++i) {
+		double middle = (low + high) * 0.5;
+		if (PlaceBands(prefix, middle)) high = middle;
+		else low = middle;
+	}
+	PlaceBands(prefix, high);
+}
+
+bool ChunkPlanner::PlaceBands(const std::vector<double>& prefix, double maxCost)
+{
+	unsigned count = (unsigned)_workerChunks.size();
+
+	unsigned startY = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		//Bands still to be placed after this one
+		unsigned remaining = count - i - 1;
+		unsigned endY = _height;
+
+		if (remaining > 0) {
+			//Leave at least a row for every later band, and no more rows than the later bands can hold
+			unsigned minEnd = startY + 1;
+			if (_height > remaining * _maxChunkRows) minEnd = std::max(minEnd, _height - remaining * _maxChunkRows);
+			unsigned maxEnd = std::min(startY + _maxChunkRows, _height - remaining);
+
+			//Take rows until the next one would go over the cost
+			endY = minEnd;
+			while (endY < maxEnd && prefix[endY + 1] - prefix[startY] <= maxCost) ++endY;
+		}
+
+		if (prefix[endY] - prefix[startY] > maxCost) return false;
+
+		_workerChunks[i].assign(1, { startY, endY });
+		startY = endY;
+	}
+
+	return true;
+}
+
+void ChunkPlanner::PlanLongestFirst()
+{
+	unsigned count = (unsigned)_workerChunks.size();
+
+	//Tiles are never taller than an even band, which guarantees a worker always has room for the next one
+	unsigned tileRows = std::min((unsigned)LPT_TILE_ROWS, std::max(1u, _height / count));
+
+	std::vector<Chunk> tiles;
+	std::vector<double> tileCosts;
+	for (unsigned startY = 0; startY < _height; startY += tileRows) {
+		Chunk tile = { startY, std::min(startY + tileRows, _height) };
+		tiles.push_back(tile);
+		//Tiles of the first frame all cost the same, the plan then deals them out in turn
+		tileCosts.push_back(GetCost(tile));
+	}
+
+	//Most expensive first, ties keep frame order so the plan is the same on every run
+	std::vector<unsigned> order(tiles.size());
+	for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&tileCosts](unsigned a, unsigned b) { return tileCosts[a] > tileCosts[b]; });
+
+	std::vector<double> load(count, 0.0);
+	std::vector<unsigned> rows(count, 0);
+	for (std::vector<Chunk>& chunks : _workerChunks) chunks.clear();
+
+	for (unsigned index : order) {
+		const Chunk& tile = tiles[index];
+
+		//The worker with the least predicted time that can still fit the tile in its buffer. Ties go to the worker
+		//with the fewest rows, so tiles that cost the same are dealt out in turn instead of filling one buffer first
+		unsigned best = count;
+		for (unsigned w = 0; w < count; ++w) {
+			if (rows[w] + tile.GetRowCount() > _maxChunkRows) continue;
+			if (best == count || load[w] < load[best] || (load[w] == load[best] && rows[w] < rows[best])) best = w;
+		}
+
+		_workerChunks[best].push_back(tile);
+		load[best] += tileCosts[index];
+		rows[best] += tile.GetRowCount();
+	}
+
+	//Render each worker's tiles top to bottom, it makes no difference to the balance and keeps the
+	//writes into the frame in order
+	for (std::vector<Chunk>& chunks : _workerChunks) {
+		std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.startY < b.startY; });
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "RenderConfig.h"
+
+//Rows in each tile of the longest-processing-time plan, smaller tiles balance better but cost more bookkeeping
+#define LPT_TILE_ROWS 4
+//Bisection steps of the cost plan's search for its longest band, each halves the gap to the best plan
+#define COST_PLAN_STEPS 40
+
+//A band of rows of the frame, [startY, endY)
+struct Chunk {
+	unsigned startY;
+	unsigned endY;
+
+	unsigned GetRowCount() const { return endY - startY; }
+};
+
+//Splits each frame between the workers. Every worker gets a list of bands that together cover the
+//whole frame, heights that do not divide by the thread count spread the remainder over the first bands.
+class ChunkPlanner
+{
+public:
+	ChunkPlanner(const RenderConfig& config);
+
+	//Plans the bands of the next frame.
+	//BALANCE_EVEN gives each worker one band of the same height.
+	//BALANCE_COST gives each worker one band holding about the same render time as measured on the previous frame,
+	//or as close as the buffer sizes allow, keeping the longest band as short as it can be.
+	//BALANCE_LPT splits the frame into small tiles and hands them out most expensive first, each to the worker
+	//with the least predicted time so far.
+	void Plan();
+
+	//Stores how long a row took, called by the workers while they render a frame
+	void RecordRowTime(unsigned row, float seconds) { _rowTimes[row] = seconds; }
+	//Spreads the time of a whole band over its rows, for workers that cannot time each row (parallel_for)
+	void RecordChunkTime(const Chunk& chunk, float seconds);
+
+	unsigned GetWorkerCount() const { return (unsigned)_workerChunks.size(); }
+	//Bands of one worker, the worker's buffer holds them one after another in this order
+	const std::vector<Chunk>& GetChunks(unsigned worker) const { return _workerChunks[worker]; }
+	unsigned GetRowCount(unsigned worker) const;
+
+	//True if the workers should time their rows for the next plan
+	bool IsMeasuring() const { return _mode != BALANCE_EVEN; }
+private:
+	void PlanEven();
+	void PlanFromCosts();
+	//Places the cost plan's bands top to bottom, each taking rows until the next would put it over maxCost.
+	//prefix[y] is the time of every row above y. Returns false if a band has to go over maxCost to leave the
+	//later bands no more rows than their buffers hold
+	bool PlaceBands(const std::vector<double>& prefix, double maxCost);
+	void PlanLongestFirst();
+
+	//Sum of the measured row times of a band
+	double GetCost(const Chunk& chunk) const;
+
+	unsigned _height;
+	//Most rows a worker's buffer can hold (RenderConfig::chunkHeight)
+	unsigned _maxChunkRows;
+	BalanceMode _mode;
+
+	std::vector<std::vector<Chunk>> _workerChunks;
+	//Render time of every row of the last frame. All zero until a frame has been measured
+	std::vector<float> _rowTimes;
+};
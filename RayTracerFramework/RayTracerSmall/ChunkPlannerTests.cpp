@@ -0,0 +1,182 @@
+#include "SelfTest.h"
+#include "ChunkPlanner.h"
+#include <algorithm>
+
+static RenderConfig CreatePlannerConfig(unsigned height, unsigned threads, BalanceMode mode)
+{
+	RenderConfig config(64, height, threads);
+	config.balanceMode = mode;
+	return config;
+}
+
+//True if the workers' bands cover every row of the frame once and each worker's rows fit in its buffer
+static bool CoversFrame(const ChunkPlanner& planner, const RenderConfig& config)
+{
+	std::vector<int> covered(config.height, 0);
+	for (unsigned w = 0; w < planner.GetWorkerCount(); ++w) {
+		if (planner.GetRowCount(w) > config.chunkHeight) return false;
+		for (const Chunk& chunk : planner.GetChunks(w)) {
+			if (chunk.startY > chunk.endY || chunk.endY > config.height) return false;
+			for (unsigned y = chunk.startY; y < chunk.endY; ++y) covered[y]++;
+		}
+	}
+	return std::all_of(covered.begin(), covered.end(), [](int count) { return count == 1; });
+}
+
+//True if every worker's tiles are no taller than LPT_TILE_ROWS and run top to bottom
+static bool TilesInOrder(const ChunkPlanner& planner)
+{
+	for (unsigned w = 0; w < planner.GetWorkerCount(); ++w) {
+		const std::vector<Chunk>& chunks = planner.GetChunks(w);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			if (chunks[i].GetRowCount() > LPT_TILE_ROWS) return false;
+			if (i > 0 && chunks[i].startY < chunks[i - 1].endY) return false;
+		}
+	}
+	return true;
+}
+
+//Render time of the most loaded worker, from the row times given to the planner
+static double GetLongestWorker(const ChunkPlanner& planner, const std::vector<float>& rowTimes)
+{
+	double longest = 0.0;
+	for (unsigned w = 0; w < planner.GetWorkerCount(); ++w) {
+		double cost = 0.0;
+		for (const Chunk& chunk : planner.GetChunks(w)) {
+			for (unsigned y = chunk.startY; y < chunk.endY; ++y) cost += rowTimes[y];
+		}
+		longest = std::max(longest, cost);
+	}
+	return longest;
+}
+
+//Rows in the top quarter of the frame cost ten times the others, like a frame with the detail at the top
+static std::vector<float> CreateRowTimes(ChunkPlanner& planner, unsigned height)
+{
+	std::vector<float> rowTimes(height);
+	for (unsigned y = 0; y < height; ++y) {
+		rowTimes[y] = y < height / 4 ? 10.0f : 1.0f;
+		planner.RecordRowTime(y, rowTimes[y]);
+	}
+	return rowTimes;
+}
+
+static double GetTotal(const std::vector<float>& rowTimes)
+{
+	double total = 0.0;
+	for (float time : rowTimes) total += time;
+	return total;
+}
+
+void SelfTest::TestChunkPlanner()
+{
+	const unsigned heights[] = { 1, 7, 480, 481, 1080 };
+	const unsigned threadCounts[] = { 1, 3, 8, 16 };
+
+	for (unsigned height : heights) {
+		for (unsigned threads : threadCounts) {
+			//Even bands, one per worker and no more than a row apart
+			RenderConfig config = CreatePlannerConfig(height, threads, BALANCE_EVEN);
+			ChunkPlanner even(config);
+			even.Plan();
+			SELF_CHECK(CoversFrame(even, config));
+			unsigned fewest = height, most = 0;
+			for (unsigned w = 0; w < even.GetWorkerCount(); ++w) {
+				SELF_CHECK(even.GetChunks(w).size() == 1);
+				fewest = std::min(fewest, even.GetRowCount(w));
+				most = std::max(most, even.GetRowCount(w));
+			}
+			SELF_CHECK(most - fewest <= 1);
+
+			//Before a frame is measured the cost plan is the even plan
+			config = CreatePlannerConfig(height, threads, BALANCE_COST);
+			ChunkPlanner cost(config);
+			cost.Plan();
+			SELF_CHECK(CoversFrame(cost, config));
+			for (unsigned w = 0; w < cost.GetWorkerCount(); ++w) SELF_CHECK(cost.GetRowCount(w) == even.GetRowCount(w));
+
+			//Measured, the longest band is never longer than the even plan's
+			std::vector<float> rowTimes = CreateRowTimes(cost, height);
+			cost.Plan();
+			SELF_CHECK(CoversFrame(cost, config));
+			for (unsigned w = 0; w < cost.GetWorkerCount(); ++w) SELF_CHECK(cost.GetChunks(w).size() == 1);
+			SELF_CHECK(GetLongestWorker(cost, rowTimes) <= GetLongestWorker(even, rowTimes));
+
+			//Longest first, before and after a frame is measured
+			config = CreatePlannerConfig(height, threads, BALANCE_LPT);
+			ChunkPlanner lpt(config);
+			lpt.Plan();
+			SELF_CHECK(CoversFrame(lpt, config) && TilesInOrder(lpt));
+			CreateRowTimes(lpt, height);
+			lpt.Plan();
+			SELF_CHECK(CoversFrame(lpt, config) && TilesInOrder(lpt));
+			SELF_CHECK(GetLongestWorker(lpt, rowTimes) <= GetLongestWorker(even, rowTimes));
+		}
+	}
+
+	//Unmeasured tiles all cost the same and are dealt out in turn, so the workers get the same number of rows
+	{
+		RenderConfig config = CreatePlannerConfig(480, 8, BALANCE_LPT);
+		ChunkPlanner lpt(config);
+		lpt.Plan();
+		for (unsigned w = 0; w < lpt.GetWorkerCount(); ++w) SELF_CHECK(lpt.GetRowCount(w) == 60);
+	}
+
+	//Measured, no worker is more than a tile over its share of the time, and the plan is the same every time
+	{
+		RenderConfig config = CreatePlannerConfig(480, 8, BALANCE_LPT);
+		ChunkPlanner lpt(config);
+		std::vector<float> rowTimes(config.height);
+		for (unsigned y = 0; y < config.height; ++y) {
+			rowTimes[y] = y % 37 == 0 ? 20.0f : 1.0f + (y % 5);
+			lpt.RecordRowTime(y, rowTimes[y]);
+		}
+		lpt.Plan();
+		SELF_CHECK(GetLongestWorker(lpt, rowTimes) <= GetTotal(rowTimes) / 8 + 20.0 * LPT_TILE_ROWS);
+
+		std::vector<std::vector<Chunk>> first;
+		for (unsigned w = 0; w < lpt.GetWorkerCount(); ++w) first.push_back(lpt.GetChunks(w));
+		lpt.Plan();
+		bool same = true;
+		for (unsigned w = 0; w < lpt.GetWorkerCount(); ++w) {
+			const std::vector<Chunk>& chunks = lpt.GetChunks(w);
+			same = same && chunks.size() == first[w].size();
+			for (size_t i = 0; same && i < chunks.size(); ++i) same = chunks[i].startY == first[w][i].startY && chunks[i].endY == first[w][i].endY;
+		}
+		SELF_CHECK(same);
+	}
+
+	//When the buffers are not what limits the bands, each is within a row of its share of the time
+	{
+		RenderConfig config = CreatePlannerConfig(480, 8, BALANCE_COST);
+		ChunkPlanner cost(config);
+		std::vector<float> rowTimes(config.height);
+		for (unsigned y = 0; y < config.height; ++y) {
+			rowTimes[y] = 1.0f + (float)y / config.height;
+			cost.RecordRowTime(y, rowTimes[y]);
+		}
+		cost.Plan();
+		SELF_CHECK(GetLongestWorker(cost, rowTimes) <= GetTotal(rowTimes) / 8 + 2.0);
+	}
+
+	//When they are, the bands that cannot take more cheap rows leave the rest of the time to share between the
+	//others. 480 rows on 3 workers hold at most 320 each: 320 cheap rows, then 620 for each of the other two
+	{
+		RenderConfig config = CreatePlannerConfig(480, 3, BALANCE_COST);
+		ChunkPlanner cost(config);
+		std::vector<float> rowTimes = CreateRowTimes(cost, config.height);
+		cost.Plan();
+		SELF_CHECK(config.chunkHeight == 320);
+		SELF_CHECK(GetLongestWorker(cost, rowTimes) == 620.0);
+	}
+
+	//A band timed as a whole shares its time over its rows
+	RenderConfig config = CreatePlannerConfig(480, 8, BALANCE_COST);
+	ChunkPlanner planner(config);
+	for (unsigned w = 0; w < planner.GetWorkerCount(); ++w) {
+		for (const Chunk& chunk : planner.GetChunks(w)) planner.RecordChunkTime(chunk, w == 0 ? 600.0f : 60.0f);
+	}
+	planner.Plan();
+	SELF_CHECK(CoversFrame(planner, config));
+	SELF_CHECK(planner.GetRowCount(0) < planner.GetRowCount(7));
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include "Vec3.h"
+
+//Precision of the square roots, normalizes and Fresnel power used by trace
+enum MathMode {
+	//The original maths, 1/sqrt in double and pow. Frames match the reference renders
+	MATH_EXACT,
+	//Integer power expansion and rsqrt with Newton-Raphson refinement, within a few ulp of exact
+	MATH_FAST,
+	//Raw rsqrt estimates, about 12 bits on SSE and 8 on NEON
+	MATH_FASTEST,
+	MATH_MODE_COUNT
+};
+
+//Hardware reciprocal square root estimate
+inline float RsqrtEstimate(float n)
+{
+#if defined VEC3_SSE
+	return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(n)));
+#elif defined VEC3_NEON
+	return vget_lane_f32(vrsqrte_f32(vdup_n_f32(n)), 0);
+#else
+	//No estimate instruction, use the bit trick which is about as accurate as the NEON estimate
+	unsigned int bits;
+	memcpy(&bits, &n, sizeof(bits));
+	bits = 0x5f3759df - (bits >> 1);
+	float r;
+	memcpy(&r, &bits, sizeof(r));
+	return r;
+#endif
+}
+
+//Reciprocal square root at the precision of the mode
+template<MathMode mode>
+inline float Rsqrt(float n)
+{
+	if (mode == MATH_EXACT) return (float)(1 / sqrt((double)n));
+	if (mode == MATH_FASTEST) return RsqrtEstimate(n);
+
+#if defined VEC3_SSE || defined VEC3_NEON
+	return SimdRsqrt(n);
+#else
+	float r = RsqrtEstimate(n);
+	r = r * (1.5f - 0.5f * n * r * r);
+	return r * (1.5f - 0.5f * n * r * r);
+#endif
+}
+
+//Returns a double as the original refraction code subtracted the double sqrt, exact mode has to
+//keep that to reproduce the reference frames
+template<MathMode mode>
+inline double Sqrt(float n)
+{
+	if (mode == MATH_EXACT) return sqrt((double)n);
+	//sqrt(n) = n * 1/sqrt(n). Negative n gives NaN like sqrt does, 0 is handled as rsqrt(0) is infinite
+	if (n == 0.0f) return 0.0f;
+	return n * Rsqrt<mode>(n);
+}
+
+template<MathMode mode>
+inline void Normalize(Vec3f& v)
+{
+	float nor2 = v.length2();
+	if (nor2 > 0) v = v * Rsqrt<mode>(nor2);
+}
+
+//x cubed, used for the Fresnel term
+template<MathMode mode>
+inline float Pow3(float x)
+{
+	if (mode == MATH_EXACT) return (float)pow((double)x, 3.0);
+	return x * x * x;
+}
+
+//Runtime choice of Normalize, for code that is not specialised on the mode
+inline void Normalize(MathMode mode, Vec3f& v)
+{
+	switch (mode) {
+	case MATH_FAST: Normalize<MATH_FAST>(v); break;
+	case MATH_FASTEST: Normalize<MATH_FASTEST>(v); break;
+	default: Normalize<MATH_EXACT>(v); break;
+	}
+}
+
+inline const char* GetMathModeName(MathMode mode)
+{
+	switch (mode) {
+	case MATH_FAST: return "fast";
+	case MATH_FASTEST: return "fastest";
+	default: return "exact";
+	}
+}
@@ -0,0 +1,365 @@
+#include "FrameRing.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined __linux__
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FRAME_RING_MAGIC 0x474E5252
+#define FRAME_RING_VERSION 1
+//Slots start on cache line boundaries so two shards copying into neighbouring slots never share a line
+#define FRAME_RING_ALIGNMENT 64
+
+//Frame number a shard pushes to say it has finished
+#define FRAME_RING_FINISHED -1
+
+enum ShardState {
+	SHARD_NOT_STARTED,
+	SHARD_RUNNING,
+	SHARD_FINISHED
+};
+
+#if defined __linux__
+struct FrameRingHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t shardCount;
+	uint32_t frameCount;
+	uint32_t slotCount;
+	uint32_t reserved;
+	uint64_t slotSize;
+	uint64_t slotOffset;
+	//Taken while a shard copies a frame in. Robust so a shard that dies holding it does not lock the others out
+	pthread_mutex_t lock;
+	//Slots the shards can write to, and slots holding a frame for the assembler
+	sem_t freeSlots;
+	sem_t filledSlots;
+	//Next slot to write, only moved once the copy is complete, and next slot to read
+	uint32_t head;
+	uint32_t tail;
+	pid_t assembler;
+	pid_t shardPids[FRAME_RING_MAX_SHARDS];
+	uint32_t shardStates[FRAME_RING_MAX_SHARDS];
+	//Followed by one byte per frame marking the frames that are already complete, then the slots
+};
+
+struct FrameSlot {
+	int32_t frame;
+	uint32_t shard;
+	uint64_t size;
+	//Followed by the encoded frame
+};
+
+static size_t AlignSize(size_t size)
+{
+	return (size + FRAME_RING_ALIGNMENT - 1) / FRAME_RING_ALIGNMENT * FRAME_RING_ALIGNMENT;
+}
+
+//Absolute time a second from now, for the timed semaphore waits
+static timespec OneSecondFromNow()
+{
+	timespec time;
+	clock_gettime(CLOCK_REALTIME, &time);
+	time.tv_sec += 1;
+	return time;
+}
+
+static bool ProcessExists(pid_t pid)
+{
+	return kill(pid, 0) == 0 || errno != ESRCH;
+}
+#else
+struct FrameRingHeader {
+	int unused;
+};
+#endif
+
+std::string FrameRing::GetName(unsigned long long renderHash)
+{
+	//Named after the render so shards started with different settings cannot join the wrong ring
+	char name[64];
+	snprintf(name, sizeof(name), "/raytracer_%016llx", renderHash);
+	return name;
+}
+
+FrameRing* FrameRing::Create(unsigned long long renderHash, int shardCount, int frameCount, size_t frameSize, const bool* completeFrames)
+{
+#if defined __linux__
+	if (shardCount < 1 || shardCount > FRAME_RING_MAX_SHARDS) {
+		std::cout << "[ERROR: FrameRing.cpp: shard count must be from 1 to " << FRAME_RING_MAX_SHARDS << std::endl;
+		return nullptr;
+	}
+
+	FrameRing* ring = new FrameRing();
+	ring->_name = GetName(renderHash);
+	ring->_owner = true;
+
+	const uint32_t slotCount = shardCount * FRAME_RING_SLOTS_PER_SHARD;
+	const size_t slotSize = AlignSize(sizeof(FrameSlot) + frameSize);
+	const size_t slotOffset = AlignSize(sizeof(FrameRingHeader) + frameCount);
+	ring->_size = slotOffset + slotSize * slotCount;
+
+	//A ring left behind by an assembler that crashed is replaced
+	shm_unlink(ring->_name.c_str());
+	int fd = shm_open(ring->_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1 || ftruncate(fd, ring->_size) != 0) {
+		std::cout << "[ERROR: FrameRing.cpp: could not create shared memory " << ring->_name << std::endl;
+		if (fd != -1) close(fd);
+		ring->_owner = false;
+		delete ring;
+		return nullptr;
+	}
+
+	void* view = mmap(nullptr, ring->_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		std::cout << "[ERROR: FrameRing.cpp: could not map shared memory " << ring->_name << std::endl;
+		delete ring;
+		return nullptr;
+	}
+
+	ring->_data = (char*)view;
+	ring->_header = (FrameRingHeader*)view;
+	FrameRingHeader* header = ring->_header;
+	memset(header, 0, sizeof(FrameRingHeader));
+	header->version = FRAME_RING_VERSION;
+	header->shardCount = shardCount;
+	header->frameCount = frameCount;
+	header->slotCount = slotCount;
+	header->slotSize = slotSize;
+	header->slotOffset = slotOffset;
+	header->assembler = getpid();
+
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&header->lock, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+	sem_init(&header->freeSlots, 1, slotCount);
+	sem_init(&header->filledSlots, 1, 0);
+
+	char* complete = ring->_data + sizeof(FrameRingHeader);
+	for (int i = 0; i < frameCount; ++i) complete[i] = completeFrames != nullptr && completeFrames[i] ? 1 : 0;
+
+	//Written last, shards that open the ring early wait until it is set
+	__atomic_store_n(&header->magic, FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+	return ring;
+#else
+	std::cout << "[ERROR: FrameRing.cpp: sharding needs POSIX shared memory, it is only available on linux" << std::endl;
+	return nullptr;
+#endif
+}
+
+FrameRing* FrameRing::Open(unsigned long long renderHash, int shard, int shardCount)
+{
+#if defined __linux__
+	FrameRing* ring = new FrameRing();
+	ring->_name = GetName(renderHash);
+	ring->_shard = shard;
+
+	//Wait for the assembler to create the ring and finish setting it up
+	time_t start = time(nullptr);
+	int fd = -1;
+	struct stat st;
+	while (true) {
+		if (fd == -1) fd = shm_open(ring->_name.c_str(), O_RDWR, 0600);
+		if (fd != -1 && fstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(FrameRingHeader)) {
+			void* view = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (view != MAP_FAILED) {
+				if (__atomic_load_n(&((FrameRingHeader*)view)->magic, __ATOMIC_ACQUIRE) == FRAME_RING_MAGIC) {
+					ring->_data = (char*)view;
+					ring->_header = (FrameRingHeader*)view;
+					ring->_size = st.st_size;
+					break;
+				}
+				munmap(view, st.st_size);
+			}
+		}
+
+		if (time(nullptr) - start > FRAME_RING_OPEN_RETRY) {
+			std::cout << "[ERROR: FrameRing.cpp: no assembler is running for this scene and these settings, start one with --assemble" << std::endl;
+			if (fd != -1) close(fd);
+			delete ring;
+			return nullptr;
+		}
+		usleep(100000);
+	}
+	close(fd);
+
+	FrameRingHeader* header = ring->_header;
+	if (header->version != FRAME_RING_VERSION || (int)header->shardCount != shardCount || shard < 0 || shard >= shardCount) {
+		std::cout << "[ERROR: FrameRing.cpp: the assembler was started for " << header->shardCount << " shards, not " << shardCount << std::endl;
+		delete ring;
+		return nullptr;
+	}
+
+	//A shard that finished or crashed has already been counted by the assembler, so it cannot join again
+	if (header->shardStates[shard] == SHARD_FINISHED || (header->shardStates[shard] == SHARD_RUNNING && ProcessExists(header->shardPids[shard]))) {
+		std::cout << "[ERROR: FrameRing.cpp: shard " << shard << " has already run for this assembler" << std::endl;
+		delete ring;
+		return nullptr;
+	}
+
+	header->shardPids[shard] = getpid();
+	__atomic_store_n(&header->shardStates[shard], (uint32_t)SHARD_RUNNING, __ATOMIC_RELEASE);
+	return ring;
+#else
+	std::cout << "[ERROR: FrameRing.cpp: sharding needs POSIX shared memory, it is only available on linux" << std::endl;
+	return nullptr;
+#endif
+}
+
+FrameRing::~FrameRing()
+{
+#if defined __linux__
+	if (_data != nullptr) {
+		if (_owner) {
+			pthread_mutex_destroy(&_header->lock);
+			sem_destroy(&_header->freeSlots);
+			sem_destroy(&_header->filledSlots);
+		}
+		munmap(_data, _size);
+	}
+	if (_owner) shm_unlink(_name.c_str());
+#endif
+	_data = nullptr;
+	_header = nullptr;
+}
+
+int FrameRing::GetFrameCount() const
+{
+#if defined __linux__
+	return _header->frameCount;
+#else
+	return 0;
+#endif
+}
+
+bool FrameRing::IsFrameComplete(int frame) const
+{
+#if defined __linux__
+	return frame >= 0 && frame < (int)_header->frameCount && _data[sizeof(FrameRingHeader) + frame] != 0;
+#else
+	return false;
+#endif
+}
+
+bool FrameRing::Push(int frame, const char* data, size_t size)
+{
+#if defined __linux__
+	FrameRingHeader* header = _header;
+	if (sizeof(FrameSlot) + size > header->slotSize) {
+		std::cout << "[ERROR: FrameRing.cpp: frame " << frame << " is larger than the ring slots" << std::endl;
+		return false;
+	}
+
+	//Wait for a free slot, giving up if the assembler has gone
+	while (true) {
+		timespec timeout = OneSecondFromNow();
+		if (sem_timedwait(&header->freeSlots, &timeout) == 0) break;
+		if (errno == ETIMEDOUT && !ProcessExists(header->assembler)) {
+			std::cout << "[ERROR: FrameRing.cpp: the assembler has exited" << std::endl;
+			return false;
+		}
+	}
+
+	if (pthread_mutex_lock(&header->lock) == EOWNERDEAD) {
+		//The shard holding the lock died before it moved the head, so the slot it was writing is simply reused.
+		//It had taken a free slot first, that one is given back or the ring would stay a slot short
+		pthread_mutex_consistent(&header->lock);
+		sem_post(&header->freeSlots);
+	}
+
+	FrameSlot* slot = (FrameSlot*)(_data + header->slotOffset + header->slotSize * header->head);
+	slot->frame = frame;
+	slot->shard = _shard;
+	slot->size = size;
+	if (size > 0) memcpy((char*)slot + sizeof(FrameSlot), data, size);
+	header->head = (header->head + 1) % header->slotCount;
+
+	pthread_mutex_unlock(&header->lock);
+	sem_post(&header->filledSlots);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FrameRing::Finish()
+{
+#if defined __linux__
+	Push(FRAME_RING_FINISHED, nullptr, 0);
+#endif
+}
+
+bool FrameRing::AnyShardRunning()
+{
+#if defined __linux__
+	for (uint32_t i = 0; i < _header->shardCount; ++i) {
+		uint32_t state = __atomic_load_n(&_header->shardStates[i], __ATOMIC_ACQUIRE);
+		if (state == SHARD_RUNNING && !ProcessExists(_header->shardPids[i])) {
+			std::cout << "[WARNING: FrameRing.cpp: shard " << i << " exited before finishing, its missing frames are rendered by the next run" << std::endl;
+			_header->shardStates[i] = SHARD_FINISHED;
+			_shardsDone++;
+		}
+	}
+	return _shardsDone < (int)_header->shardCount;
+#else
+	return false;
+#endif
+}
+
+bool FrameRing::Pop(int& frame, const char*& data, size_t& size)
+{
+#if defined __linux__
+	FrameRingHeader* header = _header;
+
+	//The slot given out last time has been written out, let the shards have it back
+	if (_poppedSlot >= 0) {
+		_poppedSlot = -1;
+		sem_post(&header->freeSlots);
+	}
+
+	while (_shardsDone < (int)header->shardCount) {
+		timespec timeout = OneSecondFromNow();
+		if (sem_timedwait(&header->filledSlots, &timeout) != 0) {
+			if (errno == ETIMEDOUT && !AnyShardRunning()) return false;
+			continue;
+		}
+
+		_poppedSlot = header->tail;
+		header->tail = (header->tail + 1) % header->slotCount;
+		const FrameSlot* slot = (const FrameSlot*)(_data + header->slotOffset + header->slotSize * _poppedSlot);
+
+		if (slot->frame == FRAME_RING_FINISHED) {
+			if (slot->shard < header->shardCount && header->shardStates[slot->shard] != SHARD_FINISHED) {
+				header->shardStates[slot->shard] = SHARD_FINISHED;
+				_shardsDone++;
+			}
+			_poppedSlot = -1;
+			sem_post(&header->freeSlots);
+			continue;
+		}
+
+		frame = slot->frame;
+		size = (size_t)slot->size;
+		data = (const char*)slot + sizeof(FrameSlot);
+		return true;
+	}
+
+	return false;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//Most shard processes one ring can be shared between
+#define FRAME_RING_MAX_SHARDS 64
+//Slots in the ring for each shard, lets a shard start its next frame while the assembler is still writing
+#define FRAME_RING_SLOTS_PER_SHARD 2
+//Seconds a shard keeps trying to open the ring, so shards can be started before the assembler
+#define FRAME_RING_OPEN_RETRY 10
+
+struct FrameRingHeader;
+
+//Encoded frames passed from shard processes to one assembler process through POSIX shared memory.
+//The assembler creates the ring, each shard renders its share of the frames and copies every finished
+//frame into a free slot, and the assembler drains the slots in order into the frame files.
+//Slots are handed out with process shared semaphores, so the shards never wait on each other except for
+//the copy of one frame. A shard that dies while copying has its slot given back by the next Push, one that
+//dies between taking a free slot and taking the lock loses that slot for the rest of the render.
+//Linux only, on other platforms Create and Open print an error and return nullptr.
+class FrameRing
+{
+public:
+	//Creates the ring for the render identified by renderHash. frameSize is the most bytes one encoded frame
+	//can take. completeFrames marks, for each frame, the ones that are already rendered and can be skipped
+	static FrameRing* Create(unsigned long long renderHash, int shardCount, int frameCount, size_t frameSize, const bool* completeFrames);
+	//Opens the ring of an assembler for the same render as a shard
+	static FrameRing* Open(unsigned long long renderHash, int shard, int shardCount);
+
+	//Unmaps the ring, the assembler also removes it
+	~FrameRing();
+
+	int GetFrameCount() const;
+	bool IsFrameComplete(int frame) const;
+
+	//Shard side. Waits for a free slot and copies the frame into it
+	bool Push(int frame, const char* data, size_t size);
+	//Tells the assembler this shard has no more frames
+	void Finish();
+
+	//Assembler side. Waits for the next frame and gives a pointer to it inside the ring, valid until the
+	//next call. Returns false once every shard has finished or exited
+	bool Pop(int& frame, const char*& data, size_t& size);
+
+	FrameRing(const FrameRing&) = delete;
+	FrameRing& operator=(const FrameRing&) = delete;
+private:
+	FrameRing() = default;
+
+	static std::string GetName(unsigned long long renderHash);
+
+	//Checks the shards that have not finished are still running, so the assembler does not wait forever on a crashed one
+	bool AnyShardRunning();
+
+	FrameRingHeader* _header = nullptr;
+	char* _data = nullptr;
+	size_t _size = 0;
+	std::string _name;
+	bool _owner = false;
+	int _shard = -1;
+	//Assembler side, the slot handed out by the last Pop, released by the next one
+	int _poppedSlot = -1;
+	int _shardsDone = 0;
+};
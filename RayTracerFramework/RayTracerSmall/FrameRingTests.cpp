@@ -0,0 +1,92 @@
+#include "SelfTest.h"
+#include "FrameRing.h"
+#include <iostream>
+#include <vector>
+
+#if defined __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+//Frames the shard pushes, more than the ring's slots so it has to wait for the assembler to drain them
+#define SELFTEST_RING_FRAMES 6
+
+static size_t TestFrameSize(int frame)
+{
+	return frame == 3 ? 0 : 100 + frame * 10;
+}
+
+static char TestFrameByte(int frame, size_t i)
+{
+	return (char)(frame * 31 + i);
+}
+
+void SelfTest::TestFrameRing()
+{
+#if defined __linux__
+	const unsigned long long hash = 0x5e1f7e5700000000ull | (unsigned long long)getpid();
+	const bool completeFrames[SELFTEST_RING_FRAMES] = { false, true, false, false, false, false };
+	FrameRing* ring = FrameRing::Create(hash, 2, SELFTEST_RING_FRAMES, TestFrameSize(SELFTEST_RING_FRAMES - 1), completeFrames);
+	SELF_CHECK(ring != nullptr);
+	if (ring == nullptr) return;
+	SELF_CHECK(ring->GetFrameCount() == SELFTEST_RING_FRAMES);
+	SELF_CHECK(ring->IsFrameComplete(1) && !ring->IsFrameComplete(0) && !ring->IsFrameComplete(SELFTEST_RING_FRAMES));
+
+	//The children would print anything still in the buffer a second time
+	std::cout.flush();
+
+	//Shard 1 joins and exits without finishing, like a shard that crashed
+	pid_t crashed = fork();
+	if (crashed == 0) {
+		FrameRing* shard = FrameRing::Open(hash, 1, 2);
+		_exit(shard != nullptr ? 0 : 1);
+	}
+	int status = 0;
+	waitpid(crashed, &status, 0);
+	SELF_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	//Shard 0 pushes every frame and finishes
+	pid_t pusher = fork();
+	if (pusher == 0) {
+		FrameRing* shard = FrameRing::Open(hash, 0, 2);
+		if (shard == nullptr) _exit(1);
+		bool pushed = true;
+		std::vector<char> data;
+		for (int frame = 0; frame < SELFTEST_RING_FRAMES; ++frame) {
+			data.resize(TestFrameSize(frame));
+			for (size_t i = 0; i < data.size(); ++i) data[i] = TestFrameByte(frame, i);
+			pushed = pushed && shard->Push(frame, data.data(), data.size());
+		}
+		//A frame larger than the slots, which are only rounded up to the cache line, is refused
+		data.resize(TestFrameSize(SELFTEST_RING_FRAMES - 1) + 1000);
+		pushed = pushed && !shard->Push(0, data.data(), data.size());
+		shard->Finish();
+		delete shard;
+		_exit(pushed ? 0 : 1);
+	}
+
+	//Frames come out in the order the shard pushed them, with their sizes and contents
+	bool inOrder = true;
+	int popped = 0;
+	int frame = 0;
+	const char* data = nullptr;
+	size_t size = 0;
+	while (ring->Pop(frame, data, size)) {
+		inOrder = inOrder && frame == popped && size == TestFrameSize(popped);
+		for (size_t i = 0; inOrder && i < size; ++i) inOrder = data[i] == TestFrameByte(frame, i);
+		popped++;
+	}
+	SELF_CHECK(inOrder);
+	SELF_CHECK(popped == SELFTEST_RING_FRAMES);
+
+	//Pop only returned false once the crashed shard was found gone, as it never pushed its finish
+	waitpid(pusher, &status, 0);
+	SELF_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	SELF_CHECK(!ring->Pop(frame, data, size));
+
+	//A shard that has already run cannot join again
+	SELF_CHECK(FrameRing::Open(hash, 0, 2) == nullptr);
+	SELF_CHECK(FrameRing::Open(hash, 1, 2) == nullptr);
+	delete ring;
+#endif
+}
@@ -1,7 +1,6 @@
 #include "Heap.h"
 #include "MemoryManager.h"
 #include <iostream>
-#include <typeinfo>
 
 #if defined __linux__
 
@@ -53,7 +52,7 @@ void Heap::DeallocateMemory(Header* header, int size)
 	}
 }
 
-int Heap::GetAmountAllocated()
+long long Heap::GetAmountAllocated() const
 {
 	return _totalAllocated;
 }
@@ -73,26 +72,28 @@ void Heap::DisplayDebugInformation()
 	std::cout << "Name: " << _name << std::endl;
 	std::cout << "____________________________________________" << std::endl;
 
+	if (_budget > 0) {
+		std::cout << "Budget: " << _budget << "\tRejected allocations: " << _rejected << std::endl;
+	}
+
 	//if we have a head
 	if (pHead != NULL) {
 		//Output the total allocated and the peak memory
 		//Outputs a nice layout for the debug information
 		std::cout << "Current memory: " << _totalAllocated << "\tPeak memory: " << _peak << std::endl;
 		std::cout << "____________________________________________" << std::endl;
-		std::cout << "ADDRESS\t\t\tTYPE\t\tSIZE" << std::endl;
+		std::cout << "ADDRESS\t\t\tCALL SITE\t\tSIZE" << std::endl;
 		std::cout << "____________________________________________" << std::endl;
 
-		//Stores the size of the header
-		size_t hSize = sizeof(Header);
-
 		//Gets the current head of the list
 		Header* pCurrent = pHead;
 		//While the current exists
 		while (pCurrent != NULL)
 		{
 			if(pCurrent == NULL) break;
-			auto& startMem = *(pCurrent + hSize);
-			std::cout << &startMem << "\t" << typeid(startMem).name() << "\t" << pCurrent->size << std::endl;
+			//The block starts straight after its header
+			void* startMem = (char*)pCurrent + sizeof(Header);
+			std::cout << startMem << "\t" << pCurrent->callSite << "\t" << pCurrent->size << std::endl;
 			if (pCurrent->pNext == NULL) {
 				break;
 			}
@@ -19,7 +19,21 @@ public:
 	void AllocateMemory(Header* header, int size);
 	//Handle the linked list and total allocated
 	void DeallocateMemory(Header* header, int size);
-	int GetAmountAllocated();
+	long long GetAmountAllocated() const;
+	long long GetPeak() const { return _peak; }
+	//Sets the peak back to the current amount, lets us measure the peak of one section of code
+	void ResetPeak() { _peak = _totalAllocated; }
+
+	//Most bytes the heap may hold at once, 0 for no limit. operator new throws std::bad_alloc rather than go
+	//over it, so code that can work in less memory should check CanAllocate first
+	void SetBudget(long long bytes) { _budget = bytes; }
+	long long GetBudget() const { return _budget; }
+	bool CanAllocate(long long bytes) const { return _budget == 0 || _totalAllocated + bytes <= _budget; }
+	//Bytes left before the budget is reached, -1 if there is no budget
+	long long GetAvailable() const { return _budget == 0 ? -1 : _budget - _totalAllocated; }
+	//Allocations refused because they would have gone over the budget
+	long long GetRejectedCount() const { return _rejected; }
+	void RecordRejected() { _rejected++; }
 	std::string GetName() const { return _name; }
 
 	//Class specific new override, heaps don't need to have a header or footer for themselves.
@@ -28,7 +42,8 @@ public:
 	//The head of the linked list
 	Header* pHead = NULL;
 
-	//Methods for displaying debug information about the project
+	//Methods for displaying debug information about the project. Lists every live block with the
+	//return address of the operator new that allocated it
 	void DisplayDebugInformation();
 	void CheckIntegrity();
 
@@ -37,8 +52,11 @@ public:
 private:
 	void SetConsoleColor(ConsoleColor color);
 
-	int _totalAllocated;
-	int _peak;
+	//64 bit so scenes that need more than 2GB while loading are still reported correctly
+	long long _totalAllocated;
+	long long _peak;
+	long long _budget = 0;
+	long long _rejected = 0;
 	std::string _name;
 };
 
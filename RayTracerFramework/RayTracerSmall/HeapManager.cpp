@@ -19,6 +19,35 @@ Heap* HeapManager::GetHeap(std::string name)
 	return heapMap[name];
 }
 
+bool HeapManager::SetBudget(const std::string& name, long long bytes)
+{
+	if (name == defaultHeap.GetName()) {
+		defaultHeap.SetBudget(bytes);
+		return true;
+	}
+
+	//find rather than [] so an unknown name is not added to the map
+	std::unordered_map<std::string, Heap*>::iterator it = heapMap.find(name);
+	if (it == heapMap.end()) return false;
+	it->second->SetBudget(bytes);
+	return true;
+}
+
+void HeapManager::PrintBudgets()
+{
+	std::unordered_map<std::string, Heap*>::const_iterator it;
+	for (it = heapMap.begin(); it != heapMap.end(); it++) {
+		const Heap* heap = it->second;
+		if (heap->GetBudget() == 0) continue;
+		std::cout << heap->GetName() << ": " << heap->GetAmountAllocated() << " bytes\tPeak: " << heap->GetPeak()
+			<< "\tBudget: " << heap->GetBudget() << "\tRejected: " << heap->GetRejectedCount() << std::endl;
+	}
+	if (defaultHeap.GetBudget() > 0) {
+		std::cout << defaultHeap.GetName() << ": " << defaultHeap.GetAmountAllocated() << " bytes\tPeak: " << defaultHeap.GetPeak()
+			<< "\tBudget: " << defaultHeap.GetBudget() << "\tRejected: " << defaultHeap.GetRejectedCount() << std::endl;
+	}
+}
+
 void HeapManager::CleanHeaps()
 {
 	heapMap.clear();
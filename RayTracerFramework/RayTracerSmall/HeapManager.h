@@ -14,6 +14,12 @@ public:
 	//Gets a heap by name
 	static Heap* GetHeap(std::string name);
 
+	//Sets the byte budget of a heap by name, DefaultHeap included. Returns false if there is no such heap
+	static bool SetBudget(const std::string& name, long long bytes);
+
+	//Prints the size, high water mark and budget of every heap that has a budget
+	static void PrintBudgets();
+
 	//Deletes all heaps
 	static void CleanHeaps();
 
@@ -0,0 +1,262 @@
+#include "HeapTelemetry.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "json.hpp"
+
+#if defined __linux__
+#include <dlfcn.h>
+#else
+#include <Windows.h>
+#endif
+
+using json = nlohmann::json;
+
+bool HeapTelemetry::_enabled = false;
+bool HeapTelemetry::_paused = false;
+HeapTelemetry::HeapRecord HeapTelemetry::_heaps[HEAP_TELEMETRY_MAX_HEAPS];
+int HeapTelemetry::_heapCount = 0;
+HeapTelemetry::CallSite HeapTelemetry::_callSites[HEAP_TELEMETRY_CALL_SITES];
+int HeapTelemetry::_callSiteCount = 0;
+long long HeapTelemetry::_droppedCallSites = 0;
+std::vector<HeapTelemetry::FrameRecord> HeapTelemetry::_frames;
+Timer HeapTelemetry::_frameTimer;
+
+int HeapTelemetry::FindHeap(const Heap* heap)
+{
+	for (int i = 0; i < _heapCount; ++i) {
+		if (_heaps[i].heap == heap) return i;
+	}
+	if (_heapCount == HEAP_TELEMETRY_MAX_HEAPS) return -1;
+
+	HeapRecord& record = _heaps[_heapCount];
+	record.heap = heap;
+	record.totals = HeapCounters();
+	record.frameStart = HeapCounters();
+	for (int b = 0; b < HEAP_HISTOGRAM_BUCKETS; ++b) record.histogram[b] = 0;
+	return _heapCount++;
+}
+
+HeapTelemetry::CallSite* HeapTelemetry::FindCallSite(void* address, int heap, bool add)
+{
+	//Open addressing on the address bits above the instruction alignment
+	uintptr_t key = (uintptr_t)address;
+	size_t slot = (size_t)((key >> 2) ^ (key >> 13) ^ ((uintptr_t)heap * 0x9e3779b1u)) % HEAP_TELEMETRY_CALL_SITES;
+	for (int probe = 0; probe < HEAP_TELEMETRY_CALL_SITES; ++probe) {
+		CallSite& site = _callSites[slot];
+		if (site.address == address && site.heap == heap) return &site;
+		if (site.address == nullptr) {
+			//Kept below three quarters full so the probes stay short
+			if (!add || _callSiteCount >= HEAP_TELEMETRY_CALL_SITES * 3 / 4) return nullptr;
+			site.address = address;
+			site.heap = heap;
+			site.counters = HeapCounters();
+			site.largest = 0;
+			_callSiteCount++;
+			return &site;
+		}
+		slot = (slot + 1) % HEAP_TELEMETRY_CALL_SITES;
+	}
+	return nullptr;
+}
+
+void HeapTelemetry::RecordAllocation(const Heap* heap, void* callSite, int size)
+{
+	if (!_enabled || _paused) return;
+
+	int index = FindHeap(heap);
+	if (index < 0) return;
+
+	HeapRecord& record = _heaps[index];
+	record.totals.allocations++;
+	record.totals.bytesAllocated += size;
+	int bucket = 0;
+	while (bucket < HEAP_HISTOGRAM_BUCKETS - 1 && (size >> bucket) != 0) bucket++;
+	record.histogram[bucket]++;
+
+	CallSite* site = FindCallSite(callSite, index, true);
+	if (site == nullptr) {
+		_droppedCallSites++;
+		return;
+	}
+	site->counters.allocations++;
+	site->counters.bytesAllocated += size;
+	if (size > site->largest) site->largest = size;
+}
+
+void HeapTelemetry::RecordFree(const Heap* heap, void* callSite, int size)
+{
+	if (!_enabled || _paused) return;
+
+	int index = FindHeap(heap);
+	if (index < 0) return;
+
+	HeapRecord& record = _heaps[index];
+	record.totals.frees++;
+	record.totals.bytesFreed += size;
+
+	//Blocks allocated before the telemetry was enabled have no site to take the free from
+	CallSite* site = FindCallSite(callSite, index, false);
+	if (site != nullptr) {
+		site->counters.frees++;
+		site->counters.bytesFreed += size;
+	}
+}
+
+void HeapTelemetry::BeginFrame()
+{
+	if (!_enabled) return;
+
+	for (int i = 0; i < _heapCount; ++i) _heaps[i].frameStart = _heaps[i].totals;
+	_frameTimer.Mark();
+}
+
+void HeapTelemetry::EndFrame(int frame)
+{
+	if (!_enabled) return;
+
+	FrameRecord record;
+	record.frame = frame;
+	record.seconds = _frameTimer.Peek();
+	for (int i = 0; i < _heapCount; ++i) {
+		const HeapCounters& now = _heaps[i].totals;
+		const HeapCounters& start = _heaps[i].frameStart;
+		record.heaps[i].allocations = now.allocations - start.allocations;
+		record.heaps[i].frees = now.frees - start.frees;
+		record.heaps[i].bytesAllocated = now.bytesAllocated - start.bytesAllocated;
+		record.heaps[i].bytesFreed = now.bytesFreed - start.bytesFreed;
+	}
+
+	_paused = true;
+	_frames.push_back(record);
+	_paused = false;
+}
+
+//Counters as a json object
+static json CountersToJSON(const HeapCounters& counters)
+{
+	json out;
+	out["allocations"] = counters.allocations;
+	out["frees"] = counters.frees;
+	out["bytesAllocated"] = counters.bytesAllocated;
+	out["bytesFreed"] = counters.bytesFreed;
+	return out;
+}
+
+//Module the address is in and the address relative to where the module was loaded
+static void DescribeAddress(void* address, json& out)
+{
+	std::stringstream ss;
+	ss << address;
+	out["address"] = ss.str();
+
+	const char* module = nullptr;
+	uintptr_t base = 0;
+#if defined __linux__
+	Dl_info info;
+	if (dladdr(address, &info) != 0) {
+		module = info.dli_fname;
+		base = (uintptr_t)info.dli_fbase;
+		if (info.dli_sname != nullptr) out["symbol"] = info.dli_sname;
+	}
+#else
+	HMODULE handle = NULL;
+	char path[MAX_PATH];
+	if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)address, &handle) &&
+		GetModuleFileNameA(handle, path, MAX_PATH) != 0) {
+		module = path;
+		base = (uintptr_t)handle;
+	}
+#endif
+	if (module == nullptr) return;
+
+	std::stringstream offset;
+	offset << "0x" << std::hex << ((uintptr_t)address - base);
+	out["module"] = module;
+	out["offset"] = offset.str();
+}
+
+bool HeapTelemetry::Export(const std::string& path)
+{
+	_paused = true;
+
+	json out;
+	json heaps = json::array();
+	for (int i = 0; i < _heapCount; ++i) {
+		const HeapRecord& record = _heaps[i];
+		const Heap* heap = record.heap;
+		json entry = CountersToJSON(record.totals);
+		entry["name"] = heap->GetName();
+		entry["current"] = heap->GetAmountAllocated();
+		entry["peak"] = heap->GetPeak();
+		if (heap->GetBudget() > 0) {
+			entry["budget"] = heap->GetBudget();
+			entry["rejected"] = heap->GetRejectedCount();
+		}
+
+		json histogram = json::array();
+		for (int b = 0; b < HEAP_HISTOGRAM_BUCKETS; ++b) {
+			if (record.histogram[b] == 0) continue;
+			json bucket;
+			bucket["minSize"] = b == 0 ? 0ll : 1ll << (b - 1);
+			bucket["maxSize"] = b == 0 ? 0ll : (1ll << b) - 1;
+			bucket["count"] = record.histogram[b];
+			histogram.push_back(bucket);
+		}
+		entry["histogram"] = histogram;
+		heaps.push_back(entry);
+	}
+	out["heaps"] = heaps;
+
+	//Most bytes first, the sites worth looking at are at the top of the file
+	std::vector<const CallSite*> sites;
+	for (const CallSite& site : _callSites) {
+		if (site.address != nullptr) sites.push_back(&site);
+	}
+	std::sort(sites.begin(), sites.end(), [](const CallSite* a, const CallSite* b) { return a->counters.bytesAllocated > b->counters.bytesAllocated; });
+
+	json callSites = json::array();
+	for (const CallSite* site : sites) {
+		json entry = CountersToJSON(site->counters);
+		entry["heap"] = _heaps[site->heap].heap->GetName();
+		entry["liveBytes"] = site->counters.bytesAllocated - site->counters.bytesFreed;
+		entry["largest"] = site->largest;
+		DescribeAddress(site->address, entry);
+		callSites.push_back(entry);
+	}
+	out["callSites"] = callSites;
+	out["droppedCallSites"] = _droppedCallSites;
+
+	json frames = json::array();
+	for (const FrameRecord& record : _frames) {
+		json entry;
+		entry["frame"] = record.frame;
+		entry["seconds"] = record.seconds;
+		json frameHeaps = json::object();
+		for (int i = 0; i < _heapCount; ++i) {
+			json counters = CountersToJSON(record.heaps[i]);
+			if (record.seconds > 0.0f) {
+				counters["allocationsPerSecond"] = record.heaps[i].allocations / record.seconds;
+				counters["freesPerSecond"] = record.heaps[i].frees / record.seconds;
+			}
+			frameHeaps[_heaps[i].heap->GetName()] = counters;
+		}
+		entry["heaps"] = frameHeaps;
+		frames.push_back(entry);
+	}
+	out["frames"] = frames;
+
+	std::ofstream file(path);
+	bool written = false;
+	if (file.is_open()) {
+		file << out.dump(1, '\t') << std::endl;
+		written = file.good();
+	}
+	if (!written) std::cout << "[ERROR: HeapTelemetry.cpp: could not write " << path << std::endl;
+	else std::cout << "Heap telemetry written to " << path << " (" << sites.size() << " call sites, " << _frames.size() << " frames)" << std::endl;
+
+	_paused = false;
+	return written;
+}
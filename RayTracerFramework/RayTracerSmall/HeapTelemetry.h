@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Heap.h"
+#include "Timer.h"
+
+//Most heaps that get their own counters, later heaps are not recorded
+#define HEAP_TELEMETRY_MAX_HEAPS 16
+//Size of the call site table. Sites past this are only counted as dropped
+#define HEAP_TELEMETRY_CALL_SITES 4096
+//Size histogram buckets, bucket b holds sizes from 2^(b-1) to 2^b - 1 and bucket 0 empty allocations
+#define HEAP_HISTOGRAM_BUCKETS 32
+
+//Allocation counters of one heap
+struct HeapCounters {
+	long long allocations = 0;
+	long long frees = 0;
+	long long bytesAllocated = 0;
+	long long bytesFreed = 0;
+};
+
+//Records where allocations come from while it is enabled: per heap counters and size histograms, per call
+//site counters and the allocations and frees of every frame. The tables are fixed size and filled in place,
+//as the recording is called from operator new and must not allocate itself. The call site is the return
+//address of operator new, exported as an offset into its module so it can be looked up with addr2line or a
+//debugger. Workers that allocate at the same time on windows can lose counts, as the heap totals already do.
+class HeapTelemetry
+{
+public:
+	static void Enable() { _enabled = true; }
+	static bool IsEnabled() { return _enabled; }
+
+	//Called by the memory manager for every block of a heap
+	static void RecordAllocation(const Heap* heap, void* callSite, int size);
+	static void RecordFree(const Heap* heap, void* callSite, int size);
+
+	//Frames are the allocations between BeginFrame and EndFrame
+	static void BeginFrame();
+	static void EndFrame(int frame);
+
+	//Writes everything recorded so far as json. Returns false if the file cannot be written
+	static bool Export(const std::string& path);
+
+private:
+	struct HeapRecord {
+		const Heap* heap;
+		HeapCounters totals;
+		long long histogram[HEAP_HISTOGRAM_BUCKETS];
+		//Totals when the frame began
+		HeapCounters frameStart;
+	};
+
+	struct CallSite {
+		void* address;
+		int heap;
+		HeapCounters counters;
+		int largest;
+	};
+
+	struct FrameRecord {
+		int frame;
+		float seconds;
+		HeapCounters heaps[HEAP_TELEMETRY_MAX_HEAPS];
+	};
+
+	//Index of the heap's record, -1 if the table is full
+	static int FindHeap(const Heap* heap);
+	//The site's entry, nullptr if the table is full
+	static CallSite* FindCallSite(void* address, int heap, bool add);
+
+	static bool _enabled;
+	//Set while the telemetry itself allocates, so its own vectors and strings are not recorded
+	static bool _paused;
+	static HeapRecord _heaps[HEAP_TELEMETRY_MAX_HEAPS];
+	static int _heapCount;
+	static CallSite _callSites[HEAP_TELEMETRY_CALL_SITES];
+	static int _callSiteCount;
+	static long long _droppedCallSites;
+	static std::vector<FrameRecord> _frames;
+	static Timer _frameTimer;
+};
@@ -0,0 +1,93 @@
+#include "HugePages.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#if defined __linux__
+#include <sys/mman.h>
+#else
+#include <Windows.h>
+#endif
+
+void* HugePages::Allocate(size_t bytes, size_t& mappedBytes, PageKind& kind)
+{
+	mappedBytes = 0;
+	kind = PAGES_DEFAULT;
+
+#if defined __linux__
+	const size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+	//Fails straight away if the hugetlbfs pool does not have enough free pages
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory != MAP_FAILED) {
+		mappedBytes = size;
+		kind = PAGES_HUGETLB;
+		return memory;
+	}
+
+	//Transparent huge pages are only used for whole 2MB aligned ranges, so an extra page is mapped and the
+	//ends trimmed to leave an aligned block
+	char* mapping = (char*)mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) return nullptr;
+
+	char* aligned = (char*)(((uintptr_t)mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+	if (aligned > mapping) munmap(mapping, aligned - mapping);
+	size_t tail = (mapping + size + HUGE_PAGE_SIZE) - (aligned + size);
+	if (tail > 0) munmap(aligned + size, tail);
+
+	//Refused when transparent huge pages are set to never, the block is still usable with normal pages
+	if (madvise(aligned, size, MADV_HUGEPAGE) != 0) {
+		munmap(aligned, size);
+		return nullptr;
+	}
+
+	mappedBytes = size;
+	kind = PAGES_TRANSPARENT;
+	return aligned;
+#else
+	SIZE_T largePage = GetLargePageMinimum();
+	if (largePage == 0) return nullptr;
+
+	const size_t size = (bytes + largePage - 1) / largePage * largePage;
+	void* memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if (memory == NULL) return nullptr;
+
+	mappedBytes = size;
+	kind = PAGES_LARGE;
+	return memory;
+#endif
+}
+
+void HugePages::Free(void* memory, size_t mappedBytes)
+{
+	if (memory == nullptr) return;
+
+#if defined __linux__
+	munmap(memory, mappedBytes);
+#else
+	VirtualFree(memory, 0, MEM_RELEASE);
+#endif
+}
+
+const char* HugePages::GetKindName(PageKind kind)
+{
+	switch (kind) {
+	case PAGES_TRANSPARENT: return "transparent huge pages";
+	case PAGES_HUGETLB: return "hugetlbfs huge pages";
+	case PAGES_LARGE: return "large pages";
+	default: return "4KB pages";
+	}
+}
+
+long long HugePages::GetTransparentHugeBytes()
+{
+#if defined __linux__
+	std::ifstream smaps("/proc/self/smaps_rollup");
+	std::string line;
+	while (std::getline(smaps, line)) {
+		//"AnonHugePages:      4096 kB"
+		if (line.compare(0, 14, "AnonHugePages:") == 0) return std::stoll(line.substr(14)) * 1024;
+	}
+#endif
+	return -1;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+//Size of the huge pages asked for, the x86-64 2MB page
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+//What a block of memory ended up backed by
+enum PageKind {
+	//Normal 4KB pages from malloc, huge pages were not asked for or could not be had
+	PAGES_DEFAULT,
+	//Anonymous mapping marked with madvise(MADV_HUGEPAGE), the kernel backs it with huge pages as it can (linux)
+	PAGES_TRANSPARENT,
+	//Reserved huge pages from the hugetlbfs pool, see /proc/sys/vm/nr_hugepages (linux)
+	PAGES_HUGETLB,
+	//VirtualAlloc with MEM_LARGE_PAGES, needs the "Lock pages in memory" privilege (windows)
+	PAGES_LARGE
+};
+
+//Maps memory backed by huge pages for the large buffers that every worker writes across, so one TLB entry
+//covers 2MB instead of 4KB. Explicit huge pages are tried first as they are guaranteed once mapped,
+//then transparent huge pages. Allocate returns nullptr if neither is available and the caller falls back
+//to malloc.
+class HugePages
+{
+public:
+	//Maps at least bytes, rounded up to whole huge pages. mappedBytes is the size to give back to Free
+	static void* Allocate(size_t bytes, size_t& mappedBytes, PageKind& kind);
+	static void Free(void* memory, size_t mappedBytes);
+
+	static const char* GetKindName(PageKind kind);
+
+	//Bytes of this process's memory the kernel has backed with transparent huge pages, -1 if it cannot
+	//be read. Transparent huge pages are only a hint, this shows whether they were given
+	static long long GetTransparentHugeBytes();
+};
@@ -31,6 +31,11 @@ JSONSphereInfo* JSONReader::LoadSphereInfoFromFile(const char* filepath)
 	//Creates the animation information object
 	JSONSphereInfo* animInfo = new JSONSphereInfo(noSpheres, noFrames);
 
+	//Render settings stored with the scene
+	if (HasAttribute(&jsonFile, "config")) {
+		animInfo->config = jsonFile["config"];
+	}
+
 	//Gets the "spheres" array from the json object
 	json sphereArr = jsonFile["spheres"];
 
@@ -81,12 +86,24 @@ JSONSphereInfo* JSONReader::LoadSphereInfoFromFile(const char* filepath)
 			animInfo->sphereArr[i]._emissionColor = ReadVec3f(sphere["emmisionColor"]);
 		}
 
+		//Reads any keyframe tracks
+		if (HasAttribute(&sphere, "keyframes")) {
+			ReadKeyframes(sphere["keyframes"], animInfo->sphereAnimations[i]);
+		}
+
+	}
 
+	//Planes are optional and do not need a count
+	if (HasAttribute(&jsonFile, "planes")) {
+		for (json& plane : jsonFile["planes"]) {
+			animInfo->planes.push_back(ReadPlane(plane));
+		}
 	}
 
 	//Calculate the sphere movement and color values accross each frame
 	animInfo->CalculateSphereMovements();
 	animInfo->CalculateSphereColor();
+	animInfo->BuildLegacyTracks();
 	return animInfo;
 }
 
@@ -104,3 +121,480 @@ Vec3f JSONReader::ReadVec3f(std::vector<float> vec)
 	//Reads a vector of floats into a vec3f object
 	return Vec3f(vec[0], vec[1], vec[2]);
 }
+
+void JSONReader::ReadKeyframes(json& keyframes, SphereAnimation& animation)
+{
+	//Each attribute of the keyframes object is a track for one property
+	for (auto it = keyframes.begin(); it != keyframes.end(); ++it) {
+		TrackProperty property = TrackPropertyFromString(it.key());
+		if (property == TRACK_COUNT) {
+			std::cout << "[ERROR: JSONReader.cpp: unknown keyframe track \"" << it.key() << "\"" << std::endl;
+			continue;
+		}
+
+		for (json& key : it.value()) {
+			if (!HasAttribute(&key, "frame") || !HasAttribute(&key, "value")) {
+				std::cout << "[ERROR: JSONReader.cpp: keyframes need a \"frame\" and a \"value\" attribute" << std::endl;
+				continue;
+			}
+
+			float values[3] = { 0.0f, 0.0f, 0.0f };
+			if (IsVec3Track(property)) {
+				Vec3f vec = ReadVec3f(key["value"]);
+				values[0] = vec.x;
+				values[1] = vec.y;
+				values[2] = vec.z;
+			}
+			else {
+				values[0] = key["value"];
+			}
+
+			Interpolation interpolation = INTERPOLATION_LINEAR;
+			if (HasAttribute(&key, "interpolation")) {
+				interpolation = InterpolationFromString(key["interpolation"]);
+			}
+
+			animation.AddKey(property, key["frame"], values, interpolation);
+		}
+	}
+}
+
+Plane JSONReader::ReadPlane(json& plane)
+{
+	//Defaults to a floor through the origin
+	Vec3f normal(0, 1, 0);
+	Vec3f point(0);
+	Plane result;
+
+	if (HasAttribute(&plane, "normal")) normal = ReadVec3f(plane["normal"]);
+	if (HasAttribute(&plane, "point")) point = ReadVec3f(plane["point"]);
+	if (HasAttribute(&plane, "surfaceColor")) result._surfaceColor = ReadVec3f(plane["surfaceColor"]);
+	if (HasAttribute(&plane, "reflection")) result._reflection = plane["reflection"];
+	if (HasAttribute(&plane, "transparency")) result._transparency = plane["transparency"];
+	if (HasAttribute(&plane, "emmisionColor")) result._emissionColor = ReadVec3f(plane["emmisionColor"]);
+
+	result.Set(normal, point);
+	return result;
+}
+
+//Attributes understood by the streaming loader. Keys are turned into one of these as soon as they are read
+//so the handler never has to hold on to the key string
+enum SphereField {
+	FIELD_UNKNOWN,
+	FIELD_FRAME_COUNT,
+	FIELD_SPHERE_COUNT,
+	FIELD_SPHERES,
+	FIELD_PLANES,
+	FIELD_CONFIG,
+	FIELD_START_POS,
+	FIELD_END_POS,
+	FIELD_SURFACE_COLOR,
+	FIELD_END_SURFACE_COLOR,
+	FIELD_RADIUS,
+	FIELD_REFLECTION,
+	FIELD_TRANSPARENCY,
+	FIELD_EMISSION_COLOR,
+	FIELD_KEYFRAMES,
+	FIELD_NORMAL,
+	FIELD_POINT,
+	FIELD_KEY_FRAME,
+	FIELD_KEY_VALUE,
+	FIELD_KEY_INTERPOLATION
+};
+
+//Where in the document the parser currently is
+enum SAXContext {
+	CONTEXT_ROOT,
+	CONTEXT_SPHERE_LIST,
+	CONTEXT_SPHERE,
+	CONTEXT_PLANE_LIST,
+	CONTEXT_PLANE,
+	CONTEXT_VEC3,
+	CONTEXT_KEYFRAMES,
+	CONTEXT_TRACK,
+	CONTEXT_KEYFRAME,
+	CONTEXT_CONFIG,
+	CONTEXT_SKIP
+};
+
+#define SAX_MAX_DEPTH 8
+
+//Receives the tokens from nlohmann::json::sax_parse and writes them into a JSONSphereInfo
+class SphereInfoSAXHandler : public nlohmann::json_sax<json>
+{
+public:
+	JSONSphereInfo* info = nullptr;
+	int frameCount = 0;
+	bool hasFrameCount = false;
+	bool hasSphereCount = false;
+	//Set when the spheres array arrived before the sphere count so the arrays could not be preallocated
+	bool needsDOM = false;
+	//The "config" object. It only holds plain values so it is collected here rather than skipped
+	json config;
+	//Planes do not have a count so they can be collected before the sphere arrays exist
+	std::vector<Plane> planes;
+
+	bool null() override { return Value(); }
+	bool boolean(bool val) override { return ConfigValue(val) || Value(); }
+	bool number_integer(number_integer_t val) override { return ConfigValue(val) || Number((float)val); }
+	bool number_unsigned(number_unsigned_t val) override { return ConfigValue(val) || Number((float)val); }
+	bool number_float(number_float_t val, const string_t&) override { return ConfigValue(val) || Number((float)val); }
+	bool string(string_t& val) override
+	{
+		if (ConfigValue(val)) return true;
+		if (_skipDepth == 0 && _depth > 0 && Top() == CONTEXT_KEYFRAME && _field == FIELD_KEY_INTERPOLATION) {
+			_keyInterpolation = InterpolationFromString(val);
+		}
+		return Value();
+	}
+	bool binary(binary_t&) override { return Value(); }
+
+	bool start_object(std::size_t) override
+	{
+		if (_skipDepth > 0 || _depth == SAX_MAX_DEPTH) return Skip();
+
+		if (_depth == 0) return Push(CONTEXT_ROOT);
+
+		if (Top() == CONTEXT_SPHERE_LIST) {
+			_sphereIndex++;
+			return Push(CONTEXT_SPHERE);
+		}
+
+		if (Top() == CONTEXT_SPHERE && _field == FIELD_KEYFRAMES) return Push(CONTEXT_KEYFRAMES);
+
+		if (Top() == CONTEXT_PLANE_LIST) {
+			_plane = Plane();
+			_planeNormal = Vec3f(0, 1, 0);
+			_planePoint = Vec3f(0);
+			return Push(CONTEXT_PLANE);
+		}
+
+		if (Top() == CONTEXT_ROOT && _field == FIELD_CONFIG) {
+			config = json::object();
+			return Push(CONTEXT_CONFIG);
+		}
+
+		if (Top() == CONTEXT_TRACK) {
+			_keyHasFrame = false;
+			_keyHasValue = false;
+			_keyInterpolation = INTERPOLATION_LINEAR;
+			return Push(CONTEXT_KEYFRAME);
+		}
+
+		return Skip();
+	}
+
+	bool end_object() override
+	{
+		if (_skipDepth == 0 && Top() == CONTEXT_KEYFRAME) {
+			if (!_keyHasFrame || !_keyHasValue) {
+				std::cout << "[ERROR: JSONReader.cpp: keyframes need a \"frame\" and a \"value\" attribute" << std::endl;
+			}
+			else if (CurrentSphere() != nullptr) {
+				info->sphereAnimations[_sphereIndex].AddKey(_trackProperty, _keyFrame, _keyValues, _keyInterpolation);
+			}
+		}
+		else if (_skipDepth == 0 && Top() == CONTEXT_PLANE) {
+			_plane.Set(_planeNormal, _planePoint);
+			planes.push_back(_plane);
+		}
+
+		return Pop();
+	}
+
+	bool start_array(std::size_t) override
+	{
+		if (_skipDepth > 0 || _depth == SAX_MAX_DEPTH || _depth == 0) return Skip();
+
+		if (Top() == CONTEXT_ROOT && _field == FIELD_SPHERES) {
+			if (info == nullptr) {
+				//Cannot write straight into the arrays if we do not know how big they are
+				needsDOM = true;
+				return false;
+			}
+			return Push(CONTEXT_SPHERE_LIST);
+		}
+
+		if (Top() == CONTEXT_ROOT && _field == FIELD_PLANES) return Push(CONTEXT_PLANE_LIST);
+
+		if ((Top() == CONTEXT_SPHERE || Top() == CONTEXT_PLANE) && IsVec3Field(_field)) {
+			_vecIndex = 0;
+			return Push(CONTEXT_VEC3);
+		}
+
+		if (Top() == CONTEXT_KEYFRAMES && _trackProperty != TRACK_COUNT) return Push(CONTEXT_TRACK);
+
+		if (Top() == CONTEXT_KEYFRAME && _field == FIELD_KEY_VALUE) {
+			_vecIndex = 0;
+			return Push(CONTEXT_VEC3);
+		}
+
+		return Skip();
+	}
+
+	bool end_array() override
+	{
+		if (_skipDepth == 0 && Top() == CONTEXT_VEC3) {
+			Vec3f value(_vec[0], _vec[1], _vec[2]);
+			if (_stack[_depth - 2] == CONTEXT_KEYFRAME) {
+				for (int i = 0; i < 3; ++i) _keyValues[i] = _vec[i];
+				_keyHasValue = true;
+			}
+			else if (_stack[_depth - 2] == CONTEXT_PLANE) {
+				switch (_field) {
+				case FIELD_NORMAL: _planeNormal = value; break;
+				case FIELD_POINT: _planePoint = value; break;
+				case FIELD_SURFACE_COLOR: _plane._surfaceColor = value; break;
+				case FIELD_EMISSION_COLOR: _plane._emissionColor = value; break;
+				default: break;
+				}
+			}
+			else if (CurrentSphere() != nullptr) {
+				switch (_field) {
+				case FIELD_START_POS: CurrentSphere()->_center = value; break;
+				case FIELD_END_POS: info->sphereEndPositions[_sphereIndex] = value; break;
+				case FIELD_SURFACE_COLOR: CurrentSphere()->_surfaceColor = value; break;
+				case FIELD_END_SURFACE_COLOR: info->sphereEndColor[_sphereIndex] = value; break;
+				case FIELD_EMISSION_COLOR: CurrentSphere()->_emissionColor = value; break;
+				default: break;
+				}
+			}
+		}
+
+		return Pop();
+	}
+
+	bool key(string_t& val) override
+	{
+		if (_skipDepth > 0) return true;
+
+		if (Top() == CONTEXT_ROOT) {
+			if (val == "frameCount") _field = FIELD_FRAME_COUNT;
+			else if (val == "sphereCount") _field = FIELD_SPHERE_COUNT;
+			else if (val == "spheres") _field = FIELD_SPHERES;
+			else if (val == "planes") _field = FIELD_PLANES;
+			else if (val == "config") _field = FIELD_CONFIG;
+			else _field = FIELD_UNKNOWN;
+		}
+		else if (Top() == CONTEXT_SPHERE) {
+			if (val == "startPos") _field = FIELD_START_POS;
+			else if (val == "endPos") _field = FIELD_END_POS;
+			else if (val == "surfaceColor") _field = FIELD_SURFACE_COLOR;
+			else if (val == "endSurfaceColor") _field = FIELD_END_SURFACE_COLOR;
+			else if (val == "radius") _field = FIELD_RADIUS;
+			else if (val == "reflection") _field = FIELD_REFLECTION;
+			else if (val == "transparency") _field = FIELD_TRANSPARENCY;
+			else if (val == "emmisionColor") _field = FIELD_EMISSION_COLOR;
+			else if (val == "keyframes") _field = FIELD_KEYFRAMES;
+			else _field = FIELD_UNKNOWN;
+		}
+		else if (Top() == CONTEXT_PLANE) {
+			if (val == "normal") _field = FIELD_NORMAL;
+			else if (val == "point") _field = FIELD_POINT;
+			else if (val == "surfaceColor") _field = FIELD_SURFACE_COLOR;
+			else if (val == "reflection") _field = FIELD_REFLECTION;
+			else if (val == "transparency") _field = FIELD_TRANSPARENCY;
+			else if (val == "emmisionColor") _field = FIELD_EMISSION_COLOR;
+			else _field = FIELD_UNKNOWN;
+		}
+		else if (Top() == CONTEXT_KEYFRAMES) {
+			_trackProperty = TrackPropertyFromString(val);
+			if (_trackProperty == TRACK_COUNT) {
+				std::cout << "[ERROR: JSONReader.cpp: unknown keyframe track \"" << val << "\"" << std::endl;
+			}
+		}
+		else if (Top() == CONTEXT_CONFIG) {
+			_configKey = val;
+		}
+		else if (Top() == CONTEXT_KEYFRAME) {
+			if (val == "frame") _field = FIELD_KEY_FRAME;
+			else if (val == "value") _field = FIELD_KEY_VALUE;
+			else if (val == "interpolation") _field = FIELD_KEY_INTERPOLATION;
+			else _field = FIELD_UNKNOWN;
+		}
+
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override
+	{
+		std::cout << "[ERROR: JSONReader.cpp: parse error at byte " << position << ": " << ex.what() << std::endl;
+		return false;
+	}
+
+private:
+	SAXContext _stack[SAX_MAX_DEPTH];
+	int _depth = 0;
+	//Depth inside a value we do not care about, nothing is recorded until we leave it
+	int _skipDepth = 0;
+
+	SphereField _field = FIELD_UNKNOWN;
+	int _sphereIndex = -1;
+
+	float _vec[3] = { 0.0f, 0.0f, 0.0f };
+	int _vecIndex = 0;
+
+	std::string _configKey;
+
+	//The plane currently being read, its normal and point are only combined once the object ends
+	Plane _plane;
+	Vec3f _planeNormal;
+	Vec3f _planePoint;
+
+	//The keyframe currently being read
+	TrackProperty _trackProperty = TRACK_COUNT;
+	float _keyFrame = 0.0f;
+	float _keyValues[3] = { 0.0f, 0.0f, 0.0f };
+	Interpolation _keyInterpolation = INTERPOLATION_LINEAR;
+	bool _keyHasFrame = false;
+	bool _keyHasValue = false;
+
+	SAXContext Top() const { return _stack[_depth - 1]; }
+
+	bool Push(SAXContext context)
+	{
+		_stack[_depth++] = context;
+		return true;
+	}
+
+	bool Pop()
+	{
+		if (_skipDepth > 0) _skipDepth--;
+		else _depth--;
+		return true;
+	}
+
+	bool Skip()
+	{
+		_skipDepth++;
+		return true;
+	}
+
+	//Any value that is not a number is ignored, same as the DOM loader
+	bool Value() { return true; }
+
+	//Stores a value of the config object, returns false if we are not inside it
+	template<typename T>
+	bool ConfigValue(const T& val)
+	{
+		if (_skipDepth > 0 || _depth == 0 || Top() != CONTEXT_CONFIG) return false;
+		config[_configKey] = val;
+		return true;
+	}
+
+	static bool IsVec3Field(SphereField field)
+	{
+		return field == FIELD_START_POS || field == FIELD_END_POS || field == FIELD_SURFACE_COLOR ||
+			field == FIELD_END_SURFACE_COLOR || field == FIELD_EMISSION_COLOR || field == FIELD_NORMAL || field == FIELD_POINT;
+	}
+
+	//Spheres past the declared sphere count are ignored
+	Sphere* CurrentSphere()
+	{
+		if (info == nullptr || _sphereIndex < 0 || _sphereIndex >= info->sphereCount) return nullptr;
+		return &info->sphereArr[_sphereIndex];
+	}
+
+	bool Number(float val)
+	{
+		if (_skipDepth > 0 || _depth == 0) return true;
+
+		switch (Top()) {
+		case CONTEXT_ROOT:
+			if (_field == FIELD_FRAME_COUNT) {
+				frameCount = (int)val;
+				hasFrameCount = true;
+				if (info != nullptr) info->frameCount = frameCount;
+			}
+			else if (_field == FIELD_SPHERE_COUNT && info == nullptr) {
+				hasSphereCount = true;
+				//Preallocate everything now so the spheres can be written as they arrive
+				info = new JSONSphereInfo((int)val, frameCount);
+			}
+			break;
+		case CONTEXT_SPHERE:
+			if (CurrentSphere() == nullptr) break;
+			if (_field == FIELD_RADIUS) {
+				CurrentSphere()->_radius = val;
+				CurrentSphere()->_radiusSqr = val * val;
+			}
+			else if (_field == FIELD_REFLECTION) CurrentSphere()->_reflection = val;
+			else if (_field == FIELD_TRANSPARENCY) CurrentSphere()->_transparency = val;
+			break;
+		case CONTEXT_PLANE:
+			if (_field == FIELD_REFLECTION) _plane._reflection = val;
+			else if (_field == FIELD_TRANSPARENCY) _plane._transparency = val;
+			break;
+		case CONTEXT_VEC3:
+			if (_vecIndex < 3) _vec[_vecIndex] = val;
+			_vecIndex++;
+			break;
+		case CONTEXT_KEYFRAME:
+			if (_field == FIELD_KEY_FRAME) {
+				_keyFrame = val;
+				_keyHasFrame = true;
+			}
+			else if (_field == FIELD_KEY_VALUE) {
+				_keyValues[0] = val;
+				_keyHasValue = true;
+			}
+			break;
+		default:
+			break;
+		}
+
+		return true;
+	}
+};
+
+JSONSphereInfo* JSONReader::StreamSphereInfoFromFile(const char* filepath)
+{
+	std::ifstream file(filepath, std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "[ERROR: JSONReader.cpp: could not open " << filepath << std::endl;
+		return nullptr;
+	}
+
+	SphereInfoSAXHandler handler;
+	bool result = json::sax_parse(file, &handler);
+
+	if (!result) {
+		if (handler.info != nullptr) {
+			handler.info->Cleanup();
+			delete handler.info;
+		}
+
+		if (handler.needsDOM) {
+			std::cout << "[WARNING: JSONReader.cpp: \"spheres\" appears before \"sphereCount\" in " << filepath << ", loading with the DOM reader instead" << std::endl;
+			//The streaming parse stopped at "spheres", so the rest of the file has not been checked yet and the DOM
+			//reader throws on a file that is cut short further on
+			try {
+				return LoadSphereInfoFromFile(filepath);
+			}
+			catch (const json::exception& ex) {
+				std::cout << "[ERROR: JSONReader.cpp: " << ex.what() << std::endl;
+				return nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	//Same messages as the DOM loader if the counts are missing
+	if (!handler.hasFrameCount) {
+		std::cout << "[ERROR: JSONReader.cpp: file does not specify number of frames. Use attribute \"frameCount\" to specify" << std::endl;
+	}
+	if (!handler.hasSphereCount) {
+		std::cout << "[ERROR: JSONReader.cpp: file does not specify number of spheres. Use attribute \"sphereCount\" to specify" << std::endl;
+		handler.info = new JSONSphereInfo(0, handler.frameCount);
+	}
+
+	JSONSphereInfo* animInfo = handler.info;
+	animInfo->config = std::move(handler.config);
+	animInfo->planes = std::move(handler.planes);
+
+	//Calculate the sphere movement and color values accross each frame
+	animInfo->CalculateSphereMovements();
+	animInfo->CalculateSphereColor();
+	animInfo->BuildLegacyTracks();
+	return animInfo;
+}
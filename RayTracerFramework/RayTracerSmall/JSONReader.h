@@ -5,6 +5,8 @@
 #include <string>
 #include "Vec3.h"
 #include "Sphere.h"
+#include "Plane.h"
+#include "AnimationTrack.h"
 #include <fstream>
 
 
@@ -17,11 +19,18 @@ struct JSONSphereInfo {
 	Vec3f* sphereMovementsPerFrame;
 	Vec3f* sphereEndColor;
 	Vec3f* sphereColorPerFrame;
+	//Keyframe tracks for each sphere, evaluated in closed form for any frame
+	SphereAnimation* sphereAnimations;
+	//Planes from the optional "planes" array, these are not animated
+	std::vector<Plane> planes;
 
 	//Frame and sphere count. Needed to create arrays for each sphere
 	int frameCount;
 	int sphereCount;
 
+	//The optional "config" object of the scene, applied to the RenderOptions
+	json config;
+
 	JSONSphereInfo(int spherecount, int framecount) {
 		frameCount = framecount;
 		sphereCount = spherecount;
@@ -30,20 +39,23 @@ struct JSONSphereInfo {
 		sphereMovementsPerFrame = new Vec3f[spherecount];
 		sphereEndColor = new Vec3f[spherecount];
 		sphereColorPerFrame = new Vec3f[spherecount];
+		sphereAnimations = new SphereAnimation[spherecount];
 	}
 
 	void Cleanup() {
-		delete sphereArr;
-		delete sphereEndPositions;
-		delete sphereMovementsPerFrame;
-		delete sphereEndColor;
-		delete sphereColorPerFrame;
+		delete[] sphereArr;
+		delete[] sphereEndPositions;
+		delete[] sphereMovementsPerFrame;
+		delete[] sphereEndColor;
+		delete[] sphereColorPerFrame;
+		delete[] sphereAnimations;
 
 		sphereArr = nullptr;
 		sphereEndPositions = nullptr;
 		sphereMovementsPerFrame = nullptr;
 		sphereEndColor = nullptr;
 		sphereColorPerFrame = nullptr;
+		sphereAnimations = nullptr;
 	}
 
 	void CalculateSphereMovements() {
@@ -69,6 +81,31 @@ struct JSONSphereInfo {
 			sphereColorPerFrame[i] = diff;
 		}
 	}
+
+	//Spheres that only give start and end values get linear position and color tracks. The start
+	//value is the state before the first frame is rendered so the end value is reached on the last frame,
+	//the same as applying the per frame deltas once before each frame
+	void BuildLegacyTracks() {
+		for (int i = 0; i < sphereCount; i++) {
+			SphereAnimation& anim = sphereAnimations[i];
+			if (anim.position.IsEmpty()) {
+				anim.position.AddKey(-1.0f, sphereArr[i]._center);
+				anim.position.AddKey((float)(frameCount - 1), sphereEndPositions[i]);
+			}
+			if (anim.surfaceColor.IsEmpty()) {
+				anim.surfaceColor.AddKey(-1.0f, sphereArr[i]._surfaceColor);
+				anim.surfaceColor.AddKey((float)(frameCount - 1), sphereEndColor[i]);
+			}
+		}
+	}
+
+	//Writes the state of every sphere at a frame into spheres (sphereCount elements)
+	void EvaluateFrame(int frame, Sphere* spheres) const {
+		for (int i = 0; i < sphereCount; i++) {
+			spheres[i] = sphereArr[i];
+			sphereAnimations[i].Apply((float)frame, spheres[i]);
+		}
+	}
 };
 
 class JSONReader
@@ -77,9 +114,16 @@ public:
 	//Loads animation information from a json file
 	static JSONSphereInfo* LoadSphereInfoFromFile(const char* filepath);
 
+	//Loads animation information from a json file without building a DOM. Values are written straight
+	//into the JSONSphereInfo arrays as they are parsed, so "sphereCount" has to appear before "spheres".
+	//Falls back to LoadSphereInfoFromFile if it does not. Returns nullptr if the file cannot be read or parsed.
+	static JSONSphereInfo* StreamSphereInfoFromFile(const char* filepath);
+
 private:
 	//helper methods for loading a file
 	static bool HasAttribute(json* file, std::string key);
 	static Vec3f ReadVec3f(std::vector<float> vec);
+	static void ReadKeyframes(json& keyframes, SphereAnimation& animation);
+	static Plane ReadPlane(json& plane);
 };
 
@@ -0,0 +1,96 @@
+#include "SelfTest.h"
+#include "JSONReader.h"
+#include "BinaryScene.h"
+#include <cstdio>
+
+static const char* testSpheres =
+	"\"spheres\": ["
+	"{ \"startPos\": [ 0.0, 0.0, -20.0 ], \"endPos\": [ 6.0, 0.0, -20.0 ], \"radius\": 2.0, \"surfaceColor\": [ 1.0, 0.5, 0.25 ],"
+	" \"reflection\": 0.5, \"transparency\": 0.25, \"emmisionColor\": [ 0.0, 0.0, 0.0 ], \"endSurfaceColor\": [ 0.0, 0.5, 1.0 ] },"
+	"{ \"startPos\": [ 0.0, 20.0, -30.0 ], \"endPos\": [ 0.0, 20.0, -30.0 ], \"radius\": 3.0, \"surfaceColor\": [ 0.0, 0.0, 0.0 ],"
+	" \"reflection\": 0.0, \"transparency\": 0.0, \"emmisionColor\": [ 3.0, 3.0, 3.0 ], \"endSurfaceColor\": [ 0.0, 0.0, 0.0 ] }"
+	"]";
+static const char* testCounts = "\"frameCount\": 4, \"sphereCount\": 2";
+static const char* testExtras = "\"planes\": [ { \"normal\": [ 0.0, 1.0, 0.0 ], \"point\": [ 0.0, -4.0, 0.0 ] } ], \"config\": { \"width\": 320 }";
+
+static void WriteText(const char* path, const std::string& text)
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+	ofs << text;
+}
+
+static bool SameVec3(const Vec3f& a, const Vec3f& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+//True if the streaming loader gave the same scene as the DOM loader, including the state of every sphere
+//on every frame
+static bool SameScene(const JSONSphereInfo& a, const JSONSphereInfo& b)
+{
+	if (a.frameCount != b.frameCount || a.sphereCount != b.sphereCount || a.planes.size() != b.planes.size() || a.config != b.config) return false;
+
+	for (size_t i = 0; i < a.planes.size(); ++i) {
+		if (!SameVec3(a.planes[i]._normal, b.planes[i]._normal) || a.planes[i]._offset != b.planes[i]._offset) return false;
+	}
+
+	Sphere* spheresA = new Sphere[a.sphereCount];
+	Sphere* spheresB = new Sphere[b.sphereCount];
+	bool same = true;
+	for (int frame = 0; frame < a.frameCount && same; ++frame) {
+		a.EvaluateFrame(frame, spheresA);
+		b.EvaluateFrame(frame, spheresB);
+		for (int i = 0; i < a.sphereCount && same; ++i) {
+			same = SameVec3(spheresA[i]._center, spheresB[i]._center) && spheresA[i]._radius == spheresB[i]._radius &&
+				SameVec3(spheresA[i]._surfaceColor, spheresB[i]._surfaceColor) && SameVec3(spheresA[i]._emissionColor, spheresB[i]._emissionColor) &&
+				spheresA[i]._reflection == spheresB[i]._reflection && spheresA[i]._transparency == spheresB[i]._transparency;
+		}
+	}
+	delete[] spheresA;
+	delete[] spheresB;
+	return same;
+}
+
+static void Free(JSONSphereInfo* info)
+{
+	if (info == nullptr) return;
+	info->Cleanup();
+	delete info;
+}
+
+void SelfTest::TestStreamingLoader()
+{
+	const char* path = "selftest_scene.json";
+
+	//Counts first, streamed straight into the arrays
+	WriteText(path, std::string("{ ") + testCounts + ", " + testSpheres + ", " + testExtras + " }");
+	JSONSphereInfo* dom = JSONReader::LoadSphereInfoFromFile(path);
+	JSONSphereInfo* streamed = JSONReader::StreamSphereInfoFromFile(path);
+	SELF_CHECK(streamed != nullptr);
+	SELF_CHECK(streamed != nullptr && SameScene(*dom, *streamed));
+	SELF_CHECK(streamed != nullptr && streamed->planes.size() == 1 && streamed->config["width"] == 320);
+	SELF_CHECK(streamed != nullptr && streamed->sphereMovementsPerFrame[0].x == dom->sphereMovementsPerFrame[0].x);
+	Free(streamed);
+
+	//Spheres before the counts, the streaming loader has to fall back to the DOM loader and give the same scene
+	WriteText(path, std::string("{ ") + testSpheres + ", " + testExtras + ", " + testCounts + " }");
+	streamed = JSONReader::StreamSphereInfoFromFile(path);
+	SELF_CHECK(streamed != nullptr);
+	SELF_CHECK(streamed != nullptr && SameScene(*dom, *streamed));
+	Free(streamed);
+	Free(dom);
+
+	//Broken json is an error, not a fall back
+	WriteText(path, std::string("{ ") + testCounts + ", \"spheres\": [ { \"radius\": ");
+	SELF_CHECK(JSONReader::StreamSphereInfoFromFile(path) == nullptr);
+
+	//Broken after the spheres that sent it to the DOM loader, which throws rather than returning
+	WriteText(path, std::string("{ ") + testSpheres + ", \"sphereCount\": ");
+	SELF_CHECK(JSONReader::StreamSphereInfoFromFile(path) == nullptr);
+	SELF_CHECK(!BinaryScene::ConvertFromJSON(path, "selftest_convert.rtscene"));
+
+	remove(path);
+	SELF_CHECK(JSONReader::StreamSphereInfoFromFile(path) == nullptr);
+	SELF_CHECK(!BinaryScene::ConvertFromJSON(path, "selftest_convert.rtscene"));
+	remove("selftest_convert.rtscene");
+}
@@ -1,25 +1,40 @@
 #include "MemoryManager.h"
+#include "HeapTelemetry.h"
 
 #include<iostream>
+#include <new>
 
-void* operator new(size_t size) {
-	//Gets the default heap if a heap is not specified
-	return ::operator new(size, &HeapManager::GetDefaultHeap());
-}
+#if defined _WIN32
+#include <intrin.h>
+#define CALL_SITE() _ReturnAddress()
+#else
+#define CALL_SITE() __builtin_return_address(0)
+#endif
+
+//Allocates a block with its header and footer. callSite is taken in each operator new, so it is the code
+//that asked for the memory rather than another operator new
+static void* AllocateBlock(size_t size, Heap* heap, void* callSite) {
+	//The budget is a hard limit, callers that can use less memory check it before they allocate
+	if (!heap->CanAllocate((long long)size)) {
+		heap->RecordRejected();
+		throw std::bad_alloc();
+	}
 
-void* operator new(size_t size, Heap* heap) {
 	//Calculates the required bytes
 	size_t requestedBytes = size + sizeof(Header) + sizeof(Footer);
 	//Allocates the required bytes and returns the starting memory pointer
 	char* pMem = (char*)malloc(requestedBytes);
+	if (pMem == nullptr) throw std::bad_alloc();
 
 	//Casts the memory to a header object
 	Header* pHeader = (Header*)pMem;
 	//Sets the heap for this header
 	pHeader->pHeap = heap;
+	pHeader->callSite = callSite;
 
 	//Allocates memory for the heap (handles the linked list)
 	heap->AllocateMemory(pHeader, size);
+	if (HeapTelemetry::IsEnabled()) HeapTelemetry::RecordAllocation(heap, callSite, (int)size);
 
 	//Get the location of the footer start position
 	//pMem (start of mem block) + sizeof(header) (offset) + size of the mem block. Will give the memory position of the footer
@@ -33,29 +48,22 @@ void* operator new(size_t size, Heap* heap) {
 	return pStartMemBlock;
 }
 
-void* operator new[](size_t size, Heap* heap) {
-	//Gets the requested bytes needed
-	size_t requestedBytes = size + sizeof(Header) + sizeof(Footer);
-	//Allocates the memory and returns the pointer to the start of the block
-	char* pMem = (char*)malloc(requestedBytes);
-
-	//Sets the header at the start of this block
-	Header* pHeader = (Header*)pMem;
-	pHeader->pHeap = heap;
+void* operator new(size_t size) {
+	//Gets the default heap if a heap is not specified
+	return AllocateBlock(size, &HeapManager::GetDefaultHeap(), CALL_SITE());
+}
 
-	heap->AllocateMemory(pHeader, size);
+void* operator new[](size_t size) {
+	//Would otherwise go through operator new, and every array would come from the same call site
+	return AllocateBlock(size, &HeapManager::GetDefaultHeap(), CALL_SITE());
+}
 
-	//Get the location of the footer start position
-	//pMem (start of mem block) + sizeof(header) (offset) + size of the mem block. Will give the memory position of the footer
-	void* pFooterAddr = pMem + sizeof(Header) + size;
-	Footer* pFooter = (Footer*)pFooterAddr;
-#ifdef _DEBUG
-	pFooter->check = deadCode;
-#endif
+void* operator new(size_t size, Heap* heap) {
+	return AllocateBlock(size, heap, CALL_SITE());
+}
 
-	//Gets and returns the start of the usable memory block
-	void* pStartMemBlock = pMem + sizeof(Header);
-	return pStartMemBlock;
+void* operator new[](size_t size, Heap* heap) {
+	return AllocateBlock(size, heap, CALL_SITE());
 }
 
 void operator delete(void* pMem) {
@@ -76,6 +84,7 @@ void operator delete(void* pMem) {
 
 	//Deallocates the memory from the heap (handles the linked list)
 	pHeader->pHeap->DeallocateMemory(pHeader, pHeader->size);
+	if (HeapTelemetry::IsEnabled()) HeapTelemetry::RecordFree(pHeader->pHeap, pHeader->callSite, pHeader->size);
 
 	free(pHeader);
 }
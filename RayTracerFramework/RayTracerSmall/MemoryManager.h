@@ -11,6 +11,8 @@ struct Header {
 #endif
 
 	Heap* pHeap;
+	//Return address of the operator new that allocated the block
+	void* callSite;
 	Header* pPrevious = NULL;
 	Header* pNext = NULL;
 };
@@ -28,5 +30,6 @@ struct Footer {
 void* operator new(size_t size, Heap* heap);
 void* operator new[](size_t size, Heap* heap);
 void* operator new(size_t size);
+void* operator new[](size_t size);
 void operator delete(void* pMem);
 
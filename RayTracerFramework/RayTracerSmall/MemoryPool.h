@@ -1,24 +1,33 @@
 #pragma once
 #include <iostream>
+#include "HugePages.h"
 
 class MemoryPool
 {
 public:
-	MemoryPool(Heap* heap, unsigned long noOfChunks, unsigned long sizeOfChunks /* Recommended 2**n */) :
+	//With hugePages the pool is mapped on huge pages when the system has them, see HugePages, and falls back
+	//to malloc when it does not
+	MemoryPool(Heap* heap, unsigned long noOfChunks, unsigned long sizeOfChunks /* Recommended 2**n */, bool hugePages = false) :
 		_pMemBlock(nullptr),
 		_pAllocatedMemBlock(nullptr),
 		_pFreeMemBlock(nullptr),
 		_poolSize(noOfChunks * (sizeOfChunks + sizeof(Node))),
-		_blockSize(sizeOfChunks)
+		_blockSize(sizeOfChunks),
+		_mappedBytes(0),
+		_pageKind(PAGES_DEFAULT)
 	{
 		//Calculate required bytes 
 		size_t requestedBytes = _poolSize + sizeof(Header) + sizeof(Footer);
 		//Allocate memory
-		char* pMem = (char*)malloc(requestedBytes);
+		char* pMem = nullptr;
+		if (hugePages) pMem = (char*)HugePages::Allocate(requestedBytes, _mappedBytes, _pageKind);
+		if (pMem == nullptr) pMem = (char*)malloc(requestedBytes);
 
 		//Header is at the start of the memory block
 		Header* pHeader = (Header*)pMem;
 		pHeader->pHeap = heap;
+		//Pools are not made through operator new, there is no call site to record
+		pHeader->callSite = nullptr;
 
 		//Allocates the memory to the heap mem counter and inserts the pool into the linked list
 		heap->AllocateMemory(pHeader, _poolSize);
@@ -56,8 +65,25 @@ public:
 
 	~MemoryPool()
 	{
-		//Calls the global delete override
-		delete _pMemBlock;
+		if (_pageKind == PAGES_DEFAULT) {
+			//Calls the global delete override
+			delete _pMemBlock;
+			return;
+		}
+
+		//Mapped memory cannot go through the delete override, which frees with free()
+		Header* pHeader = (Header*)((char*)_pMemBlock - sizeof(Header));
+		pHeader->pHeap->DeallocateMemory(pHeader, _poolSize);
+		HugePages::Free(pHeader, _mappedBytes);
+	}
+
+	//What the pool's memory is backed by, PAGES_DEFAULT if huge pages were not asked for or not available
+	PageKind GetPageKind() const { return _pageKind; }
+
+	//Bytes a pool takes from its heap, for checking it fits the heap's budget before it is made
+	static size_t GetPoolSize(unsigned long noOfChunks, unsigned long sizeOfChunks)
+	{
+		return noOfChunks * (sizeOfChunks + sizeof(Node));
 	}
 
 	// Allocate memory unit If memory pool can`t provide proper memory unit,
@@ -131,4 +157,7 @@ private:
 
 	unsigned long _blockSize;//Size of one memory chunk
 	unsigned long _poolSize; //Memory pool size. Memory pool is make of memory unit.
+
+	size_t _mappedBytes; //Size of the huge page mapping, 0 when the pool came from malloc
+	PageKind _pageKind;
 };
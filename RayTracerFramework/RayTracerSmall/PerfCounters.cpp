@@ -0,0 +1,160 @@
+#include "PerfCounters.h"
+#include <iomanip>
+
+#if defined __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+#if defined __linux__
+//glibc does not provide a wrapper for perf_event_open
+static int OpenEvent(unsigned int type, unsigned long long config, bool includeChildren)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.inherit = includeChildren ? 1 : 0;
+	//Only count user space, this works with the default perf_event_paranoid setting
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	//pid 0 and cpu -1 measures the calling thread on any cpu
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long CacheMissConfig(unsigned long long cache, unsigned long long op = PERF_COUNT_HW_CACHE_OP_READ)
+{
+	return cache | (op << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters::PerfCounters(bool includeChildren, bool enabled)
+{
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) _fds[i] = -1;
+	if (!enabled) return;
+
+#if defined __linux__
+	_fds[PERF_CYCLES] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, includeChildren);
+	_fds[PERF_INSTRUCTIONS] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, includeChildren);
+	_fds[PERF_L1D_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_L1D), includeChildren);
+	_fds[PERF_LLC_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_LL), includeChildren);
+	_fds[PERF_BRANCH_MISSES] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, includeChildren);
+	_fds[PERF_DTLB_LOAD_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_DTLB), includeChildren);
+	_fds[PERF_DTLB_STORE_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_WRITE), includeChildren);
+
+	//Only warn once, otherwise every worker of every frame would print the same message
+	static bool warned = false;
+	if (!IsOpen() && !warned) {
+		warned = true;
+		std::cout << "[WARNING: PerfCounters.cpp: perf_event_open failed, hardware counters are unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined __linux__
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (_fds[i] != -1) close(_fds[i]);
+	}
+#endif
+}
+
+void PerfCounters::Start()
+{
+#if defined __linux__
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (_fds[i] == -1) continue;
+		ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+PerfSample PerfCounters::Stop()
+{
+	PerfSample sample;
+
+#if defined __linux__
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (_fds[i] == -1) continue;
+		ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (_fds[i] == -1) continue;
+
+		//value, time enabled, time running
+		unsigned long long data[3] = { 0, 0, 0 };
+		if (read(_fds[i], data, sizeof(data)) != sizeof(data)) continue;
+
+		//Scale the value up if the event only ran for part of the time it was enabled
+		if (data[2] != 0 && data[2] < data[1]) {
+			data[0] = (unsigned long long)((double)data[0] * ((double)data[1] / (double)data[2]));
+		}
+
+		sample.values[i] = data[0];
+		sample.valid[i] = true;
+	}
+#endif
+
+	return sample;
+}
+
+bool PerfCounters::IsOpen() const
+{
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (_fds[i] != -1) return true;
+	}
+	return false;
+}
+
+const char* PerfCounters::GetEventName(PerfEvent e)
+{
+	switch (e) {
+	case PERF_CYCLES: return "cycles";
+	case PERF_INSTRUCTIONS: return "instructions";
+	case PERF_L1D_MISSES: return "L1D-misses";
+	case PERF_LLC_MISSES: return "LLC-misses";
+	case PERF_BRANCH_MISSES: return "branch-misses";
+	case PERF_DTLB_LOAD_MISSES: return "dTLB-load-miss";
+	case PERF_DTLB_STORE_MISSES: return "dTLB-store-miss";
+	default: return "unknown";
+	}
+}
+
+void PerfCounters::PrintHeader(int frame)
+{
+	std::cout << "Perf counters frame " << frame << std::endl;
+	std::cout << std::left << std::setw(10) << "STAGE";
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		std::cout << std::right << std::setw(16) << GetEventName((PerfEvent)i);
+	}
+	std::cout << std::right << std::setw(8) << "IPC" << std::endl;
+}
+
+void PerfCounters::PrintSample(const char* stage, const PerfSample& sample)
+{
+	std::cout << std::left << std::setw(10) << stage;
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (sample.valid[i]) std::cout << std::right << std::setw(16) << sample.values[i];
+		else std::cout << std::right << std::setw(16) << "n/a";
+	}
+
+	//Instructions per cycle, the quickest indicator of whether a stage is stalled on memory
+	if (sample.valid[PERF_CYCLES] && sample.valid[PERF_INSTRUCTIONS] && sample.values[PERF_CYCLES] != 0) {
+		double ipc = (double)sample.values[PERF_INSTRUCTIONS] / (double)sample.values[PERF_CYCLES];
+		std::cout << std::right << std::setw(8) << std::fixed << std::setprecision(2) << ipc << std::defaultfloat;
+	}
+	else {
+		std::cout << std::right << std::setw(8) << "n/a";
+	}
+	std::cout << std::endl;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <iostream>
+
+//Hardware events that can be sampled around a section of code
+enum PerfEvent {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	//Page walks started by loads and stores missing the data TLB, what huge pages are meant to cut down
+	PERF_DTLB_LOAD_MISSES,
+	PERF_DTLB_STORE_MISSES,
+	PERF_EVENT_COUNT
+};
+
+//Counter values read from a PerfCounters object
+struct PerfSample {
+	unsigned long long values[PERF_EVENT_COUNT];
+	//Marks which of the events were opened successfully, some hosts (VMs mostly) do not expose every counter
+	bool valid[PERF_EVENT_COUNT];
+
+	PerfSample() {
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+			values[i] = 0;
+			valid[i] = false;
+		}
+	}
+
+	//Adds the values of another sample to this one, used to sum the workers of a frame
+	void Accumulate(const PerfSample& other) {
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+			values[i] += other.values[i];
+			valid[i] = valid[i] || other.valid[i];
+		}
+	}
+};
+
+//Wraps the linux perf_event_open interface. Each worker creates its own set of counters as
+//perf events are attached to the calling thread/process. On other platforms every sample is invalid.
+class PerfCounters
+{
+public:
+	//includeChildren makes the counters follow any process/thread created after Start(), needed to
+	//measure the whole of Render() as the workers are forked on linux. With enabled false nothing is
+	//opened, Start and Stop do nothing and every sample is invalid
+	PerfCounters(bool includeChildren = false, bool enabled = true);
+	~PerfCounters();
+
+	//Resets and enables the counters
+	void Start();
+	//Disables the counters and returns their values, scaled if the kernel had to multiplex them
+	PerfSample Stop();
+
+	//Returns true if at least one of the events could be opened
+	bool IsOpen() const;
+
+	static const char* GetEventName(PerfEvent e);
+
+	//Outputs one line per stage for a frame
+	static void PrintHeader(int frame);
+	static void PrintSample(const char* stage, const PerfSample& sample);
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+private:
+	int _fds[PERF_EVENT_COUNT];
+};
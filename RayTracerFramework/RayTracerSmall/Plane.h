@@ -0,0 +1,42 @@
+#pragma once
+#include "Primitive.h"
+
+//Infinite plane of every point p where _normal.dot(p) == _offset. Replaces the radius 10000 sphere
+//scenes used as a floor, the intersection is exact and costs two dot products
+class Plane : public Primitive
+{
+public:
+	Vec3f _normal;                           /// unit normal, the side the plane faces
+	float _offset;                           /// distance of the plane from the origin along the normal
+	Plane() : _normal(0, 1, 0), _offset(0) {}
+	Plane(
+		const Vec3f& normal,
+		const Vec3f& point,
+		const Vec3f& surfaceColor,
+		const float& reflection = 0,
+		const float& transparency = 0,
+		const Vec3f& emmisionColor = 0) :
+		Primitive(surfaceColor, reflection, transparency, emmisionColor)
+	{
+		Set(normal, point);
+	}
+
+	//Places the plane through a point, the normal does not have to be unit length
+	void Set(const Vec3f& normal, const Vec3f& point)
+	{
+		_normal = normal * (1 / normal.length());
+		_offset = _normal.dot(point);
+	}
+
+	//[comment]
+	// Compute a ray-plane intersection. Planes are two sided, rays parallel to the plane miss it
+	//[/comment]
+	bool intersect(const Vec3f& rayorig, const Vec3f& raydir, float& t) const
+	{
+		float denom = _normal.dot(raydir);
+		if (denom > -1e-6f && denom < 1e-6f) return false;
+		t = (_offset - _normal.dot(rayorig)) / denom;
+
+		return t > 0;
+	}
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include "Vec3.h"
+
+//Surface properties shared by every shape. Each shape type is kept in an array of its own so the
+//intersection loops never need a virtual call, trace only sees a Primitive once it has found the hit
+struct Primitive {
+	Vec3f _surfaceColor, _emissionColor;      /// surface color and emission (light)
+	float _transparency, _reflection;		/// surface transparency and reflectivity
+
+	Primitive() : _transparency(0.0f), _reflection(0.0f) {}
+	Primitive(
+		const Vec3f& surfaceColor,
+		const float& reflection,
+		const float& transparency,
+		const Vec3f& emmisionColor) :
+		_surfaceColor(surfaceColor), _emissionColor(emmisionColor), _transparency(transparency), _reflection(reflection) { }
+};
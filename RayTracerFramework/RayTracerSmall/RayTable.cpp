@@ -0,0 +1,48 @@
+#include "RayTable.h"
+#include <cstdint>
+
+//Bytes of one component array, rounded up so the next one starts aligned
+static size_t ArrayBytes(const RenderConfig& config)
+{
+	size_t bytes = (size_t)config.width * config.height * sizeof(float);
+	return (bytes + RAY_TABLE_ALIGNMENT - 1) / RAY_TABLE_ALIGNMENT * RAY_TABLE_ALIGNMENT;
+}
+
+size_t RayTable::GetSize(const RenderConfig& config)
+{
+	//operator new only aligns to 16 bytes, the extra is room to move the start up to the alignment
+	return ArrayBytes(config) * 3 + RAY_TABLE_ALIGNMENT;
+}
+
+RayTable::RayTable(const RenderConfig& config) : _width(config.width), _height(config.height), _fov(config.fov), _mathMode(config.mathMode)
+{
+	const size_t arrayBytes = ArrayBytes(config);
+	_memory = new char[GetSize(config)];
+	char* aligned = (char*)(((uintptr_t)_memory + RAY_TABLE_ALIGNMENT - 1) & ~(uintptr_t)(RAY_TABLE_ALIGNMENT - 1));
+	_x = (float*)aligned;
+	_y = (float*)(aligned + arrayBytes);
+	_z = (float*)(aligned + arrayBytes * 2);
+
+	size_t i = 0;
+	for (unsigned y = 0; y < _height; ++y) {
+		const RowRays rays(config, y);
+		for (unsigned x = 0; x < _width; ++x, ++i) {
+			Vec3f raydir = rays.Direction(x);
+			Normalize(_mathMode, raydir);
+			_x[i] = raydir.x;
+			_y[i] = raydir.y;
+			_z[i] = raydir.z;
+		}
+	}
+}
+
+RayTable::~RayTable()
+{
+	delete[] _memory;
+	_memory = nullptr;
+}
+
+bool RayTable::Matches(const RenderConfig& config) const
+{
+	return config.width == _width && config.height == _height && config.fov == _fov && config.mathMode == _mathMode;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include "RenderConfig.h"
+
+//Alignment of each component array, a cache line so rows of floats load whole lines
+#define RAY_TABLE_ALIGNMENT 64
+
+//The normalized primary ray direction of every pixel, made once and read by every frame instead of being worked
+//out again for each pixel. The directions only depend on the resolution, field of view and math mode, as the
+//camera sits at the origin looking down -z. Stored as separate x, y and z arrays (12 bytes a pixel), the loops
+//read them a row at a time. Made with the same RowRays and Normalize as the loops, so frames do not change.
+class RayTable
+{
+public:
+	RayTable(const RenderConfig& config);
+	~RayTable();
+
+	//Bytes the table takes, to check it fits in the heap budget before it is made
+	static size_t GetSize(const RenderConfig& config);
+
+	//False if the config has a different camera or math mode, the table has to be made again for it
+	bool Matches(const RenderConfig& config) const;
+
+	//Direction of pixel (x, y)
+	inline Vec3f GetDirection(const unsigned int& x, const unsigned int& y) const
+	{
+		size_t i = (size_t)y * _width + x;
+		return Vec3f(_x[i], _y[i], _z[i]);
+	}
+
+	RayTable(const RayTable&) = delete;
+	RayTable& operator=(const RayTable&) = delete;
+private:
+	unsigned _width;
+	unsigned _height;
+	float _fov;
+	MathMode _mathMode;
+
+	//One allocation holding the three arrays
+	char* _memory;
+	float* _x;
+	float* _y;
+	float* _z;
+};
@@ -1,15 +1,58 @@
 #pragma once
 #include "Vec3.h"
+#include "FastMath.h"
 #define M_PI 3.141592653589793
+//Balanced bands may grow to this many times the even band height, the frame buffers are sized for the largest
+#define MAX_CHUNK_SCALE 2
+
+//How the frame is split into buffers
+enum ContainerMode {
+	//Each worker renders into its own buffer
+	CONTAINERS_MULTIPLE,
+	//All workers render into one buffer the size of the frame
+	CONTAINERS_SINGULAR
+};
+
+//Where the frame buffers are allocated from
+enum AllocatorMode {
+	//MemoryPools created once at startup
+	ALLOCATOR_POOLS,
+	//The named ChunkHeap and CharHeap
+	ALLOCATOR_HEAPS,
+	//Plain new on the default heap
+	ALLOCATOR_NEW
+};
+
+//How the rows of a frame are shared between the workers
+enum BalanceMode {
+	//Every worker gets the same number of rows, give or take one
+	BALANCE_EVEN,
+	//Bands are sized from the row times of the previous frame
+	BALANCE_COST,
+	//Small tiles handed out longest first from the tile times of the previous frame
+	BALANCE_LPT
+};
+
+//When trace stops following reflection and refraction rays
+struct RayLimits {
+	//Maximum recursion depth of reflection and refraction rays
+	int maxDepth = 5;
+	//Secondary rays that can add less than this to the pixel are not traced. The throughput of a ray is the
+	//product of the Fresnel, transparency and surface colour weights on the way to it. 0 traces every ray
+	float minThroughput = 0.0f;
+	//Rays below minThroughput are kept at random instead, with a chance of throughput / minThroughput, and
+	//scaled up by the inverse of it so the average colour does not change
+	bool russianRoulette = false;
+};
 
 struct RenderConfig {
 	//Width of the frames produced
 	unsigned width;
 	//Height of the frames produced
 	unsigned height;
-	//Height of each chunk of the frame
+	//Most rows a chunk can have, the chunk buffers are sized for this
 	unsigned chunkHeight;
-	//Size of each chunk. (Width * chunkHeight)
+	//Size of the largest chunk. (Width * chunkHeight)
 	unsigned chunkSize;
 	//Size required to store each chunk in char form
 	size_t charSize;
@@ -26,9 +69,42 @@ struct RenderConfig {
 	//Angle of the camera. (tan(pi * 0.5 * fov / 180)
 	float angle;
 
+	//Size of the singular container, the whole frame. (Width * Height)
 	unsigned singularChunkSize;
 	unsigned singularCharSize;
 
+	//Number of workers the frame is split between
+	unsigned threadCount;
+	RayLimits rayLimits;
+	ContainerMode containerMode = CONTAINERS_MULTIPLE;
+	AllocatorMode allocatorMode = ALLOCATOR_POOLS;
+	BalanceMode balanceMode = BALANCE_COST;
+	MathMode mathMode = MATH_EXACT;
+	//Uses concurrency::parallel_for inside each worker (windows only)
+	bool useParallelFor = false;
+	//Reads hardware counters around each frame (linux only)
+	bool usePerfCounters = false;
+	//Supersamples the pixels on object and contrast edges after the frame is traced at one sample per pixel
+	bool adaptiveAA = false;
+	//Edge pixels get aaGridSize x aaGridSize extra samples
+	int aaGridSize = 2;
+	//Most of the pixels of a chunk that can be supersampled, keeps the cost bounded on busy frames
+	float aaBudget = 0.1f;
+	//Colour difference between neighbours, in 0-1 per channel, that makes a pixel an edge
+	float aaThreshold = 0.2f;
+	//Seconds each frame may take in the progressive preview mode, 0 renders every frame completely
+	float progressiveBudget = 0.0f;
+	//Pixels that nothing moved or changed colour for keep last frame's colour instead of being traced again
+	bool temporalReuse = false;
+	//Primary rays only test the spheres whose bounds on screen cover their tile
+	bool screenTiles = false;
+	//Diffuse hits trace a shadow ray to each light, without them every light reaches every surface facing it
+	bool shadows = true;
+	//The primary ray directions are made once and read from a table by every frame
+	bool rayTable = false;
+	//The frame buffer pools are mapped on huge pages, so the workers writing across them miss the TLB less
+	bool hugePages = false;
+
 	RenderConfig(unsigned width, unsigned height, unsigned threadCount, float fov = 30) {
 		this->width = width;
 		this->height = height;
@@ -43,8 +119,11 @@ private:
 
 	//Calculates all the values of the struct based on the width and height of the frames.
 	void CalculateValues(unsigned threadCount) {
-		chunkHeight = height / threadCount;
-		chunkSize = (width * height) / threadCount;
+		this->threadCount = threadCount;
+		//Rounded up so the bands can always cover the frame when the height does not divide by the thread count
+		unsigned evenHeight = (height + threadCount - 1) / threadCount;
+		chunkHeight = evenHeight * MAX_CHUNK_SCALE < height ? evenHeight * MAX_CHUNK_SCALE : height;
+		chunkSize = width * chunkHeight;
 		invWidth = 1 / float(width);
 		invHeight = 1 / float(height);
 		aspectRatio = width / float(height);
@@ -52,7 +131,25 @@ private:
 		vec3Size = chunkSize * sizeof(Vec3f);
 		angle = tan(M_PI * 0.5 * fov / 180.0f);
 
-		singularChunkSize = chunkSize * threadCount;
-		singularCharSize = charSize * threadCount;
+		singularChunkSize = width * height;
+		singularCharSize = singularChunkSize * 3;
 	}
-};
\ No newline at end of file
+};
+
+//Primary ray directions of one row of the frame, before they are normalized. yy is the same for the whole row
+//and xx steps by the same amount each column, in float. xx is worked out from the column rather than summed
+//along the row so a pixel gets the same ray whichever pixels are traced before it
+struct RowRays {
+	RowRays(const RenderConfig& config, const unsigned int& y) :
+		_xOrigin((config.invWidth - 1) * config.angle * config.aspectRatio),
+		_xStep(2 * config.invWidth * config.angle * config.aspectRatio),
+		_yy((1 - 2 * ((y + 0.5f) * config.invHeight)) * config.angle) {}
+
+	Vec3f Direction(const unsigned int& x) const { return Vec3f(_xOrigin + x * _xStep, _yy, -1); }
+
+private:
+	//xx of the centre of column 0, (2 * (0.5 / width) - 1) * angle * aspect
+	float _xOrigin;
+	float _xStep;
+	float _yy;
+};
@@ -0,0 +1,305 @@
+#include "RenderFarm.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "BinaryScene.h"
+
+static const uint32_t farmMagic = 0x4D465452;
+
+//Sends a header and its payload
+static bool WriteMessage(Socket* socket, FarmMessageType type, const void* data, size_t size)
+{
+	FarmMessageHeader header;
+	header.magic = farmMagic;
+	header.type = type;
+	header.size = size;
+	if (!socket->SendAll(&header, sizeof(header))) return false;
+	return size == 0 || socket->SendAll(data, size);
+}
+
+//Reads a header and its payload, rejecting anything that is not a farm message
+static bool ReadMessage(Socket* socket, FarmMessageHeader& header, std::vector<char>& payload)
+{
+	if (!socket->ReceiveAll(&header, sizeof(header))) return false;
+	if (header.magic != farmMagic || header.size > FARM_MAX_MESSAGE) {
+		std::cout << "[ERROR: RenderFarm.cpp: invalid message from " << socket->GetPeerName() << std::endl;
+		return false;
+	}
+
+	payload.resize((size_t)header.size);
+	return header.size == 0 || socket->ReceiveAll(payload.data(), payload.size());
+}
+
+FarmCoordinator::FarmCoordinator(const JSONSphereInfo& info, const json& config)
+{
+	//The worker id is filled in for each worker, the rest of the message is the same for all of them
+	std::string configText = config.dump();
+	uint32_t header[2] = { 0, (uint32_t)configText.size() };
+
+	std::ostringstream scene(std::ios::out | std::ios::binary);
+	BinaryScene::Write(info, scene);
+	std::string sceneBytes = scene.str();
+
+	_sceneMessage.resize(sizeof(header) + configText.size() + sceneBytes.size());
+	memcpy(_sceneMessage.data(), header, sizeof(header));
+	memcpy(_sceneMessage.data() + sizeof(header), configText.data(), configText.size());
+	memcpy(_sceneMessage.data() + sizeof(header) + configText.size(), sceneBytes.data(), sceneBytes.size());
+}
+
+FarmCoordinator::~FarmCoordinator()
+{
+	for (Worker* worker : _workers) {
+		delete worker->socket;
+		delete worker;
+	}
+	_workers.clear();
+}
+
+void FarmCoordinator::AddFrame(int frame)
+{
+	_pending.push_back(frame);
+	_outstanding++;
+}
+
+bool FarmCoordinator::Run(unsigned short port, const FrameSink& sink)
+{
+	if (!Socket::Startup()) return false;
+
+	Socket* listener = Socket::Listen(port);
+	if (listener == nullptr) {
+		Socket::Shutdown();
+		return false;
+	}
+
+	std::cout << "Farm coordinator listening on port " << port << " with " << _outstanding << " frames to render" << std::endl;
+
+	std::vector<Socket*> sockets;
+	std::vector<int> ready;
+	while (_outstanding > 0) {
+		//The listener is always first, the workers follow in order
+		sockets.clear();
+		sockets.push_back(listener);
+		for (Worker* worker : _workers) sockets.push_back(worker->socket);
+
+		//Wake up every second even when nothing arrives so hung workers are noticed
+		if (Socket::WaitForReadable(sockets, 1.0f, ready)) {
+			//Go backwards so dropping a worker does not move the ones still to be handled
+			for (int r = (int)ready.size() - 1; r >= 0; --r) {
+				if (ready[r] == 0) continue;
+				size_t index = ready[r] - 1;
+				if (!HandleMessage(*_workers[index], sink)) DropWorker(index, "disconnected");
+			}
+
+			if (ready[0] == 0) {
+				Socket* socket = listener->Accept();
+				if (socket != nullptr) {
+					socket->SetReceiveTimeout(FARM_RECEIVE_TIMEOUT);
+
+					Worker* worker = new Worker();
+					worker->socket = socket;
+					worker->id = _nextWorkerId++;
+					worker->frame = -1;
+					worker->waiting = false;
+
+					memcpy(_sceneMessage.data(), &worker->id, sizeof(uint32_t));
+					if (WriteMessage(socket, FARM_SCENE, _sceneMessage.data(), _sceneMessage.size())) {
+						std::cout << "Worker " << worker->id << " joined from " << socket->GetPeerName() << std::endl;
+						_workers.push_back(worker);
+					}
+					else {
+						delete socket;
+						delete worker;
+					}
+				}
+			}
+		}
+
+		for (int i = (int)_workers.size() - 1; i >= 0; --i) {
+			if (_workers[i]->frame >= 0 && _workers[i]->frameTimer.Peek() > FARM_FRAME_TIMEOUT) DropWorker(i, "timed out");
+		}
+
+		//Frames put back by dropped workers go to workers that are waiting
+		for (int i = (int)_workers.size() - 1; i >= 0; --i) {
+			if (_workers[i]->waiting && !_pending.empty() && !AssignFrame(*_workers[i])) DropWorker(i, "disconnected");
+		}
+	}
+
+	for (Worker* worker : _workers) WriteMessage(worker->socket, FARM_DONE, nullptr, 0);
+	std::cout << "Farm finished, " << _workers.size() << " workers connected at the end" << std::endl;
+
+	delete listener;
+	Socket::Shutdown();
+	return true;
+}
+
+bool FarmCoordinator::AssignFrame(Worker& worker)
+{
+	if (_pending.empty()) {
+		worker.waiting = true;
+		return true;
+	}
+
+	int frame = _pending.front();
+	_pending.pop_front();
+	worker.frame = frame;
+	worker.waiting = false;
+	worker.frameTimer.Mark();
+
+	int32_t message = frame;
+	return WriteMessage(worker.socket, FARM_FRAME, &message, sizeof(message));
+}
+
+bool FarmCoordinator::HandleMessage(Worker& worker, const FrameSink& sink)
+{
+	FarmMessageHeader header;
+	std::vector<char> payload;
+	if (!ReadMessage(worker.socket, header, payload)) return false;
+
+	if (header.type == FARM_READY) {
+		//Only sent once on joining, a worker with a frame is already busy
+		return worker.frame >= 0 || AssignFrame(worker);
+	}
+
+	if (header.type == FARM_RESULT && payload.size() >= sizeof(int32_t)) {
+		int32_t frame;
+		memcpy(&frame, payload.data(), sizeof(frame));
+		if (frame != worker.frame) {
+			std::cout << "[ERROR: RenderFarm.cpp: worker " << worker.id << " sent frame " << frame << " but was given frame " << worker.frame << std::endl;
+			return false;
+		}
+
+		float frameTime = worker.frameTimer.Peek();
+		payload.erase(payload.begin(), payload.begin() + sizeof(frame));
+		sink(frame, payload);
+		worker.frame = -1;
+		_outstanding--;
+		std::cout << "Worker " << worker.id << " finished frame " << frame << " in " << frameTime << "s, " << _outstanding << " frames left" << std::endl;
+
+		//A result also asks for the next frame, saving a round trip
+		return AssignFrame(worker);
+	}
+
+	std::cout << "[ERROR: RenderFarm.cpp: unexpected message " << header.type << " from worker " << worker.id << std::endl;
+	return false;
+}
+
+void FarmCoordinator::DropWorker(size_t index, const char* reason)
+{
+	Worker* worker = _workers[index];
+	std::cout << "[WARNING: RenderFarm.cpp: worker " << worker->id << " " << reason;
+	if (worker->frame >= 0) {
+		std::cout << ", frame " << worker->frame << " will be rendered again";
+		//At the front so the gap in the sequence is filled first
+		_pending.push_front(worker->frame);
+	}
+	std::cout << std::endl;
+
+	delete worker->socket;
+	delete worker;
+	_workers.erase(_workers.begin() + index);
+}
+
+FarmWorker::~FarmWorker()
+{
+	if (_socket != nullptr) {
+		delete _socket;
+		_socket = nullptr;
+		Socket::Shutdown();
+	}
+}
+
+JSONSphereInfo* FarmWorker::Join(const std::string& host, unsigned short port, json& config)
+{
+	if (!Socket::Startup()) return nullptr;
+
+	Timer timer;
+	while ((_socket = Socket::Connect(host, port)) == nullptr) {
+		if (timer.Peek() > FARM_CONNECT_RETRY) {
+			std::cout << "[ERROR: RenderFarm.cpp: could not connect to a coordinator on " << host << ":" << port << std::endl;
+			Socket::Shutdown();
+			return nullptr;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	}
+
+	FarmMessageHeader header;
+	std::vector<char> payload;
+	uint32_t sceneHeader[2];
+	if (!ReadMessage(_socket, header, payload) || header.type != FARM_SCENE || payload.size() < sizeof(sceneHeader)) {
+		std::cout << "[ERROR: RenderFarm.cpp: did not receive a scene from " << _socket->GetPeerName() << std::endl;
+		return nullptr;
+	}
+
+	memcpy(sceneHeader, payload.data(), sizeof(sceneHeader));
+	size_t configSize = sceneHeader[1];
+	if (sizeof(sceneHeader) + configSize > payload.size()) {
+		std::cout << "[ERROR: RenderFarm.cpp: the scene message from " << _socket->GetPeerName() << " is truncated" << std::endl;
+		return nullptr;
+	}
+
+	_id = (int)sceneHeader[0];
+	config = json::parse(std::string(payload.data() + sizeof(sceneHeader), configSize), nullptr, false);
+	if (config.is_discarded()) {
+		std::cout << "[ERROR: RenderFarm.cpp: the render settings from " << _socket->GetPeerName() << " are not valid json" << std::endl;
+		return nullptr;
+	}
+
+	const char* sceneData = payload.data() + sizeof(sceneHeader) + configSize;
+	BinaryScene* scene = BinaryScene::FromMemory(sceneData, payload.size() - sizeof(sceneHeader) - configSize);
+	if (scene == nullptr) return nullptr;
+
+	JSONSphereInfo* info = scene->CreateSphereInfo();
+	delete scene;
+
+	std::cout << "Joined the farm on " << _socket->GetPeerName() << " as worker " << _id << " (" << info->sphereCount << " spheres, " << info->frameCount << " frames)" << std::endl;
+
+	//Ask for the first frame now, it is queued on the socket while the frame buffers are set up.
+	//After that every result doubles as the request for the next frame
+	if (!WriteMessage(_socket, FARM_READY, nullptr, 0)) {
+		info->Cleanup();
+		delete info;
+		return nullptr;
+	}
+	return info;
+}
+
+int FarmWorker::NextFrame()
+{
+	FarmMessageHeader header;
+	std::vector<char> payload;
+	if (!ReadMessage(_socket, header, payload)) {
+		std::cout << "[ERROR: RenderFarm.cpp: lost the connection to the coordinator" << std::endl;
+		return -1;
+	}
+
+	if (header.type == FARM_FRAME && payload.size() == sizeof(int32_t)) {
+		int32_t frame;
+		memcpy(&frame, payload.data(), sizeof(frame));
+		return frame;
+	}
+
+	if (header.type != FARM_DONE) {
+		std::cout << "[ERROR: RenderFarm.cpp: unexpected message " << header.type << " from the coordinator" << std::endl;
+	}
+	return -1;
+}
+
+bool FarmWorker::SendFrame(int frame, const std::string& path)
+{
+	std::ifstream ifs(path, std::ios::in | std::ios::binary);
+	if (!ifs.is_open()) {
+		std::cout << "[ERROR: RenderFarm.cpp: could not read back " << path << std::endl;
+		return false;
+	}
+
+	//The frame number goes in front of the file
+	int32_t number = frame;
+	std::vector<char> message(sizeof(number));
+	memcpy(message.data(), &number, sizeof(number));
+	message.insert(message.end(), std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+
+	return WriteMessage(_socket, FARM_RESULT, message.data(), message.size());
+}
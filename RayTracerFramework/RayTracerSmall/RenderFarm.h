@@ -0,0 +1,107 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "JSONReader.h"
+#include "Socket.h"
+#include "Timer.h"
+
+using json = nlohmann::json;
+
+//Seconds a worker may spend on one frame before it is presumed hung and its frame is given to another worker
+#define FARM_FRAME_TIMEOUT 600
+//Seconds the coordinator waits for the rest of a message once it has started arriving
+#define FARM_RECEIVE_TIMEOUT 30
+//Seconds a worker keeps retrying to reach the coordinator, so workers can be started before it
+#define FARM_CONNECT_RETRY 10
+//Largest message either side accepts, guards against reading a garbage size from a broken stream
+#define FARM_MAX_MESSAGE (1ull << 31)
+
+//Messages between the coordinator and its workers. Every message is a FarmMessageHeader followed by size bytes
+enum FarmMessageType {
+	//Coordinator to worker on connect: worker id, render settings as json and the scene in the binary scene layout
+	FARM_SCENE = 1,
+	//Worker to coordinator once it has the scene: ready for its first frame
+	FARM_READY,
+	//Coordinator to worker: the frame number to render
+	FARM_FRAME,
+	//Worker to coordinator: the frame number followed by the encoded frame
+	FARM_RESULT,
+	//Coordinator to worker: every frame is finished, disconnect
+	FARM_DONE
+};
+
+struct FarmMessageHeader {
+	//"RTFM"
+	uint32_t magic;
+	uint32_t type;
+	uint64_t size;
+};
+
+//Hands the frames of an animation out to worker processes one at a time and collects the encoded frames.
+//Workers may join at any point, and a worker that disconnects or stops answering has its frame put back
+//at the front of the queue for the next free worker, so a dead machine only costs the frame it was on.
+class FarmCoordinator
+{
+public:
+	//Called with each finished frame, in the order they arrive
+	typedef std::function<void(int frame, const std::vector<char>& data)> FrameSink;
+
+	//The scene is serialized once here and the same bytes are sent to every worker
+	FarmCoordinator(const JSONSphereInfo& info, const json& config);
+	~FarmCoordinator();
+
+	void AddFrame(int frame);
+
+	//Serves frames until every added frame has been through the sink. Returns false if the port cannot be opened
+	bool Run(unsigned short port, const FrameSink& sink);
+
+private:
+	struct Worker {
+		Socket* socket;
+		int id;
+		//Frame being rendered, -1 while idle
+		int frame;
+		//Asked for a frame while none were left, given one if a frame is put back
+		bool waiting;
+		Timer frameTimer;
+	};
+
+	//Gives the worker the next frame, or leaves it waiting. Returns false if the worker has gone
+	bool AssignFrame(Worker& worker);
+	//Reads one message from a worker. Returns false if the worker has gone or sent something invalid
+	bool HandleMessage(Worker& worker, const FrameSink& sink);
+	//Closes the connection and puts its frame back in the queue
+	void DropWorker(size_t index, const char* reason);
+
+	std::vector<char> _sceneMessage;
+	std::deque<int> _pending;
+	std::vector<Worker*> _workers;
+	int _outstanding = 0;
+	int _nextWorkerId = 0;
+};
+
+//Connects to a coordinator, receives the scene and then renders whichever frames it is sent
+class FarmWorker
+{
+public:
+	~FarmWorker();
+
+	//Connects to host:port and receives the scene, config is filled with the coordinator's render settings.
+	//Returns nullptr if the coordinator cannot be reached
+	JSONSphereInfo* Join(const std::string& host, unsigned short port, json& config);
+
+	//Id the coordinator gave this worker, used to keep the files of workers on one machine apart
+	int GetId() const { return _id; }
+
+	//Waits for the next frame. Returns -1 when the coordinator is finished or has gone
+	int NextFrame();
+	//Sends a rendered frame file to the coordinator
+	bool SendFrame(int frame, const std::string& path);
+
+private:
+	Socket* _socket = nullptr;
+	int _id = -1;
+};
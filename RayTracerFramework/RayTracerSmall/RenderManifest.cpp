@@ -0,0 +1,162 @@
+#include "RenderManifest.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#define MANIFEST_VERSION 1
+
+RenderManifest::RenderManifest(const std::string& path, unsigned long long renderHash) : _path(path), _renderHash(renderHash)
+{
+}
+
+int RenderManifest::Load()
+{
+	_frames.clear();
+
+	std::ifstream ifs(_path);
+	if (!ifs.is_open()) {
+		WriteHeader();
+		return 0;
+	}
+
+	std::string magic;
+	int version = 0;
+	unsigned long long renderHash = 0;
+	ifs >> magic >> version >> renderHash;
+
+	if (magic != "RTMANIFEST" || version != MANIFEST_VERSION || renderHash != _renderHash) {
+		std::cout << "[WARNING: RenderManifest.cpp: " << _path << " belongs to a different scene or render settings, rendering every frame" << std::endl;
+		ifs.close();
+		Reset();
+		return 0;
+	}
+
+	//A line cut short by a crash fails to parse and ends the loop, everything before it is still valid. A line is
+	//only whole if it has its newline, the last line of a file cut short can look valid without it
+	std::string line;
+	std::getline(ifs, line);
+	bool damaged = false;
+	while (std::getline(ifs, line)) {
+		std::stringstream ss(line);
+		int frame;
+		FrameEntry entry;
+		if (ifs.eof() || !(ss >> frame >> entry.size >> entry.checksum) || !(ss >> std::ws).eof()) {
+			damaged = true;
+			break;
+		}
+		_frames[frame] = entry;
+	}
+	ifs.close();
+
+	//Frames recorded from now on would be appended to the broken line and lost, so the manifest is written again
+	//with the frames that were read
+	if (damaged) {
+		std::cout << "[WARNING: RenderManifest.cpp: " << _path << " ends with a damaged line, keeping the " << _frames.size() << " frames before it" << std::endl;
+		Rewrite();
+	}
+
+	return (int)_frames.size();
+}
+
+void RenderManifest::Rewrite()
+{
+	std::vector<int> frames;
+	for (const auto& it : _frames) frames.push_back(it.first);
+	std::sort(frames.begin(), frames.end());
+
+	//Written to a temporary file first so a crash while writing leaves the old manifest as it was
+	const std::string tempPath = _path + ".tmp";
+	{
+		std::ofstream ofs(tempPath, std::ios::out | std::ios::trunc);
+		ofs << "RTMANIFEST " << MANIFEST_VERSION << " " << _renderHash << "\n";
+		for (int frame : frames) {
+			const FrameEntry& entry = _frames[frame];
+			ofs << frame << " " << entry.size << " " << entry.checksum << "\n";
+		}
+		ofs.flush();
+		if (!ofs) {
+			std::cout << "[ERROR: RenderManifest.cpp: could not write " << tempPath << std::endl;
+			return;
+		}
+	}
+
+#if defined _WIN32
+	//rename does not replace an existing file on windows
+	remove(_path.c_str());
+#endif
+	if (rename(tempPath.c_str(), _path.c_str()) != 0) {
+		std::cout << "[ERROR: RenderManifest.cpp: could not replace " << _path << std::endl;
+	}
+}
+
+void RenderManifest::Reset()
+{
+	_frames.clear();
+	remove(_path.c_str());
+	WriteHeader();
+}
+
+void RenderManifest::WriteHeader()
+{
+	std::ofstream ofs(_path, std::ios::out | std::ios::trunc);
+	ofs << "RTMANIFEST " << MANIFEST_VERSION << " " << _renderHash << "\n";
+}
+
+bool RenderManifest::IsFrameComplete(int frame, const std::string& framePath) const
+{
+	auto it = _frames.find(frame);
+	if (it == _frames.end()) return false;
+
+	size_t size = 0;
+	unsigned long long checksum = HashFile(framePath, &size);
+	return size == it->second.size && checksum == it->second.checksum;
+}
+
+void RenderManifest::RecordFrame(int frame, const std::string& framePath)
+{
+	//Read the frame back rather than trusting the writer, this also confirms it reached the disk
+	FrameEntry entry;
+	entry.checksum = HashFile(framePath, &entry.size);
+	if (entry.size == 0) {
+		std::cout << "[ERROR: RenderManifest.cpp: " << framePath << " is missing or empty, not recording it" << std::endl;
+		return;
+	}
+	_frames[frame] = entry;
+
+	std::ofstream ofs(_path, std::ios::out | std::ios::app);
+	ofs << frame << " " << entry.size << " " << entry.checksum << "\n";
+	ofs.flush();
+}
+
+unsigned long long RenderManifest::Hash(const void* data, size_t size, unsigned long long seed)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = seed;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+unsigned long long RenderManifest::HashFile(const std::string& path, size_t* fileSize)
+{
+	std::ifstream ifs(path, std::ios::in | std::ios::binary);
+	unsigned long long hash = 14695981039346656037ULL;
+	size_t total = 0;
+
+	char buffer[64 * 1024];
+	while (ifs) {
+		ifs.read(buffer, sizeof(buffer));
+		std::streamsize count = ifs.gcount();
+		if (count <= 0) break;
+		hash = Hash(buffer, (size_t)count, hash);
+		total += (size_t)count;
+	}
+
+	if (fileSize != nullptr) *fileSize = total;
+	return hash;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+
+//Records which frames of an animation have been written so an interrupted render can carry on
+//where it stopped. The manifest is a small text file next to the frames:
+//	RTMANIFEST <version> <render hash>
+//	<frame> <file size> <file checksum>
+//Each frame line is appended and flushed after its file has been written, so any frame listed
+//in the manifest was completely on disk. The render hash covers the scene file and the render
+//settings, a manifest from a different scene or resolution is ignored.
+class RenderManifest
+{
+public:
+	RenderManifest(const std::string& path, unsigned long long renderHash);
+
+	//Reads an existing manifest. Returns the number of frames it lists
+	int Load();
+	//Deletes the manifest and starts a new one
+	void Reset();
+
+	//True if the frame is in the manifest and its file still exists with the same size and checksum
+	bool IsFrameComplete(int frame, const std::string& framePath) const;
+	//Adds a frame to the manifest once its file has been written
+	void RecordFrame(int frame, const std::string& framePath);
+
+	//FNV-1a hashes, used for the render hash and the frame checksums
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long seed = 14695981039346656037ULL);
+	static unsigned long long HashFile(const std::string& path, size_t* fileSize = nullptr);
+
+private:
+	struct FrameEntry {
+		size_t size;
+		unsigned long long checksum;
+	};
+
+	void WriteHeader();
+	//Writes the manifest again from the frames in memory, used to drop a damaged line
+	void Rewrite();
+
+	std::string _path;
+	unsigned long long _renderHash;
+	std::unordered_map<int, FrameEntry> _frames;
+};
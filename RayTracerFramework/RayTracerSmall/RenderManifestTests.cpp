@@ -0,0 +1,103 @@
+#include "SelfTest.h"
+#include "RenderManifest.h"
+#include <cstdio>
+#include <fstream>
+
+static void WriteFrame(const char* path, const std::string& contents)
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	ofs << contents;
+}
+
+void SelfTest::TestRenderManifest()
+{
+	const char* manifestPath = "selftest.manifest";
+	const char* frame0 = "selftest_frame0.ppm";
+	const char* frame1 = "selftest_frame1.ppm";
+	const unsigned long long hash = RenderManifest::Hash("scene", 5);
+	remove(manifestPath);
+
+	//A new manifest lists nothing
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 0);
+		SELF_CHECK(!manifest.IsFrameComplete(0, frame0));
+
+		WriteFrame(frame0, "P6\n1 1\n255\nabc");
+		WriteFrame(frame1, "P6\n1 1\n255\ndef");
+		manifest.RecordFrame(0, frame0);
+		manifest.RecordFrame(1, frame1);
+		//A missing frame is not recorded
+		manifest.RecordFrame(2, "selftest_missing.ppm");
+		SELF_CHECK(manifest.IsFrameComplete(0, frame0));
+		SELF_CHECK(!manifest.IsFrameComplete(2, "selftest_missing.ppm"));
+	}
+
+	//The next run with the same hash carries on from the recorded frames
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 2);
+		SELF_CHECK(manifest.IsFrameComplete(0, frame0));
+		SELF_CHECK(manifest.IsFrameComplete(1, frame1));
+		SELF_CHECK(!manifest.IsFrameComplete(2, "selftest_missing.ppm"));
+
+		//A frame changed or removed since it was recorded has to be rendered again
+		WriteFrame(frame1, "P6\n1 1\n255\nxyz");
+		SELF_CHECK(!manifest.IsFrameComplete(1, frame1));
+		remove(frame0);
+		SELF_CHECK(!manifest.IsFrameComplete(0, frame0));
+	}
+
+	//A line cut short by a crash ends the list, the frames before it are kept and the line is dropped so the
+	//frames recorded after it are read by the next run
+	{
+		std::ofstream ofs(manifestPath, std::ios::out | std::ios::app);
+		ofs << "5 12";
+	}
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 2);
+		WriteFrame(frame0, "P6\n1 1\n255\nabc");
+		manifest.RecordFrame(3, frame0);
+	}
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 3);
+		SELF_CHECK(manifest.IsFrameComplete(3, frame0));
+	}
+
+	//A last line without its newline can have lost digits, so it is dropped too
+	{
+		std::ofstream ofs(manifestPath, std::ios::out | std::ios::app);
+		ofs << "6 12 34";
+	}
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 3);
+		SELF_CHECK(!manifest.IsFrameComplete(6, frame0));
+	}
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 3);
+	}
+	remove(frame0);
+
+	//Other settings or another scene start again, and the old manifest is replaced
+	{
+		RenderManifest manifest(manifestPath, hash + 1);
+		SELF_CHECK(manifest.Load() == 0);
+		SELF_CHECK(!manifest.IsFrameComplete(1, frame1));
+	}
+	{
+		RenderManifest manifest(manifestPath, hash);
+		SELF_CHECK(manifest.Load() == 0);
+	}
+
+	//The hash depends on every byte it is given
+	const float settings[] = { 640.0f, 480.0f, 1.0f };
+	const float changed[] = { 640.0f, 480.0f, 0.0f };
+	SELF_CHECK(RenderManifest::Hash(settings, sizeof(settings)) != RenderManifest::Hash(changed, sizeof(changed)));
+
+	remove(frame1);
+	remove(manifestPath);
+}
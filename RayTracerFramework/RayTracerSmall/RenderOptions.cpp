@@ -0,0 +1,621 @@
+#include "RenderOptions.h"
+#include "RayTable.h"
+#include "ScreenTiles.h"
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+//Command line flag and the name used for the same option in the scene config block
+struct OptionName {
+	const char* flag;
+	const char* configName;
+	//false for switches that do not take a value
+	bool takesValue;
+};
+
+static const OptionName optionNames[] = {
+	{ "--scene", "scene", true },
+	{ "--width", "width", true },
+	{ "--height", "height", true },
+	{ "--fov", "fov", true },
+	{ "--threads", "threads", true },
+	{ "--max-depth", "maxDepth", true },
+	{ "--min-throughput", "minThroughput", true },
+	{ "--roulette", "russianRoulette", false },
+	{ "--shadows", "shadows", true },
+	{ "--containers", "containers", true },
+	{ "--allocator", "allocator", true },
+	{ "--balance", "balance", true },
+	{ "--math", "math", true },
+	{ "--parallel-for", "parallelFor", false },
+	{ "--perf", "perfCounters", false },
+	{ "--aa", "antiAliasing", false },
+	{ "--aa-samples", "aaSamples", true },
+	{ "--aa-budget", "aaBudget", true },
+	{ "--aa-threshold", "aaThreshold", true },
+	{ "--progressive", "progressive", true },
+	{ "--temporal", "temporal", false },
+	{ "--screen-tiles", "screenTiles", false },
+	{ "--huge-pages", "hugePages", false },
+	{ "--ray-table", "rayTable", false },
+	{ "--heap-telemetry", "heapTelemetry", true },
+	{ "--heap-budget", "heapBudget", true },
+};
+
+static bool ParseUnsigned(const std::string& value, unsigned& out)
+{
+	std::stringstream ss(value);
+	long long result;
+	if (!(ss >> result) || !ss.eof() || result < 0 || result > UINT_MAX) return false;
+	out = (unsigned)result;
+	return true;
+}
+
+static bool ParseFloat(const std::string& value, float& out)
+{
+	std::stringstream ss(value);
+	float result;
+	if (!(ss >> result) || !ss.eof()) return false;
+	out = result;
+	return true;
+}
+
+//A byte count with an optional K, M or G suffix
+static bool ParseBytes(const std::string& value, long long& out)
+{
+	std::stringstream ss(value);
+	double amount;
+	if (!(ss >> amount) || amount < 0) return false;
+
+	long long scale = 1;
+	char suffix;
+	if (ss >> suffix) {
+		if (suffix == 'K' || suffix == 'k') scale = 1ll << 10;
+		else if (suffix == 'M' || suffix == 'm') scale = 1ll << 20;
+		else if (suffix == 'G' || suffix == 'g') scale = 1ll << 30;
+		else return false;
+		if (ss >> suffix) return false;
+	}
+	out = (long long)(amount * scale);
+	return true;
+}
+
+static bool ParseBool(const std::string& value, bool& out)
+{
+	if (value == "true" || value == "1" || value == "on") out = true;
+	else if (value == "false" || value == "0" || value == "off") out = false;
+	else return false;
+	return true;
+}
+
+bool RenderOptions::SetOption(const std::string& name, const std::string& value)
+{
+	unsigned number = 0;
+
+	if (name == "scene") {
+		scenePath = value;
+	}
+	else if (name == "heapTelemetry") {
+		heapTelemetryPath = value;
+	}
+	else if (name == "heapBudget") {
+		//Name=bytes pairs split by commas
+		heapBudgets.clear();
+		std::stringstream ss(value);
+		std::string entry;
+		while (std::getline(ss, entry, ',')) {
+			size_t equals = entry.find('=');
+			long long bytes = 0;
+			if (equals == std::string::npos || equals == 0 || !ParseBytes(entry.substr(equals + 1), bytes)) {
+				std::cout << "[ERROR: RenderOptions.cpp: heapBudget must be Heap=bytes pairs split by commas, such as ChunkHeap=16M, got \"" << entry << "\"" << std::endl;
+				return false;
+			}
+			heapBudgets.push_back(std::make_pair(entry.substr(0, equals), bytes));
+		}
+	}
+	else if (name == "width" || name == "height") {
+		if (!ParseUnsigned(value, number) || number == 0) {
+			std::cout << "[ERROR: RenderOptions.cpp: " << name << " must be a positive whole number, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		if (name == "width") width = number;
+		else height = number;
+	}
+	else if (name == "threads" || name == "maxDepth") {
+		//0 threads uses the hardware concurrency and a max depth of 0 traces primary rays only
+		if (!ParseUnsigned(value, number)) {
+			std::cout << "[ERROR: RenderOptions.cpp: " << name << " must be a whole number, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		if (name == "threads") threadCount = number;
+		else maxRayDepth = (int)number;
+	}
+	else if (name == "fov") {
+		//The camera scales the screen by tan(fov / 2), which is zero at 0 and infinite at 180
+		float degrees = 0.0f;
+		if (!ParseFloat(value, degrees) || degrees <= 0.0f || degrees >= 180.0f) {
+			std::cout << "[ERROR: RenderOptions.cpp: fov must be a number of degrees above 0 and below 180, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		fov = degrees;
+	}
+	else if (name == "containers") {
+		if (value == "multiple") containerMode = CONTAINERS_MULTIPLE;
+		else if (value == "singular") containerMode = CONTAINERS_SINGULAR;
+		else {
+			std::cout << "[ERROR: RenderOptions.cpp: containers must be multiple or singular, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+	}
+	else if (name == "allocator") {
+		if (value == "pools") allocatorMode = ALLOCATOR_POOLS;
+		else if (value == "heaps") allocatorMode = ALLOCATOR_HEAPS;
+		else if (value == "new") allocatorMode = ALLOCATOR_NEW;
+		else {
+			std::cout << "[ERROR: RenderOptions.cpp: allocator must be pools, heaps or new, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+	}
+	else if (name == "balance") {
+		if (value == "even") balanceMode = BALANCE_EVEN;
+		else if (value == "cost") balanceMode = BALANCE_COST;
+		else if (value == "lpt") balanceMode = BALANCE_LPT;
+		else {
+			std::cout << "[ERROR: RenderOptions.cpp: balance must be even, cost or lpt, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+	}
+	else if (name == "math") {
+		if (value == "exact") mathMode = MATH_EXACT;
+		else if (value == "fast") mathMode = MATH_FAST;
+		else if (value == "fastest") mathMode = MATH_FASTEST;
+		else {
+			std::cout << "[ERROR: RenderOptions.cpp: math must be exact, fast or fastest, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+	}
+	else if (name == "aaSamples") {
+		if (!ParseUnsigned(value, number) || number == 0 || number > 64) {
+			std::cout << "[ERROR: RenderOptions.cpp: aaSamples must be a whole number from 1 to 64, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		aaSamples = number;
+	}
+	else if (name == "aaBudget" || name == "aaThreshold" || name == "minThroughput") {
+		float fraction = 0.0f;
+		if (!ParseFloat(value, fraction) || fraction < 0.0f || fraction > 1.0f) {
+			std::cout << "[ERROR: RenderOptions.cpp: " << name << " must be a number from 0 to 1, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		if (name == "aaBudget") aaBudget = fraction;
+		else if (name == "aaThreshold") aaThreshold = fraction;
+		else minThroughput = fraction;
+	}
+	else if (name == "progressive") {
+		if (!ParseFloat(value, progressiveBudget) || progressiveBudget < 0.0f) {
+			std::cout << "[ERROR: RenderOptions.cpp: progressive must be a time in milliseconds, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+	}
+	else if (name == "parallelFor" || name == "perfCounters" || name == "antiAliasing" || name == "russianRoulette" || name == "temporal" ||
+		name == "screenTiles" || name == "hugePages" || name == "shadows" ||
+		name == "rayTable") {
+		bool flag = false;
+		if (!ParseBool(value, flag)) {
+			std::cout << "[ERROR: RenderOptions.cpp: " << name << " must be true or false, got \"" << value << "\"" << std::endl;
+			return false;
+		}
+		if (name == "parallelFor") useParallelFor = flag;
+		else if (name == "perfCounters") usePerfCounters = flag;
+		else if (name == "antiAliasing") adaptiveAA = flag;
+		else if (name == "temporal") temporalReuse = flag;
+		else if (name == "screenTiles") screenTiles = flag;
+		else if (name == "hugePages") hugePages = flag;
+		else if (name == "shadows") shadows = flag;
+		else if (name == "rayTable") rayTable = flag;
+		else russianRoulette = flag;
+	}
+	else {
+		std::cout << "[ERROR: RenderOptions.cpp: unknown option \"" << name << "\"" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool RenderOptions::ParseCommandLine(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--help" || arg == "-h") {
+			command = COMMAND_HELP;
+			return true;
+		}
+		if (arg == "--restart") {
+			restart = true;
+			continue;
+		}
+		if (arg == "--demo") {
+			if (i + 1 >= argc) {
+				std::cout << "[ERROR: RenderOptions.cpp: --demo needs basic, shrinking or smooth" << std::endl;
+				return false;
+			}
+			command = COMMAND_DEMO;
+			demoName = argv[++i];
+			continue;
+		}
+		if (arg == "--convert") {
+			if (i + 2 >= argc) {
+				std::cout << "[ERROR: RenderOptions.cpp: --convert needs an input json and an output file" << std::endl;
+				return false;
+			}
+			command = COMMAND_CONVERT;
+			convertInput = argv[++i];
+			convertOutput = argv[++i];
+			continue;
+		}
+		if (arg == "--bench-trace") {
+			command = COMMAND_BENCH_TRACE;
+			continue;
+		}
+		if (arg == "--bench-math") {
+			command = COMMAND_BENCH_MATH;
+			continue;
+		}
+		if (arg == "--bench-termination") {
+			command = COMMAND_BENCH_TERMINATION;
+			continue;
+		}
+		if (arg == "--bench-rays") {
+			command = COMMAND_BENCH_RAYS;
+			//The frame sizes are optional
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				benchResolutions.clear();
+				std::stringstream ss(argv[++i]);
+				std::string size;
+				while (std::getline(ss, size, ',')) {
+					size_t cross = size.find('x');
+					unsigned width = 0, height = 0;
+					if (cross == std::string::npos || !ParseUnsigned(size.substr(0, cross), width) || !ParseUnsigned(size.substr(cross + 1), height) || width == 0 || height == 0) {
+						std::cout << "[ERROR: RenderOptions.cpp: --bench-rays needs frame sizes as WxH, got \"" << size << "\"" << std::endl;
+						return false;
+					}
+					benchResolutions.push_back(std::make_pair(width, height));
+				}
+			}
+			continue;
+		}
+		if (arg == "--self-test") {
+			command = COMMAND_SELF_TEST;
+			continue;
+		}
+		if (arg == "--bench-loops") {
+			command = COMMAND_BENCH_LOOPS;
+			continue;
+		}
+		if (arg == "--bench-pages") {
+			command = COMMAND_BENCH_PAGES;
+			continue;
+		}
+		if (arg == "--farm-coordinator") {
+			unsigned port = 0;
+			if (i + 1 >= argc || !ParseUnsigned(argv[i + 1], port) || port == 0 || port > 65535) {
+				std::cout << "[ERROR: RenderOptions.cpp: --farm-coordinator needs a port number" << std::endl;
+				return false;
+			}
+			command = COMMAND_FARM_COORDINATOR;
+			farmPort = (unsigned short)port;
+			++i;
+			continue;
+		}
+		if (arg == "--farm-worker") {
+			std::string address = i + 1 < argc ? argv[i + 1] : "";
+			size_t colon = address.rfind(':');
+			unsigned port = 0;
+			if (colon == std::string::npos || colon == 0 || !ParseUnsigned(address.substr(colon + 1), port) || port == 0 || port > 65535) {
+				std::cout << "[ERROR: RenderOptions.cpp: --farm-worker needs the coordinator as host:port" << std::endl;
+				return false;
+			}
+			command = COMMAND_FARM_WORKER;
+			farmHost = address.substr(0, colon);
+			farmPort = (unsigned short)port;
+			++i;
+			continue;
+		}
+		if (arg == "--shard") {
+			std::string shard = i + 1 < argc ? argv[i + 1] : "";
+			size_t slash = shard.find('/');
+			unsigned index = 0;
+			unsigned count = 0;
+			if (slash == std::string::npos || !ParseUnsigned(shard.substr(0, slash), index) || !ParseUnsigned(shard.substr(slash + 1), count) || index >= count) {
+				std::cout << "[ERROR: RenderOptions.cpp: --shard needs i/N with i from 0 to N - 1" << std::endl;
+				return false;
+			}
+			command = COMMAND_SHARD;
+			shardIndex = (int)index;
+			shardCount = (int)count;
+			++i;
+			continue;
+		}
+		if (arg == "--assemble") {
+			unsigned count = 0;
+			if (i + 1 >= argc || !ParseUnsigned(argv[i + 1], count) || count == 0) {
+				std::cout << "[ERROR: RenderOptions.cpp: --assemble needs the number of shards" << std::endl;
+				return false;
+			}
+			command = COMMAND_ASSEMBLE;
+			shardCount = (int)count;
+			++i;
+			continue;
+		}
+		if (arg == "--bench-load") {
+			command = COMMAND_BENCH_LOAD;
+			//The sphere counts are optional
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				benchSphereCounts.clear();
+				std::stringstream ss(argv[++i]);
+				std::string count;
+				while (std::getline(ss, count, ',')) {
+					unsigned sphereCount = 0;
+					if (!ParseUnsigned(count, sphereCount) || sphereCount == 0 || sphereCount > INT_MAX) {
+						std::cout << "[ERROR: RenderOptions.cpp: --bench-load needs sphere counts as positive whole numbers, got \"" << count << "\"" << std::endl;
+						return false;
+					}
+					benchSphereCounts.push_back((int)sphereCount);
+				}
+			}
+			continue;
+		}
+
+		//A plain argument is the scene to render
+		if (arg[0] != '-') {
+			scenePath = arg;
+			_commandLineOptions.insert("scene");
+			continue;
+		}
+
+		//Options shared with the scene config, written as "--name value" or "--name=value"
+		std::string value;
+		size_t equals = arg.find('=');
+		if (equals != std::string::npos) {
+			value = arg.substr(equals + 1);
+			arg = arg.substr(0, equals);
+		}
+
+		const OptionName* option = nullptr;
+		for (const OptionName& candidate : optionNames) {
+			if (arg == candidate.flag) option = &candidate;
+		}
+		if (option == nullptr) {
+			std::cout << "[ERROR: RenderOptions.cpp: unknown argument \"" << arg << "\", use --help to list the options" << std::endl;
+			return false;
+		}
+
+		if (equals == std::string::npos) {
+			if (!option->takesValue) value = "true";
+			else if (i + 1 < argc) value = argv[++i];
+			else {
+				std::cout << "[ERROR: RenderOptions.cpp: " << arg << " needs a value" << std::endl;
+				return false;
+			}
+		}
+
+		if (!SetOption(option->configName, value)) return false;
+		_commandLineOptions.insert(option->configName);
+	}
+
+	return true;
+}
+
+bool RenderOptions::ApplySceneConfig(const json& config)
+{
+	if (!config.is_object()) return true;
+
+	for (auto it = config.begin(); it != config.end(); ++it) {
+		//The command line always wins so one scene can be run with different settings
+		if (_commandLineOptions.count(it.key()) > 0) continue;
+
+		//The scene cannot point to another scene
+		if (it.key() == "scene") continue;
+
+		std::string value;
+		if (it.value().is_string()) value = it.value().get<std::string>();
+		else if (it.value().is_boolean()) value = it.value().get<bool>() ? "true" : "false";
+		else if (it.value().is_number_float()) value = std::to_string(it.value().get<float>());
+		else if (it.value().is_number()) value = std::to_string(it.value().get<long long>());
+		else {
+			std::cout << "[ERROR: RenderOptions.cpp: config option \"" << it.key() << "\" must be a string, number or bool" << std::endl;
+			return false;
+		}
+
+		if (!SetOption(it.key(), value)) return false;
+	}
+
+	return true;
+}
+
+RenderConfig RenderOptions::CreateRenderConfig() const
+{
+	unsigned threads = threadCount;
+	if (threads == 0) {
+		//hardware_concurrency can return 0 if it cannot tell
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+	}
+
+	RenderConfig config = RenderConfig(width, height, threads, fov);
+	config.rayLimits.maxDepth = maxRayDepth;
+	config.rayLimits.minThroughput = minThroughput;
+	config.rayLimits.russianRoulette = russianRoulette;
+	config.containerMode = containerMode;
+	config.allocatorMode = allocatorMode;
+	config.balanceMode = balanceMode;
+	config.mathMode = mathMode;
+	config.useParallelFor = useParallelFor;
+	config.usePerfCounters = usePerfCounters;
+	config.adaptiveAA = adaptiveAA;
+	config.progressiveBudget = progressiveBudget / 1000.0f;
+	config.temporalReuse = temporalReuse;
+	config.screenTiles = screenTiles;
+	config.hugePages = hugePages;
+	config.rayTable = rayTable;
+	config.shadows = shadows;
+	config.aaBudget = aaBudget;
+	config.aaThreshold = aaThreshold;
+	//The samples are laid out on a square grid, rounded down to the nearest square
+	config.aaGridSize = 1;
+	while ((unsigned)((config.aaGridSize + 1) * (config.aaGridSize + 1)) <= aaSamples) config.aaGridSize++;
+
+	if (temporalReuse && progressiveBudget > 0.0f) {
+		std::cout << "[WARNING: RenderOptions.cpp: the progressive preview traces every pixel in passes, ignoring --temporal" << std::endl;
+		config.temporalReuse = false;
+	}
+
+#if !defined _WIN32
+	if (useParallelFor) {
+		std::cout << "[WARNING: RenderOptions.cpp: --parallel-for needs the windows concurrency runtime, ignoring it" << std::endl;
+		config.useParallelFor = false;
+	}
+#endif
+
+	return config;
+}
+
+json RenderOptions::ToConfig() const
+{
+	json config;
+	config["width"] = width;
+	config["height"] = height;
+	config["fov"] = fov;
+	config["maxDepth"] = maxRayDepth;
+	config["minThroughput"] = minThroughput;
+	config["russianRoulette"] = russianRoulette;
+	config["shadows"] = shadows;
+	config["containers"] = containerMode == CONTAINERS_MULTIPLE ? "multiple" : "singular";
+	config["allocator"] = allocatorMode == ALLOCATOR_POOLS ? "pools" : allocatorMode == ALLOCATOR_HEAPS ? "heaps" : "new";
+	config["balance"] = balanceMode == BALANCE_EVEN ? "even" : balanceMode == BALANCE_COST ? "cost" : "lpt";
+	config["math"] = GetMathModeName(mathMode);
+	config["antiAliasing"] = adaptiveAA;
+	config["aaSamples"] = aaSamples;
+	config["aaBudget"] = aaBudget;
+	config["aaThreshold"] = aaThreshold;
+	config["progressive"] = progressiveBudget;
+	config["temporal"] = temporalReuse;
+	config["screenTiles"] = screenTiles;
+	config["hugePages"] = hugePages;
+	config["rayTable"] = rayTable;
+	return config;
+}
+
+void RenderOptions::Print() const
+{
+	RenderConfig config = CreateRenderConfig();
+
+	std::cout << "Scene: " << scenePath << std::endl;
+	std::cout << "Resolution: " << config.width << "x" << config.height << "\tFov: " << config.fov << "\tMax depth: " << config.rayLimits.maxDepth;
+	if (!config.shadows) {
+		std::cout << "\tShadows: off";
+	}
+	if (config.rayLimits.minThroughput > 0.0f) {
+		std::cout << "\tMin throughput: " << config.rayLimits.minThroughput << (config.rayLimits.russianRoulette ? " (russian roulette)" : "");
+	}
+	std::cout << std::endl;
+	std::cout << "Threads: " << config.threadCount
+		<< "\tContainers: " << (config.containerMode == CONTAINERS_MULTIPLE ? "multiple" : "singular")
+		<< "\tAllocator: " << (config.allocatorMode == ALLOCATOR_POOLS ? "pools" : config.allocatorMode == ALLOCATOR_HEAPS ? "heaps" : "new")
+		<< "\tBalance: " << (config.balanceMode == BALANCE_EVEN ? "even" : config.balanceMode == BALANCE_COST ? "cost" : "lpt")
+		<< "\tMath: " << GetMathModeName(config.mathMode)
+		<< "\tParallel for: " << (config.useParallelFor ? "on" : "off")
+		<< "\tPerf counters: " << (config.usePerfCounters ? "on" : "off") << std::endl;
+	if (config.adaptiveAA) {
+		std::cout << "Adaptive AA: " << config.aaGridSize * config.aaGridSize << " samples per edge pixel\tBudget: "
+			<< config.aaBudget << "\tThreshold: " << config.aaThreshold << std::endl;
+	}
+	if (config.progressiveBudget > 0.0f) {
+		std::cout << "Progressive preview: " << progressiveBudget << " ms per frame" << std::endl;
+	}
+	if (config.temporalReuse) {
+		std::cout << "Temporal reuse: on" << std::endl;
+	}
+	if (config.screenTiles) {
+		std::cout << "Screen tiles: " << SCREEN_TILE_SIZE << "x" << SCREEN_TILE_SIZE << " pixels" << std::endl;
+	}
+	if (config.hugePages) {
+		std::cout << "Huge pages: on" << std::endl;
+	}
+	if (config.rayTable) {
+		std::cout << "Ray table: " << RayTable::GetSize(config) / (1024 * 1024) << " MB" << std::endl;
+	}
+	if (!heapBudgets.empty()) {
+		std::cout << "Heap budgets:";
+		for (const std::pair<std::string, long long>& budget : heapBudgets) std::cout << "\t" << budget.first << " " << budget.second << " bytes";
+		std::cout << std::endl;
+	}
+	if (!heapTelemetryPath.empty()) {
+		std::cout << "Heap telemetry: " << heapTelemetryPath << std::endl;
+	}
+}
+
+void RenderOptions::PrintUsage()
+{
+	std::cout << "Usage: RayTracerSmall [options] [scene]\n"
+		"\n"
+		"Render options, also accepted in a \"config\" object in the scene json (name in brackets):\n"
+		"  --scene <path>                 scene to render, json or .rtscene (default Animations/animSample.json)\n"
+		"  --width <n>                    frame width (width, default 640)\n"
+		"  --height <n>                   frame height (height, default 480)\n"
+		"  --fov <degrees>                field of view (fov, default 30)\n"
+		"  --threads <n>                  number of workers (threads, default hardware concurrency)\n"
+		"  --max-depth <n>                reflection/refraction recursion depth (maxDepth, default 5)\n"
+		"  --min-throughput <0-1>         stop secondary rays that add less than this to the pixel (minThroughput, default 0)\n"
+		"  --roulette                     keep rays below the throughput at random, unbiased (russianRoulette)\n"
+		"  --shadows on|off               trace shadow rays toward the lights, off for quicker previews (shadows, default on)\n"
+		"  --containers multiple|singular one buffer per worker or one for the frame (containers)\n"
+		"  --allocator pools|heaps|new    frame buffer allocation strategy (allocator)\n"
+		"  --balance even|cost|lpt        equal rows per worker, rows sized from the last frame's row times, or\n"
+		"                                 tiles handed out longest first from the last frame's times (balance)\n"
+		"  --math exact|fast|fastest      precision of normalize, sqrt and the Fresnel power (math, default exact)\n"
+		"  --parallel-for                 parallel_for inside each worker, windows only (parallelFor)\n"
+		"  --perf                         hardware counters per frame, linux only (perfCounters)\n"
+		"  --aa                           supersample pixels on object and colour edges (antiAliasing)\n"
+		"  --aa-samples <n>               extra samples per edge pixel, rounded down to 4, 9, 16... (aaSamples, default 4)\n"
+		"  --aa-budget <0-1>              most of each 16x16 tile that can be supersampled (aaBudget, default 0.1)\n"
+		"  --aa-threshold <0-1>           colour difference between neighbours that marks an edge (aaThreshold, default 0.2)\n"
+		"  --progressive <ms>             preview mode, refine each frame in passes until the time runs out (progressive)\n"
+		"  --temporal                     keep last frame's colour for pixels nothing moved or changed for (temporal)\n"
+		"  --screen-tiles                 primary rays only test the spheres near their tile of the screen (screenTiles)\n"
+		"  --ray-table                    make the primary ray directions once and read them every frame, 12 bytes a\n"
+		"                                 pixel on the DefaultHeap (rayTable)\n"
+		"  --huge-pages                   back the frame buffer pools with 2MB pages where the system has them, needs\n"
+		"                                 the pools allocator (hugePages)\n"
+		"  --heap-telemetry <file>        record allocation call sites, size histograms and per frame counts, written\n"
+		"                                 as json when the render finishes (heapTelemetry)\n"
+		"  --heap-budget <Heap=bytes,...> most bytes ChunkHeap, CharHeap or DefaultHeap may hold, K/M/G suffixes. Frames\n"
+		"                                 whose buffers do not fit are rendered a band at a time. The DefaultHeap budget\n"
+		"                                 has to leave room for the rest of a frame, the render stops if it does not\n"
+		"                                 (heapBudget)\n"
+		"\n"
+		"Other commands:\n"
+		"  --restart                      ignore render.manifest and render every frame\n"
+		"  --demo basic|shrinking|smooth  render one of the built in scenes\n"
+		"  --convert <in.json> <out>      compile a json scene to a binary .rtscene. It loads without parsing, but the\n"
+		"                                 spheres are still copied out of the file once per load for the renderer\n"
+		"  --bench-load [counts]          benchmark the scene loaders (default 1000,100000,1000000)\n"
+		"  --bench-trace                  time trace() over the first frame of the scene on one thread. Prints the Vec3f\n"
+		"                                 version in use, build with VEC3_NO_SIMD defined for the scalar one to compare\n"
+		"  --bench-math                   time each math mode on the first frame and report its PSNR against exact\n"
+		"  --bench-termination            time throughput cutoffs with and without russian roulette against full depth\n"
+		"  --bench-loops                  time the render loop with each output layout and schedule on the first frame\n"
+		"  --bench-rays [WxH,...]         time making the primary rays against reading them from a ray table at each\n"
+		"                                 frame size (default 640x480,1920x1080,3840x2160)\n"
+		"  --bench-pages                  time workers writing frame buffer pools on 4KB and huge pages and report dTLB\n"
+		"                                 misses, use --width/--height for the frame size (try 3840x2160)\n"
+		"  --farm-coordinator <port>      load the scene and hand its frames out to farm workers that connect on the port\n"
+		"  --farm-worker <host:port>      render frames for a coordinator, render options given here override its own\n"
+		"  --shard <i>/<N>                render frames where frame % N == i and pass them to the assembler, linux only\n"
+		"  --assemble <N>                 collect the frames of N shards started with the same scene and options\n"
+		"  --self-test                    run the behaviour checks of the modules, exits with 1 if any fail\n"
+		"  --help                         show this message\n";
+}
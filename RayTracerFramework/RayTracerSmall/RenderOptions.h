@@ -0,0 +1,110 @@
+#pragma once
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "json.hpp"
+#include "RenderConfig.h"
+
+using json = nlohmann::json;
+
+//What the program does when it is run
+enum ProgramCommand {
+	COMMAND_RENDER_SCENE,
+	COMMAND_DEMO,
+	COMMAND_CONVERT,
+	COMMAND_BENCH_LOAD,
+	COMMAND_BENCH_TRACE,
+	COMMAND_BENCH_MATH,
+	COMMAND_BENCH_TERMINATION,
+	COMMAND_BENCH_PAGES,
+	COMMAND_BENCH_LOOPS,
+	COMMAND_BENCH_RAYS,
+	COMMAND_FARM_COORDINATOR,
+	COMMAND_FARM_WORKER,
+	COMMAND_SHARD,
+	COMMAND_ASSEMBLE,
+	COMMAND_SELF_TEST,
+	COMMAND_HELP
+};
+
+//Everything that can be changed without rebuilding. Values come from the defaults, then the "config"
+//block of the scene, then the command line, each one overriding the last.
+struct RenderOptions {
+	ProgramCommand command = COMMAND_RENDER_SCENE;
+
+	std::string scenePath = "Animations/animSample.json";
+	//Ignore the manifest of a previous run and render every frame again
+	bool restart = false;
+
+	unsigned width = 640;
+	unsigned height = 480;
+	float fov = 30;
+	//0 uses std::thread::hardware_concurrency
+	unsigned threadCount = 0;
+	int maxRayDepth = 5;
+	float minThroughput = 0.0f;
+	bool russianRoulette = false;
+	bool shadows = true;
+	ContainerMode containerMode = CONTAINERS_MULTIPLE;
+	AllocatorMode allocatorMode = ALLOCATOR_POOLS;
+	BalanceMode balanceMode = BALANCE_COST;
+	MathMode mathMode = MATH_EXACT;
+	bool useParallelFor = false;
+	bool usePerfCounters = false;
+	bool adaptiveAA = false;
+	//Extra samples for each edge pixel, rounded down to a square number for the sample grid
+	unsigned aaSamples = 4;
+	float aaBudget = 0.1f;
+	float aaThreshold = 0.2f;
+	//Milliseconds per frame for progressive previews, 0 for a full render
+	float progressiveBudget = 0.0f;
+	bool temporalReuse = false;
+	bool screenTiles = false;
+	bool hugePages = false;
+	bool rayTable = false;
+	//File the heap telemetry is written to, empty to leave it off
+	std::string heapTelemetryPath;
+	//Byte budget for each named heap, applied once the heaps are created
+	std::vector<std::pair<std::string, long long>> heapBudgets;
+
+	//basic, shrinking or smooth for COMMAND_DEMO
+	std::string demoName;
+	//Input and output of COMMAND_CONVERT
+	std::string convertInput;
+	std::string convertOutput;
+	//Sphere counts for COMMAND_BENCH_LOAD
+	std::vector<int> benchSphereCounts = { 1000, 100000, 1000000 };
+	//Frame sizes for COMMAND_BENCH_RAYS, width then height
+	std::vector<std::pair<unsigned, unsigned>> benchResolutions = { { 640, 480 }, { 1920, 1080 }, { 3840, 2160 } };
+	//Port the coordinator listens on, and the coordinator a worker connects to
+	unsigned short farmPort = 0;
+	std::string farmHost;
+	//Share of the frames a shard renders, frames where frame % shardCount == shardIndex
+	int shardIndex = 0;
+	int shardCount = 1;
+
+	//Parses the command line, prints an error and returns false if an argument is invalid
+	bool ParseCommandLine(int argc, char** argv);
+
+	//Applies the "config" block of a scene. Options already given on the command line are not changed
+	bool ApplySceneConfig(const json& config);
+
+	//Builds the render config for these options
+	RenderConfig CreateRenderConfig() const;
+
+	//The options that change the rendered frames as a config block, sent from the farm coordinator to its
+	//workers. Threads, parallel for and perf counters are left for each worker to choose
+	json ToConfig() const;
+
+	//Outputs the options that affect performance, so logs of A/B runs can be told apart
+	void Print() const;
+
+	static void PrintUsage();
+
+private:
+	//Config names set on the command line
+	std::unordered_set<std::string> _commandLineOptions;
+
+	//Sets one option by its config name, used by both the command line and the scene config
+	bool SetOption(const std::string& name, const std::string& value);
+};
@@ -0,0 +1,104 @@
+#include "SelfTest.h"
+#include "RenderOptions.h"
+
+//Parses args as if they followed the program name on the command line
+static bool Parse(RenderOptions& options, std::vector<std::string> args)
+{
+	std::vector<char*> argv;
+	argv.push_back((char*)"RayTracerSmall");
+	for (std::string& arg : args) argv.push_back(&arg[0]);
+	return options.ParseCommandLine((int)argv.size(), argv.data());
+}
+
+static bool Accepts(const std::vector<std::string>& args)
+{
+	RenderOptions options;
+	return Parse(options, args);
+}
+
+void SelfTest::TestRenderOptions()
+{
+	{
+		RenderOptions options;
+		SELF_CHECK(Parse(options, {}));
+		SELF_CHECK(options.command == COMMAND_RENDER_SCENE && options.width == 640 && options.height == 480);
+	}
+
+	{
+		RenderOptions options;
+		SELF_CHECK(Parse(options, { "--width", "320", "--height=200", "--threads", "0", "--math", "fast", "--balance", "lpt", "--shadows", "off", "--temporal", "scene.json" }));
+		SELF_CHECK(options.width == 320 && options.height == 200 && options.threadCount == 0);
+		SELF_CHECK(options.mathMode == MATH_FAST && options.balanceMode == BALANCE_LPT);
+		SELF_CHECK(!options.shadows && options.temporalReuse);
+		SELF_CHECK(options.scenePath == "scene.json");
+
+		//0 threads is one per core
+		RenderConfig config = options.CreateRenderConfig();
+		SELF_CHECK(config.width == 320 && config.height == 200 && config.threadCount > 0);
+
+		//The scene config only sets what the command line did not
+		json sceneConfig = { { "width", 100 }, { "fov", 45 }, { "math", "exact" }, { "antiAliasing", true } };
+		SELF_CHECK(options.ApplySceneConfig(sceneConfig));
+		SELF_CHECK(options.width == 320 && options.fov == 45.0f && options.mathMode == MATH_FAST && options.adaptiveAA);
+	}
+
+	//A frame has to have pixels, a zero width or height used to crash the render
+	SELF_CHECK(!Accepts({ "--width", "0" }));
+	SELF_CHECK(!Accepts({ "--height", "0" }));
+	SELF_CHECK(!Accepts({ "--width", "-5" }));
+	SELF_CHECK(!Accepts({ "--width", "99999999999" }));
+	SELF_CHECK(!Accepts({ "--width", "12px" }));
+	SELF_CHECK(!Accepts({ "--width" }));
+	SELF_CHECK(!Accepts({ "--fov", "30abc" }));
+	SELF_CHECK(!Accepts({ "--fov", "0" }));
+	SELF_CHECK(!Accepts({ "--fov", "180" }));
+	SELF_CHECK(!Accepts({ "--fov", "-30" }));
+	SELF_CHECK(!Accepts({ "--aa-budget", "0.5x" }));
+	SELF_CHECK(!Accepts({ "--progressive", "100ms" }));
+	{
+		RenderOptions options;
+		SELF_CHECK(Parse(options, { "--fov", "90.5" }) && options.fov == 90.5f);
+	}
+	{
+		RenderOptions options;
+		SELF_CHECK(!options.ApplySceneConfig({ { "fov", 200 } }));
+	}
+	{
+		RenderOptions options;
+		SELF_CHECK(!options.ApplySceneConfig({ { "height", 0 } }));
+	}
+
+	//Names that are not one of the choices
+	SELF_CHECK(!Accepts({ "--math", "quick" }));
+	SELF_CHECK(!Accepts({ "--balance", "random" }));
+	SELF_CHECK(!Accepts({ "--shadows", "maybe" }));
+	SELF_CHECK(!Accepts({ "--no-such-option" }));
+
+	//Benchmark counts are checked rather than thrown from std::stoi
+	{
+		RenderOptions options;
+		SELF_CHECK(Parse(options, { "--bench-load", "10,20" }));
+		SELF_CHECK(options.command == COMMAND_BENCH_LOAD && options.benchSphereCounts == std::vector<int>({ 10, 20 }));
+	}
+	SELF_CHECK(!Accepts({ "--bench-load", "abc" }));
+	SELF_CHECK(!Accepts({ "--bench-load", "10,0" }));
+	SELF_CHECK(!Accepts({ "--bench-load", "3000000000" }));
+	{
+		RenderOptions options;
+		SELF_CHECK(Parse(options, { "--bench-rays", "64x48" }));
+		SELF_CHECK(options.benchResolutions.size() == 1 && options.benchResolutions[0].first == 64 && options.benchResolutions[0].second == 48);
+	}
+	SELF_CHECK(!Accepts({ "--bench-rays", "64x0" }));
+	SELF_CHECK(!Accepts({ "--bench-rays", "64" }));
+	SELF_CHECK(!Accepts({ "--shard", "2/2" }));
+	SELF_CHECK(!Accepts({ "--farm-worker", "localhost" }));
+
+	//The farm sends its options to the workers as a config block, they have to come out the same
+	{
+		RenderOptions sent;
+		SELF_CHECK(Parse(sent, { "--width", "320", "--math", "fastest", "--max-depth", "2", "--aa" }));
+		RenderOptions received;
+		SELF_CHECK(received.ApplySceneConfig(sent.ToConfig()));
+		SELF_CHECK(received.width == 320 && received.mathMode == MATH_FASTEST && received.maxRayDepth == 2 && received.adaptiveAA);
+	}
+}
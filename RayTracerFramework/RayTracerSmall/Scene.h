@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include "Sphere.h"
+#include "Plane.h"
+
+class ScreenTiles;
+
+//The shapes trace works on for one frame. Each shape has its own array so the sphere loop stays a
+//plain loop over spheres
+struct Scene {
+	const Sphere* spheres = nullptr;
+	int sphereCount = 0;
+	const Plane* planes = nullptr;
+	int planeCount = 0;
+	//Indices of the spheres that emit light, diffuse shading only visits these
+	std::vector<int> lights;
+	//Spheres near each tile of the screen for the primary rays, nullptr to test every sphere
+	const ScreenTiles* screenTiles = nullptr;
+	//Some surface reflects or is transparent, so hits can spawn secondary rays
+	bool secondaryRays = false;
+	//Some surface is transparent, so hits can spawn refraction rays
+	bool transparent = false;
+
+	//Rebuilds the light list and the surface flags, call this once the spheres of a frame are in place
+	void FindLights() {
+		lights.clear();
+		secondaryRays = false;
+		transparent = false;
+		//Highest index first, the order the old loop over every sphere summed the lights in
+		for (int i = sphereCount - 1; i >= 0; --i) {
+			const Vec3f& emission = spheres[i]._emissionColor;
+			if (emission.x > 0 || emission.y > 0 || emission.z > 0) lights.push_back(i);
+			FindSurface(spheres[i]);
+		}
+		for (int i = 0; i < planeCount; ++i) FindSurface(planes[i]);
+	}
+
+private:
+	//The same tests trace makes before it spawns reflection and refraction rays
+	void FindSurface(const Primitive& primitive) {
+		if (primitive._transparency > 0.0f || primitive._reflection > 0.0f) secondaryRays = true;
+		if (primitive._transparency != 0.0f) transparent = true;
+	}
+};
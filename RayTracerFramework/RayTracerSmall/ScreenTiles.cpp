@@ -0,0 +1,97 @@
+#include "ScreenTiles.h"
+#include <algorithm>
+
+//Sphere::intersect rounds d2, so a ray can be counted as hitting a little outside the radius. The radius
+//used for the rectangles is grown by this share of the squared distance to the sphere to cover it
+#define SCREEN_TILE_EDGE_MARGIN 1e-5f
+//Pixels added to each side of a rectangle for the rounding of the projection
+#define SCREEN_TILE_PIXEL_MARGIN 1.0f
+
+ScreenTiles::ScreenTiles(const RenderConfig& config)
+{
+	_width = (float)config.width;
+	_height = (float)config.height;
+	_halfWidth = _width * 0.5f;
+	_halfHeight = _height * 0.5f;
+	_xScale = 1.0f / (config.angle * config.aspectRatio);
+	_yScale = 1.0f / config.angle;
+	_tilesX = (config.width + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+	_tilesY = (config.height + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+	_tileStart.assign((size_t)_tilesX * _tilesY + 1, 0);
+}
+
+//Tile a position falls in, kept between -1 and tileCount so it fits in an int
+static int ClampTile(float tile, int tileCount)
+{
+	return (int)std::max(-1.0f, std::min((float)tileCount, floorf(tile)));
+}
+
+bool ScreenTiles::FindTiles(const Sphere& sphere, int& minTileX, int& maxTileX, int& minTileY, int& maxTileY) const
+{
+	float radius = sqrt(sphere._radiusSqr + SCREEN_TILE_EDGE_MARGIN * sphere._center.length2());
+	Vec3f low = sphere._center - Vec3f(radius);
+	Vec3f high = sphere._center + Vec3f(radius);
+	//The camera is inside the box or level with it, the sphere can cover any part of the screen
+	if (high.z >= 0.0f) return false;
+
+	//The sphere is inside its box, so it is inside the rectangle around the corners of the box on screen
+	float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+	for (int corner = 0; corner < 8; ++corner) {
+		float x = (corner & 1) ? high.x : low.x;
+		float y = (corner & 2) ? high.y : low.y;
+		float z = (corner & 4) ? high.z : low.z;
+		float screenX = (x / -z * _xScale + 1.0f) * _halfWidth;
+		float screenY = (1.0f - y / -z * _yScale) * _halfHeight;
+		minX = std::min(minX, screenX);
+		maxX = std::max(maxX, screenX);
+		minY = std::min(minY, screenY);
+		maxY = std::max(maxY, screenY);
+	}
+
+	//Clamped as floats first, a box close to the camera plane can project far outside the range of an int.
+	//A rectangle off one side of the screen ends up with its max below its min
+	minTileX = std::max(0, ClampTile((minX - SCREEN_TILE_PIXEL_MARGIN) / SCREEN_TILE_SIZE, _tilesX));
+	maxTileX = std::min(_tilesX - 1, ClampTile((maxX + SCREEN_TILE_PIXEL_MARGIN) / SCREEN_TILE_SIZE, _tilesX));
+	minTileY = std::max(0, ClampTile((minY - SCREEN_TILE_PIXEL_MARGIN) / SCREEN_TILE_SIZE, _tilesY));
+	maxTileY = std::min(_tilesY - 1, ClampTile((maxY + SCREEN_TILE_PIXEL_MARGIN) / SCREEN_TILE_SIZE, _tilesY));
+	return true;
+}
+
+void ScreenTiles::Build(const Scene& scene)
+{
+	const int tileCount = _tilesX * _tilesY;
+	_sphereTiles.resize((size_t)scene.sphereCount * 4);
+	std::fill(_tileStart.begin(), _tileStart.end(), 0);
+
+	//Counts the spheres of each tile, shifted up one so the running total below gives each tile's start
+	for (int i = 0; i < scene.sphereCount; ++i) {
+		int* tiles = &_sphereTiles[(size_t)i * 4];
+		if (!FindTiles(scene.spheres[i], tiles[0], tiles[1], tiles[2], tiles[3])) {
+			tiles[0] = 0;
+			tiles[1] = _tilesX - 1;
+			tiles[2] = 0;
+			tiles[3] = _tilesY - 1;
+		}
+		//The bounds are inclusive, a sphere off the screen has a max below its min and is in no tile
+		for (int y = tiles[2]; y <= tiles[3]; ++y) {
+			for (int x = tiles[0]; x <= tiles[1]; ++x) _tileStart[y * _tilesX + x + 1]++;
+		}
+	}
+	for (int t = 0; t < tileCount; ++t) _tileStart[t + 1] += _tileStart[t];
+
+	//Filled in scene order so every tile's list stays sorted
+	_candidates.resize(_tileStart[tileCount]);
+	std::vector<int> next(_tileStart.begin(), _tileStart.end() - 1);
+	for (int i = 0; i < scene.sphereCount; ++i) {
+		const int* tiles = &_sphereTiles[(size_t)i * 4];
+		for (int y = tiles[2]; y <= tiles[3]; ++y) {
+			for (int x = tiles[0]; x <= tiles[1]; ++x) _candidates[next[y * _tilesX + x]++] = i;
+		}
+	}
+}
+
+float ScreenTiles::GetAverageCandidates() const
+{
+	const int tileCount = _tilesX * _tilesY;
+	return (float)_tileStart[tileCount] / tileCount;
+}
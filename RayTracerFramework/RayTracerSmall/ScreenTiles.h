@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include "RenderConfig.h"
+#include "Scene.h"
+
+//Width and height in pixels of the tiles the primary rays are grouped in
+#define SCREEN_TILE_SIZE 16
+
+//Lists, for each tile of the screen, the spheres a primary ray through the tile could hit. Each sphere is
+//projected to a rectangle on the screen and added to every tile the rectangle covers, so a primary ray only
+//tests the spheres near its pixel instead of every sphere in the scene. Secondary rays start anywhere and
+//still test every sphere. The lists keep the scene order so the nearest hit is the same one trace finds
+//without them. Rebuilt every frame from the spheres of that frame.
+class ScreenTiles
+{
+public:
+	ScreenTiles(const RenderConfig& config);
+
+	//Bins the spheres of the frame about to be rendered
+	void Build(const Scene& scene);
+
+	//Spheres a primary ray from the camera could hit, in scene order. Returns nullptr if the ray is off
+	//the screen, it then has to test every sphere
+	inline const int* GetCandidates(const Vec3f& raydir, int& count) const
+	{
+		if (raydir.z >= 0.0f) return nullptr;
+
+		//The inverse of the ray direction in the render loops, in pixels from the top left of the screen
+		float screenX = (raydir.x / -raydir.z * _xScale + 1.0f) * _halfWidth;
+		float screenY = (1.0f - raydir.y / -raydir.z * _yScale) * _halfHeight;
+		if (!(screenX >= 0.0f && screenX < _width && screenY >= 0.0f && screenY < _height)) return nullptr;
+
+		int tile = (int)(screenY * (1.0f / SCREEN_TILE_SIZE)) * _tilesX + (int)(screenX * (1.0f / SCREEN_TILE_SIZE));
+		count = _tileStart[tile + 1] - _tileStart[tile];
+		return _candidates.data() + _tileStart[tile];
+	}
+
+	//Spheres per tile averaged over the screen, for the frame report
+	float GetAverageCandidates() const;
+
+private:
+	//Finds the tiles covered by a sphere, false if it can be anywhere on the screen
+	bool FindTiles(const Sphere& sphere, int& minTileX, int& maxTileX, int& minTileY, int& maxTileY) const;
+
+	float _width;
+	float _height;
+	float _halfWidth;
+	float _halfHeight;
+	//1 / (angle * aspectRatio) and 1 / angle, turn a direction into a position on the screen
+	float _xScale;
+	float _yScale;
+	int _tilesX;
+	int _tilesY;
+
+	//Candidates of tile t are _candidates[_tileStart[t]] to _candidates[_tileStart[t + 1]]
+	std::vector<int> _tileStart;
+	std::vector<int> _candidates;
+	//Tiles covered by each sphere, kept from the counting pass for the filling pass
+	std::vector<int> _sphereTiles;
+};
@@ -0,0 +1,83 @@
+#include "SelfTest.h"
+#include "ScreenTiles.h"
+#include <algorithm>
+
+//Repeatable numbers from min to max, so a failing scene is the same every run
+static float NextFloat(unsigned& seed, float min, float max)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return min + (max - min) * ((seed >> 8) / 16777216.0f);
+}
+
+void SelfTest::TestScreenTiles()
+{
+	//Not a whole number of tiles across or down
+	RenderConfig config(100, 60, 1);
+
+	std::vector<Sphere> spheres;
+	//Around the camera, every primary ray starts inside it
+	spheres.push_back(Sphere(Vec3f(1.0f, 0.0f, 0.5f), 2.0f, Vec3f(0.5f)));
+	//Across the camera plane to the right, its front covers the right of the screen
+	spheres.push_back(Sphere(Vec3f(6.0f, 0.0f, -0.5f), 3.0f, Vec3f(0.5f)));
+	//Just in front of the camera plane, off the left of the screen
+	spheres.push_back(Sphere(Vec3f(-0.5f, 0.0f, -0.01f), 0.005f, Vec3f(0.5f)));
+	//Off the right of the screen
+	spheres.push_back(Sphere(Vec3f(30.0f, 0.0f, -5.0f), 1.0f, Vec3f(0.5f)));
+	//Behind the camera, it is put in every tile like the ones across the camera plane
+	spheres.push_back(Sphere(Vec3f(0.0f, 0.0f, 10.0f), 2.0f, Vec3f(0.5f)));
+	const int offScreen[] = { 2, 3 };
+	//The rest anywhere in front, some partly off the screen
+	unsigned seed = 12345;
+	for (int i = 0; i < 200; ++i) {
+		Vec3f center(NextFloat(seed, -15.0f, 15.0f), NextFloat(seed, -10.0f, 10.0f), NextFloat(seed, -40.0f, -2.0f));
+		spheres.push_back(Sphere(center, NextFloat(seed, 0.2f, 3.0f), Vec3f(0.5f)));
+	}
+
+	Scene scene;
+	scene.spheres = spheres.data();
+	scene.sphereCount = (int)spheres.size();
+	ScreenTiles tiles(config);
+	tiles.Build(scene);
+
+	//Every sphere a primary ray hits is in the list of its pixel's tile, the lists are in scene order, the spheres
+	//around and across the camera plane are in every list and the ones off the side of the screen in none
+	bool onScreen = true, allHits = true, sorted = true, around = true, outside = true;
+	for (unsigned y = 0; y < config.height; ++y) {
+		const RowRays rays(config, y);
+		for (unsigned x = 0; x < config.width; ++x) {
+			Vec3f raydir = rays.Direction(x);
+			raydir.normalize();
+			int count = 0;
+			const int* candidates = tiles.GetCandidates(raydir, count);
+			if (candidates == nullptr) {
+				onScreen = false;
+				continue;
+			}
+
+			for (int i = 0; i < scene.sphereCount; ++i) {
+				float t0 = INFINITY, t1 = INFINITY;
+				if (spheres[i].intersect(Vec3f(0), raydir, t0, t1)) allHits = allHits && std::find(candidates, candidates + count, i) != candidates + count;
+			}
+			sorted = sorted && std::adjacent_find(candidates, candidates + count, [](int a, int b) { return a >= b; }) == candidates + count;
+			around = around && count >= 2 && candidates[0] == 0 && candidates[1] == 1;
+			for (int i : offScreen) outside = outside && std::find(candidates, candidates + count, i) == candidates + count;
+		}
+	}
+	SELF_CHECK(onScreen);
+	SELF_CHECK(allHits);
+	SELF_CHECK(sorted);
+	SELF_CHECK(around);
+	SELF_CHECK(outside);
+	SELF_CHECK(tiles.GetAverageCandidates() < (float)scene.sphereCount);
+
+	//Rays that are not in front of the camera or are off the screen have no list
+	int count = 0;
+	SELF_CHECK(tiles.GetCandidates(Vec3f(0.0f, 0.0f, 1.0f), count) == nullptr);
+	SELF_CHECK(tiles.GetCandidates(Vec3f(0.0f, 1.0f, 0.0f), count) == nullptr);
+	SELF_CHECK(tiles.GetCandidates(Vec3f(0.9f, 0.0f, -0.1f).normalize(), count) == nullptr);
+
+	//Rebuilt for a frame where everything is off the side of the screen, every list is empty
+	for (int i = 0; i < scene.sphereCount; ++i) spheres[i]._center = Vec3f(-1000.0f, 0.0f, -10.0f - i);
+	tiles.Build(scene);
+	SELF_CHECK(tiles.GetAverageCandidates() == 0.0f);
+}
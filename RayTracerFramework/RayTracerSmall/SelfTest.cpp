@@ -0,0 +1,45 @@
+#include "SelfTest.h"
+#include <iostream>
+
+int SelfTest::_checkCount = 0;
+int SelfTest::_failCount = 0;
+
+bool SelfTest::RunAll()
+{
+	_checkCount = 0;
+	_failCount = 0;
+
+	//The modules print their usual errors for the bad input the checks give them
+	std::cout << "Checking BinaryScene" << std::endl;
+	TestBinaryScene();
+	std::cout << "Checking JSONReader" << std::endl;
+	TestStreamingLoader();
+	std::cout << "Checking RenderManifest" << std::endl;
+	TestRenderManifest();
+	std::cout << "Checking RenderOptions" << std::endl;
+	TestRenderOptions();
+	std::cout << "Checking ChunkPlanner" << std::endl;
+	TestChunkPlanner();
+	std::cout << "Checking AnimationTrack" << std::endl;
+	TestAnimationTrack();
+	std::cout << "Checking AntiAliasing" << std::endl;
+	TestAntiAliasing();
+	std::cout << "Checking FrameRing" << std::endl;
+	TestFrameRing();
+	std::cout << "Checking TemporalCache" << std::endl;
+	TestTemporalCache();
+	std::cout << "Checking ScreenTiles" << std::endl;
+	TestScreenTiles();
+
+	std::cout << "Self test: " << _checkCount - _failCount << " of " << _checkCount << " checks passed" << std::endl;
+	return _failCount == 0;
+}
+
+void SelfTest::Check(bool passed, const char* expression, const char* file, int line)
+{
+	_checkCount++;
+	if (passed) return;
+
+	_failCount++;
+	std::cout << "[FAILED: " << file << ":" << line << ": " << expression << std::endl;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+//Records one check, the expression is printed with its file and line if it is false
+#define SELF_CHECK(expression) SelfTest::Check((expression), #expression, __FILE__, __LINE__)
+
+//Behaviour checks of the modules, run with --self-test. The checks of each module are in <Module>Tests.cpp next
+//to it. They need no scene or render, and write any files they need to the working directory and remove them
+class SelfTest
+{
+public:
+	//Runs every check, returns false if any failed
+	static bool RunAll();
+
+	static void Check(bool passed, const char* expression, const char* file, int line);
+
+private:
+	//Validation of well formed, truncated and corrupted binary scenes, in memory and from files
+	static void TestBinaryScene();
+	//The streaming json loader against the DOM loader, with the counts before and after the spheres
+	static void TestStreamingLoader();
+	//Resuming from a manifest, and starting again when the frames or the render hash changed
+	static void TestRenderManifest();
+	//Command line and scene config parsing, including the values that have to be rejected
+	static void TestRenderOptions();
+	//Every balance mode covers the frame once within the buffer sizes, and the measured plans balance the time
+	static void TestChunkPlanner();
+	//Step, linear and cubic keyframes, frames outside the keys, and the tracks made for start and end values
+	static void TestAnimationTrack();
+	//The edge search's budget per tile, object edges kept over contrast edges, and the order of the pixels found
+	static void TestAntiAliasing();
+	//Frames from a forked shard come out of the ring in order, and a shard that exits without finishing is noticed
+	static void TestFrameRing();
+	//Pixels are traced again when their rays could reach a moved or changed sphere, and reused otherwise
+	static void TestTemporalCache();
+	//Every sphere a primary ray hits is in its tile's list, including spheres across the camera plane
+	static void TestScreenTiles();
+
+	static int _checkCount;
+	static int _failCount;
+};
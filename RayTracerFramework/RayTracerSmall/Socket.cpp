@@ -0,0 +1,187 @@
+#include "Socket.h"
+#include <cstring>
+#include <iostream>
+
+#if defined _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define INVALID_HANDLE ((SocketHandle)INVALID_SOCKET)
+#define CloseSocket(handle) closesocket((SOCKET)handle)
+//Windows sends never raise a signal when the other end has gone
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_HANDLE -1
+#define CloseSocket(handle) close(handle)
+//Without this a send to a worker that has died kills the coordinator with SIGPIPE
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+bool Socket::Startup()
+{
+#if defined _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+		std::cout << "[ERROR: Socket.cpp: could not start winsock" << std::endl;
+		return false;
+	}
+#endif
+	return true;
+}
+
+void Socket::Shutdown()
+{
+#if defined _WIN32
+	WSACleanup();
+#endif
+}
+
+Socket* Socket::Listen(unsigned short port)
+{
+	SocketHandle handle = (SocketHandle)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == INVALID_HANDLE) {
+		std::cout << "[ERROR: Socket.cpp: could not create a socket" << std::endl;
+		return nullptr;
+	}
+
+	//Lets a restarted coordinator take the port back straight away
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	if (bind(handle, (const sockaddr*)&address, sizeof(address)) != 0 || listen(handle, SOMAXCONN) != 0) {
+		std::cout << "[ERROR: Socket.cpp: could not listen on port " << port << std::endl;
+		CloseSocket(handle);
+		return nullptr;
+	}
+
+	return new Socket(handle, "port " + std::to_string(port));
+}
+
+Socket* Socket::Connect(const std::string& host, unsigned short port)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0 || addresses == nullptr) {
+		std::cout << "[ERROR: Socket.cpp: could not resolve " << host << std::endl;
+		return nullptr;
+	}
+
+	SocketHandle handle = INVALID_HANDLE;
+	for (addrinfo* it = addresses; it != nullptr; it = it->ai_next) {
+		handle = (SocketHandle)socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+		if (handle == INVALID_HANDLE) continue;
+		if (connect(handle, it->ai_addr, (int)it->ai_addrlen) == 0) break;
+		CloseSocket(handle);
+		handle = INVALID_HANDLE;
+	}
+	freeaddrinfo(addresses);
+
+	if (handle == INVALID_HANDLE) return nullptr;
+
+	//Messages are written in two parts, the header and the payload, so do not hold the header back
+	int noDelay = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	return new Socket(handle, host + ":" + std::to_string(port));
+}
+
+bool Socket::WaitForReadable(const std::vector<Socket*>& sockets, float timeout, std::vector<int>& ready)
+{
+	ready.clear();
+
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	SocketHandle highest = 0;
+	for (Socket* socket : sockets) {
+		FD_SET(socket->_handle, &readSet);
+		if (socket->_handle > highest) highest = socket->_handle;
+	}
+
+	timeval wait;
+	wait.tv_sec = (long)timeout;
+	wait.tv_usec = (long)((timeout - (float)wait.tv_sec) * 1000000.0f);
+
+	//The first argument is ignored by winsock
+	int count = select((int)highest + 1, &readSet, nullptr, nullptr, &wait);
+	if (count <= 0) return false;
+
+	for (size_t i = 0; i < sockets.size(); ++i) {
+		if (FD_ISSET(sockets[i]->_handle, &readSet)) ready.push_back((int)i);
+	}
+	return true;
+}
+
+Socket::~Socket()
+{
+	CloseSocket(_handle);
+}
+
+Socket* Socket::Accept()
+{
+	sockaddr_in address;
+	socklen_t addressSize = sizeof(address);
+	SocketHandle handle = (SocketHandle)accept(_handle, (sockaddr*)&address, &addressSize);
+	if (handle == INVALID_HANDLE) return nullptr;
+
+	int noDelay = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	char host[INET_ADDRSTRLEN] = {};
+	inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+	return new Socket(handle, std::string(host) + ":" + std::to_string(ntohs(address.sin_port)));
+}
+
+bool Socket::SendAll(const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0) {
+		int sent = (int)send(_handle, bytes, (int)(size < 1 << 30 ? size : 1 << 30), SEND_FLAGS);
+		if (sent <= 0) return false;
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+bool Socket::ReceiveAll(void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0) {
+		//0 means the other end closed the connection, negative an error or the receive timeout
+		int received = (int)recv(_handle, bytes, (int)(size < 1 << 30 ? size : 1 << 30), 0);
+		if (received <= 0) return false;
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+void Socket::SetReceiveTimeout(float seconds)
+{
+#if defined _WIN32
+	DWORD timeout = (DWORD)(seconds * 1000.0f);
+#else
+	timeval timeout;
+	timeout.tv_sec = (long)seconds;
+	timeout.tv_usec = (long)((seconds - (float)timeout.tv_sec) * 1000000.0f);
+#endif
+	setsockopt(_handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined _WIN32
+//SOCKET is a UINT_PTR, kept as a plain integer so Winsock does not have to be included everywhere
+typedef uintptr_t SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
+
+//Blocking TCP socket used by the render farm. Winsock on windows, BSD sockets everywhere else
+class Socket
+{
+public:
+	//Winsock has to be started before any socket is created, does nothing on linux
+	static bool Startup();
+	static void Shutdown();
+
+	//Listens on every interface on the port, returns nullptr if the port cannot be bound
+	static Socket* Listen(unsigned short port);
+	//Connects to host:port, returns nullptr if nothing is listening there
+	static Socket* Connect(const std::string& host, unsigned short port);
+
+	//Waits up to timeout seconds until one of the sockets has data or a connection to accept.
+	//Fills ready with the indices of those sockets, returns false on timeout
+	static bool WaitForReadable(const std::vector<Socket*>& sockets, float timeout, std::vector<int>& ready);
+
+	~Socket();
+
+	//Accepts a waiting connection on a listening socket
+	Socket* Accept();
+
+	//Sends or receives exactly size bytes. Returns false if the other end has gone or the receive timeout ran out
+	bool SendAll(const void* data, size_t size);
+	bool ReceiveAll(void* data, size_t size);
+
+	//Longest a receive can wait for data before failing, 0 waits forever
+	void SetReceiveTimeout(float seconds);
+
+	//Address of the other end, for log messages
+	const std::string& GetPeerName() const { return _peerName; }
+
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+private:
+	Socket(SocketHandle handle, const std::string& peerName) : _handle(handle), _peerName(peerName) {}
+
+	SocketHandle _handle;
+	std::string _peerName;
+};
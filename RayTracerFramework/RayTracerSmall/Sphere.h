@@ -1,16 +1,15 @@
 #pragma once
 #include "Vec3.h"
+#include "Primitive.h"
 #include <iostream>
 #include <cmath>
 
-class Sphere
+class Sphere : public Primitive
 {
 public:
 	Vec3f _center;                           /// position of the sphere
 	float _radius, _radiusSqr;                  /// sphere radius and radius^2
-	Vec3f _surfaceColor, _emissionColor;      /// surface color and emission (light)
-	float _transparency, _reflection;		/// surface transparency and reflectivity
-	Sphere() : _radius(1.0f), _radiusSqr(1.0f), _reflection(1.0f), _transparency(1.0f) {}
+	Sphere() : Primitive(Vec3f(0), 1.0f, 1.0f, Vec3f(0)), _radius(1.0f), _radiusSqr(1.0f) {}
 	Sphere(
 		const Vec3f& center,
 		const float& radius,
@@ -18,8 +17,8 @@ public:
 		const float& reflection = 0,
 		const float& transparency = 0,
 		const Vec3f& emmisionColor = 0) :
-		_center(center), _radius(radius), _radiusSqr(radius* radius), _surfaceColor(surfaceColor), _emissionColor(emmisionColor),
-		_transparency(transparency), _reflection(reflection) { }
+		Primitive(surfaceColor, reflection, transparency, emmisionColor),
+		_center(center), _radius(radius), _radiusSqr(radius* radius) { }
 
 	//[comment]
 	// Compute a ray-sphere intersection using the geometric solution
@@ -37,5 +36,21 @@ public:
 
 		return true;
 	}
+
+	//[comment]
+	// Shadow ray test, true if the sphere is hit closer than maxDistance. Only the near
+	// intersection is needed so there is no sqrt when the sphere is beyond the light
+	//[/comment]
+	bool occludes(const Vec3f& rayorig, const Vec3f& raydir, const float& maxDistance) const
+	{
+		Vec3f l = _center - rayorig;
+		float tca = l.dot(raydir);
+		if (tca < 0) return false;
+		float d2 = l.dot(l) - tca * tca;
+		if (d2 > _radiusSqr) return false;
+		//t0 < maxDistance, rearranged to tca - maxDistance < thc
+		float diff = tca - maxDistance;
+		return diff < 0 || diff * diff < _radiusSqr - d2;
+	}
 };
 
@@ -0,0 +1,141 @@
+#include "TemporalCache.h"
+
+//Share of the squared distance to a moved sphere added to its squared radius
+#define TEMPORAL_EDGE_MARGIN 1e-5f
+//The same for the fastest math mode. Its rays are normalized with the rsqrt estimate so they are not quite unit
+//length, and trace's d2 for them is out by up to twice the estimate's error times the squared distance
+#if defined VEC3_NEON
+#define TEMPORAL_ESTIMATE_MARGIN 1e-2f
+#else
+#define TEMPORAL_ESTIMATE_MARGIN 1e-3f
+#endif
+
+thread_local PixelHistory* pixelHistory = nullptr;
+
+TemporalCache::TemporalCache(const RenderConfig& config) : _width(config.width), _height(config.height), _invWidth(config.invWidth),
+	_invHeight(config.invHeight), _angle(config.angle), _aspectRatio(config.aspectRatio),
+	_edgeMargin(config.mathMode == MATH_FASTEST ? TEMPORAL_ESTIMATE_MARGIN : TEMPORAL_EDGE_MARGIN), _rowReused(config.height, 0)
+{
+	_pixels = new PixelHistory[(size_t)_width * _height];
+	for (size_t i = 0; i < (size_t)_width * _height; ++i) _pixels[i].Reset();
+}
+
+TemporalCache::~TemporalCache()
+{
+	delete[] _pixels;
+	_pixels = nullptr;
+}
+
+bool TemporalCache::SameShape(const Sphere& a, const Sphere& b)
+{
+	return a._center.x == b._center.x && a._center.y == b._center.y && a._center.z == b._center.z && a._radius == b._radius;
+}
+
+bool TemporalCache::SameSphere(const Sphere& a, const Sphere& b)
+{
+	return SameShape(a, b) &&
+		a._surfaceColor.x == b._surfaceColor.x && a._surfaceColor.y == b._surfaceColor.y && a._surfaceColor.z == b._surfaceColor.z &&
+		a._emissionColor.x == b._emissionColor.x && a._emissionColor.y == b._emissionColor.y && a._emissionColor.z == b._emissionColor.z &&
+		a._transparency == b._transparency && a._reflection == b._reflection;
+}
+
+void TemporalCache::BeginFrame(const Scene& scene)
+{
+	_changed = 0;
+	_moved.clear();
+
+	//A light turning on or off changes the shading of every diffuse pixel
+	_reuse = _hasFrame && (int)_previousSpheres.size() == scene.sphereCount && scene.lights == _previousLights;
+	if (!_reuse) return;
+
+	for (int i = 0; i < scene.sphereCount; ++i) {
+		const Sphere& before = _previousSpheres[i];
+		const Sphere& after = scene.spheres[i];
+		if (SameSphere(before, after)) continue;
+
+		_changed |= 1ull << (i & 63);
+		if (SameShape(before, after)) continue;
+
+		//One sphere around both positions, rays that miss it cannot have been affected by the move
+		MovedSphere moved;
+		Vec3f offset = after._center - before._center;
+		moved.center = before._center + offset * 0.5f;
+		moved.radius = offset.length() * 0.5f + std::max(before._radius, after._radius);
+		//trace finds d2 as a difference of large squares, the margin covers its rounding near the edge of the sphere
+		//and, in the fastest mode, rays that are not quite unit length
+		moved.radiusSqr = moved.radius * moved.radius + _edgeMargin * moved.center.length2();
+		moved.radius = sqrt(moved.radiusSqr);
+		moved.boundsMin = moved.center - Vec3f(moved.radius);
+		moved.boundsMax = moved.center + Vec3f(moved.radius);
+		FindScreenBounds(moved);
+		_moved.push_back(moved);
+	}
+
+	if (_moved.size() > TEMPORAL_MAX_MOVED || _changed == ~0ull) _reuse = false;
+}
+
+void TemporalCache::EndFrame(const Scene& scene)
+{
+	_previousSpheres.assign(scene.spheres, scene.spheres + scene.sphereCount);
+	_previousLights = scene.lights;
+	_hasFrame = true;
+
+	size_t reused = 0;
+	for (unsigned count : _rowReused) reused += count;
+	_reusedShare = (float)reused / ((size_t)_width * _height);
+}
+
+void TemporalCache::FindScreenBounds(MovedSphere& moved) const
+{
+	//Every corner of the box is projected onto the screen, the sphere is inside the box so its pixels are
+	//inside the rectangle around the corners
+	float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+	for (int corner = 0; corner < 8; ++corner) {
+		Vec3f point((corner & 1) ? moved.boundsMax.x : moved.boundsMin.x, (corner & 2) ? moved.boundsMax.y : moved.boundsMin.y, (corner & 4) ? moved.boundsMax.z : moved.boundsMin.z);
+		if (point.z >= 0.0f) {
+			//Part of the box is level with or behind the camera, it could be anywhere on screen
+			moved.minX = 0;
+			moved.maxX = (int)_width - 1;
+			moved.minY = 0;
+			moved.maxY = (int)_height - 1;
+			return;
+		}
+
+		//The inverse of the ray direction in the render loops, xx = (2 * (x + 0.5) / width - 1) * angle * aspect
+		float px = ((point.x / -point.z) / (_angle * _aspectRatio) + 1.0f) * 0.5f / _invWidth - 0.5f;
+		float py = (1.0f - (point.y / -point.z) / _angle) * 0.5f / _invHeight - 0.5f;
+		minX = std::min(minX, px);
+		maxX = std::max(maxX, px);
+		minY = std::min(minY, py);
+		maxY = std::max(maxY, py);
+	}
+
+	//A pixel either side for rounding
+	moved.minX = std::max(0, (int)floor(minX) - 1);
+	moved.maxX = std::min((int)_width - 1, (int)ceil(maxX) + 1);
+	moved.minY = std::max(0, (int)floor(minY) - 1);
+	moved.maxY = std::min((int)_height - 1, (int)ceil(maxY) + 1);
+}
+
+bool TemporalCache::CanReuse(const PixelHistory& pixel, unsigned x, unsigned y, const Vec3f& raydir) const
+{
+	if (!_reuse || (pixel.touched & _changed) != 0) return false;
+	if (pixel.escaped && !_moved.empty()) return false;
+
+	for (const MovedSphere& moved : _moved) {
+		if ((int)x >= moved.minX && (int)x <= moved.maxX && (int)y >= moved.minY && (int)y <= moved.maxY) {
+			//The primary ray starts at the camera at the origin. It is only affected if the sphere is between the
+			//camera and the primary hit, the sphere radius is used instead of the chord so there is no sqrt
+			float tca = moved.center.dot(raydir);
+			float d2 = moved.center.length2() - tca * tca;
+			if (d2 <= moved.radiusSqr && tca + moved.radius > 0.0f && tca - moved.radius < pixel.primaryDistance) return false;
+		}
+
+		if (pixel.hasBounds &&
+			moved.boundsMin.x <= pixel.boundsMax.x && moved.boundsMax.x >= pixel.boundsMin.x &&
+			moved.boundsMin.y <= pixel.boundsMax.y && moved.boundsMax.y >= pixel.boundsMin.y &&
+			moved.boundsMin.z <= pixel.boundsMax.z && moved.boundsMax.z >= pixel.boundsMin.z) return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "RenderConfig.h"
+#include "Scene.h"
+
+//More moved spheres than this and the per pixel tests cost more than they save, every pixel is traced
+#define TEMPORAL_MAX_MOVED 32
+
+//What one pixel's rays depended on the last time it was traced
+struct PixelHistory {
+	Vec3f color;
+	//Object the primary ray hit, -1 for the background
+	int primaryHitId;
+	//Distance to the primary hit, INFINITY if it missed
+	float primaryDistance;
+	//Bit (id % 64) set for every object a ray hit, every light shaded and every object found blocking a light.
+	//Objects that share a bit can only make a pixel be traced when it did not need to be
+	uint64_t touched;
+	//Box around every reflection, refraction and unblocked shadow ray, a moved sphere inside it could now block one
+	Vec3f boundsMin;
+	Vec3f boundsMax;
+	bool hasBounds;
+	//A reflection or refraction ray left the scene, anything that moved could be in its way
+	bool escaped;
+
+	void Reset() {
+		touched = 0;
+		hasBounds = false;
+		escaped = false;
+	}
+
+	void Touch(int id) {
+		if (id >= 0) touched |= 1ull << (id & 63);
+	}
+
+	//Adds a ray segment to the bounds
+	void AddSegment(const Vec3f& from, const Vec3f& to) {
+		Vec3f low(std::min(from.x, to.x), std::min(from.y, to.y), std::min(from.z, to.z));
+		Vec3f high(std::max(from.x, to.x), std::max(from.y, to.y), std::max(from.z, to.z));
+		if (!hasBounds) {
+			boundsMin = low;
+			boundsMax = high;
+			hasBounds = true;
+			return;
+		}
+		boundsMin = Vec3f(std::min(boundsMin.x, low.x), std::min(boundsMin.y, low.y), std::min(boundsMin.z, low.z));
+		boundsMax = Vec3f(std::max(boundsMax.x, high.x), std::max(boundsMax.y, high.y), std::max(boundsMax.z, high.z));
+	}
+};
+
+//Keeps each pixel's colour and the objects its rays depended on between frames. A pixel keeps last frame's colour
+//if nothing it touched has changed, no moved sphere can now be in front of its primary hit and no moved sphere
+//can be in the way of its secondary or shadow rays. The camera never moves so the primary rays are the same
+//every frame. The spheres are compared with the last frame's, so frames do not have to be rendered in order.
+class TemporalCache
+{
+public:
+	TemporalCache(const RenderConfig& config);
+	~TemporalCache();
+
+	//Compares the spheres of the frame about to be rendered with the last frame's
+	void BeginFrame(const Scene& scene);
+	//Remembers the spheres of the frame just rendered and adds up the pixels that were reused
+	void EndFrame(const Scene& scene);
+	//Forgets the history after a frame that was not finished, some of its pixels hold that frame and some the
+	//one before, so the next frame traces every pixel
+	void DiscardFrame() { _hasFrame = false; }
+
+	PixelHistory& GetPixel(unsigned x, unsigned y) { return _pixels[(size_t)y * _width + x]; }
+
+	//True if the pixel can keep its colour. raydir is the pixel's primary ray as the render loop traces it, so
+	//the test against moved spheres uses the same direction, rounding included
+	bool CanReuse(const PixelHistory& pixel, unsigned x, unsigned y, const Vec3f& raydir) const;
+	//Pixels of a row that kept their colour this frame, each row is only written by the worker tracing it
+	void SetRowReused(unsigned y, unsigned count) { _rowReused[y] = count; }
+
+	//Share of the pixels of the last frame that kept their colour
+	float GetReusedShare() const { return _reusedShare; }
+
+	TemporalCache(const TemporalCache&) = delete;
+	TemporalCache& operator=(const TemporalCache&) = delete;
+private:
+	//A sphere that moved or changed size, bounded by a sphere around both its old and new positions
+	struct MovedSphere {
+		Vec3f center;
+		float radius;
+		float radiusSqr;
+		Vec3f boundsMin;
+		Vec3f boundsMax;
+		//Pixels whose primary rays can reach the bounding sphere, inclusive
+		int minX, maxX, minY, maxY;
+	};
+
+	//Finds the pixels covered by the bounding box of a moved sphere, seen from the camera
+	void FindScreenBounds(MovedSphere& moved) const;
+
+	static bool SameSphere(const Sphere& a, const Sphere& b);
+	static bool SameShape(const Sphere& a, const Sphere& b);
+
+	unsigned _width;
+	unsigned _height;
+	//Camera values from the config, to find the pixels a moved sphere covers
+	float _invWidth;
+	float _invHeight;
+	float _angle;
+	float _aspectRatio;
+	//Share of the squared distance added to a moved sphere's squared radius, wider for the rsqrt estimate
+	float _edgeMargin;
+	PixelHistory* _pixels;
+	std::vector<unsigned> _rowReused;
+
+	std::vector<Sphere> _previousSpheres;
+	std::vector<int> _previousLights;
+	bool _hasFrame = false;
+	//False on the first frame, or when so much changed that every pixel has to be traced
+	bool _reuse = false;
+	uint64_t _changed = 0;
+	std::vector<MovedSphere> _moved;
+	float _reusedShare = 0.0f;
+};
+
+//Set while a worker traces a pixel for the temporal cache, trace records what the pixel's rays touch in it
+extern thread_local PixelHistory* pixelHistory;
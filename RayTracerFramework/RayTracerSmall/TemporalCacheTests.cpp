@@ -0,0 +1,120 @@
+#include "SelfTest.h"
+#include "TemporalCache.h"
+#include <cmath>
+
+//The pixel whose primary ray passes nearest to a point in front of the camera
+static void FindPixel(const RenderConfig& config, const Vec3f& point, unsigned& x, unsigned& y)
+{
+	x = (unsigned)std::lround(((point.x / -point.z) / (config.angle * config.aspectRatio) + 1.0f) * 0.5f * config.width - 0.5f);
+	y = (unsigned)std::lround((1.0f - (point.y / -point.z) / config.angle) * 0.5f * config.height - 0.5f);
+}
+
+//The primary ray of a pixel, the way the render loops make it
+static Vec3f PrimaryRay(const RenderConfig& config, unsigned x, unsigned y)
+{
+	Vec3f raydir = RowRays(config, y).Direction(x);
+	raydir.normalize();
+	return raydir;
+}
+
+//A pixel whose primary ray hit sphere id at distance, with nothing else recorded
+static PixelHistory HitPixel(int id, float distance)
+{
+	PixelHistory pixel;
+	pixel.Reset();
+	pixel.color = Vec3f(0.5f);
+	pixel.primaryHitId = id;
+	pixel.primaryDistance = distance;
+	pixel.Touch(id);
+	return pixel;
+}
+
+static void SetScene(Scene& scene, const std::vector<Sphere>& spheres)
+{
+	scene.spheres = spheres.data();
+	scene.sphereCount = (int)spheres.size();
+	scene.FindLights();
+}
+
+void SelfTest::TestTemporalCache()
+{
+	RenderConfig config(64, 48, 1);
+	TemporalCache cache(config);
+
+	//A large sphere straight ahead, a light above it and a small sphere to the left that moves
+	std::vector<Sphere> spheres;
+	spheres.push_back(Sphere(Vec3f(0.0f, 0.0f, -30.0f), 4.0f, Vec3f(0.8f)));
+	spheres.push_back(Sphere(Vec3f(0.0f, 20.0f, -30.0f), 3.0f, Vec3f(0.0f), 0.0f, 0.0f, Vec3f(3.0f)));
+	spheres.push_back(Sphere(Vec3f(-4.0f, 1.0f, -20.0f), 1.0f, Vec3f(0.2f, 0.6f, 0.2f)));
+	Scene scene;
+	SetScene(scene, spheres);
+
+	unsigned centerX, centerY;
+	FindPixel(config, spheres[0]._center, centerX, centerY);
+	const Vec3f centerRay = PrimaryRay(config, centerX, centerY);
+	SELF_CHECK(std::fabs(centerRay.z + 1.0f) < 1e-3f);
+	const PixelHistory untouched = HitPixel(0, 26.0f);
+
+	//Nothing is reused on the first frame
+	cache.BeginFrame(scene);
+	SELF_CHECK(!cache.CanReuse(untouched, centerX, centerY, centerRay));
+	cache.EndFrame(scene);
+
+	//Nothing changed, the pixel keeps its colour
+	cache.BeginFrame(scene);
+	SELF_CHECK(cache.CanReuse(untouched, centerX, centerY, centerRay));
+	cache.EndFrame(scene);
+
+	//The small sphere moves right by one unit
+	spheres[2]._center = Vec3f(-3.0f, 1.0f, -20.0f);
+	SetScene(scene, spheres);
+	cache.BeginFrame(scene);
+
+	//A pixel that only saw the big sphere, with no rays near the moved one, is reused
+	SELF_CHECK(cache.CanReuse(untouched, centerX, centerY, centerRay));
+
+	//A pixel that hit the moved sphere is traced again
+	SELF_CHECK(!cache.CanReuse(HitPixel(2, 19.0f), centerX, centerY, centerRay));
+
+	//A primary ray through where the sphere is now, that missed everything last frame, is traced again
+	unsigned movedX, movedY;
+	FindPixel(config, spheres[2]._center, movedX, movedY);
+	const Vec3f movedRay = PrimaryRay(config, movedX, movedY);
+	SELF_CHECK(!cache.CanReuse(HitPixel(-1, INFINITY), movedX, movedY, movedRay));
+	//The same ray through where it was before
+	FindPixel(config, Vec3f(-4.0f, 1.0f, -20.0f), movedX, movedY);
+	SELF_CHECK(!cache.CanReuse(HitPixel(-1, INFINITY), movedX, movedY, PrimaryRay(config, movedX, movedY)));
+	//A primary hit in front of the moved sphere hides it
+	FindPixel(config, spheres[2]._center, movedX, movedY);
+	SELF_CHECK(cache.CanReuse(HitPixel(0, 5.0f), movedX, movedY, movedRay));
+
+	//A shadow ray from the big sphere to a light on the far side of the moved sphere could now be blocked
+	PixelHistory shadowed = HitPixel(0, 26.0f);
+	shadowed.AddSegment(Vec3f(0.0f, 0.0f, -26.0f), Vec3f(-8.0f, 2.0f, -18.0f));
+	SELF_CHECK(!cache.CanReuse(shadowed, centerX, centerY, centerRay));
+	//One to the light above is nowhere near it
+	PixelHistory lit = HitPixel(0, 26.0f);
+	lit.Touch(1);
+	lit.AddSegment(Vec3f(0.0f, 4.0f, -30.0f), spheres[1]._center);
+	SELF_CHECK(cache.CanReuse(lit, centerX, centerY, centerRay));
+
+	//A reflection that left the scene could have gone anywhere
+	PixelHistory escaped = HitPixel(0, 26.0f);
+	escaped.escaped = true;
+	SELF_CHECK(!cache.CanReuse(escaped, centerX, centerY, centerRay));
+	cache.EndFrame(scene);
+
+	//Only the big sphere's colour changes, the pixels that saw it are traced and the others are not
+	spheres[0]._surfaceColor = Vec3f(0.4f);
+	SetScene(scene, spheres);
+	cache.BeginFrame(scene);
+	SELF_CHECK(!cache.CanReuse(untouched, centerX, centerY, centerRay));
+	SELF_CHECK(cache.CanReuse(HitPixel(-1, INFINITY), 0, 0, PrimaryRay(config, 0, 0)));
+	cache.EndFrame(scene);
+
+	//A frame that was not finished leaves nothing to reuse
+	cache.DiscardFrame();
+	cache.BeginFrame(scene);
+	SELF_CHECK(!cache.CanReuse(HitPixel(-1, INFINITY), 0, 0, PrimaryRay(config, 0, 0)));
+	cache.EndFrame(scene);
+}
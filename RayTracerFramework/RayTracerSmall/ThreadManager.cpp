@@ -1,15 +1,17 @@
 #include "ThreadManager.h"
+#include <new>
 
 #if defined _WIN32
 std::vector<std::thread*> ThreadManager::_threads;
 #else 
 std::vector<pid_t> ThreadManager::_threads;
 #endif
+std::atomic<bool> ThreadManager::_taskFailed(false);
 
 void ThreadManager::CreateTask(std::function<void()> task)
 {
 #if defined _WIN32
-	std::thread* newThread = new std::thread(task);
+	std::thread* newThread = new std::thread([task] { RunTask(task); });
 	_threads.emplace_back(newThread);
 #else
 	pid_t newThread = vfork();
@@ -17,16 +19,34 @@ void ThreadManager::CreateTask(std::function<void()> task)
 		printf("Error: Couldn't create fork");
 }
 	else if (newThread == 0) {
-		_threads.emplace_back(newThread);
-		task();
+		//The child shares the parent's stack until it exits, an exception leaving it would unwind the parent's frames
+		RunTask(task);
 		_exit(0);
 	}
 	else {
-
+		//The parent runs again once the child has exited, so a child that cannot be listed is collected here
+		try {
+			_threads.emplace_back(newThread);
+		}
+		catch (const std::bad_alloc&) {
+			int status;
+			waitpid(newThread, &status, 0);
+			throw;
+		}
 	}
 #endif
 }
-void ThreadManager::WaitForAllThreads()
+void ThreadManager::RunTask(const std::function<void()>& task)
+{
+	try {
+		task();
+	}
+	catch (const std::bad_alloc&) {
+		_taskFailed = true;
+	}
+}
+
+bool ThreadManager::WaitForAllThreads()
 {
 #ifdef _WIN32
 	for (auto& t : _threads) {
@@ -39,7 +59,7 @@ void ThreadManager::WaitForAllThreads()
 #else
 	int status;
 	for (auto& t : _threads) {
-		if (wait(&status) == -1) {
+		if (waitpid(t, &status, 0) == -1) {
 
 		}
 		else if (WIFEXITED(status)) {
@@ -49,4 +69,5 @@ void ThreadManager::WaitForAllThreads()
 
 	_threads.clear();
 #endif
+	return !_taskFailed.exchange(false);
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <vector>
 #include <functional>
 
@@ -16,8 +17,13 @@ class ThreadManager
 {
 public:
 	static void CreateTask(std::function<void()> task);
-	static void WaitForAllThreads();
+	//Returns false if any of the tasks ran out of memory. Its work is incomplete, the others finished theirs
+	static bool WaitForAllThreads();
 private:
+	//Runs a task, a std::bad_alloc is recorded rather than leaving the thread or the forked child
+	static void RunTask(const std::function<void()>& task);
+
+	static std::atomic<bool> _taskFailed;
 #if defined _WIN32
 	static std::vector<std::thread*> _threads;
 #else
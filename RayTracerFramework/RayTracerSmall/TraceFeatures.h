@@ -0,0 +1,39 @@
+#pragma once
+#include <utility>
+#include "FastMath.h"
+
+//Parts of trace that a frame can do without. trace and the render loops are compiled for every set of these
+//as a template argument, so the branches a frame does not need are not in the code it runs
+enum TraceFeature {
+	//Reflection and refraction rays. Off when nothing in the scene reflects or is transparent, or the max depth
+	//is 0, which also takes out the depth check
+	TRACE_SECONDARY = 1,
+	//Refraction rays, off when nothing in the scene is transparent
+	TRACE_REFRACTION = 2,
+	//Shadow rays toward the lights, off when they are turned off in the config
+	TRACE_SHADOWS = 4,
+	//Rays are recorded in the pixel's temporal history, only on for the temporal cache's loops
+	TRACE_HISTORY = 8,
+	//Number of feature sets, every combination of the flags above
+	TRACE_FEATURE_SETS = 16
+};
+
+//Picks a kernel compiled for a math mode and feature set at runtime. Kernel is a struct with a Pointer typedef
+//and a static Get<mode, features>() returning the function compiled for them, the table holds one for each
+template<typename Kernel, int... features>
+typename Kernel::Pointer SelectKernel(MathMode mode, int featureSet, std::integer_sequence<int, features...>)
+{
+	//In MathMode order
+	static const typename Kernel::Pointer table[MATH_MODE_COUNT][sizeof...(features)] = {
+		{ Kernel::template Get<MATH_EXACT, features>()... },
+		{ Kernel::template Get<MATH_FAST, features>()... },
+		{ Kernel::template Get<MATH_FASTEST, features>()... }
+	};
+	return table[mode][featureSet];
+}
+
+template<typename Kernel>
+typename Kernel::Pointer SelectKernel(MathMode mode, int featureSet)
+{
+	return SelectKernel<Kernel>(mode, featureSet, std::make_integer_sequence<int, TRACE_FEATURE_SETS>());
+}
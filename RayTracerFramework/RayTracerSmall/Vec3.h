@@ -1,5 +1,19 @@
 #pragma once
 #include <cmath>
+#include <iostream>
+
+//Uncomment, or define on the compiler command line (-DVEC3_NO_SIMD, /DVEC3_NO_SIMD), to use the generic scalar
+//template for floats too, used to compare against the SIMD version. It has to be a build of its own: Vec3<float>
+//is one type across the program, so the two versions cannot be linked into the same binary
+//#define VEC3_NO_SIMD
+
+#if !defined VEC3_NO_SIMD && (defined __SSE__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 1))
+#define VEC3_SSE
+#include <xmmintrin.h>
+#elif !defined VEC3_NO_SIMD && (defined __ARM_NEON || defined _M_ARM64)
+#define VEC3_NEON
+#include <arm_neon.h>
+#endif
 
 template<typename T>
 class Vec3
@@ -36,4 +50,105 @@ public:
 	}
 };
 
+#if defined VEC3_SSE || defined VEC3_NEON
+//The few vector operations Vec3<float> needs, so the class itself is written once for SSE and NEON
+#if defined VEC3_SSE
+#define VEC3_SIMD_NAME "SSE"
+typedef __m128 Vec3Register;
+inline Vec3Register SimdLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void SimdStore(float* p, Vec3Register v) { _mm_storeu_ps(p, v); }
+inline Vec3Register SimdSplat(float f) { return _mm_set1_ps(f); }
+inline Vec3Register SimdAdd(Vec3Register a, Vec3Register b) { return _mm_add_ps(a, b); }
+inline Vec3Register SimdSub(Vec3Register a, Vec3Register b) { return _mm_sub_ps(a, b); }
+inline Vec3Register SimdMul(Vec3Register a, Vec3Register b) { return _mm_mul_ps(a, b); }
+inline Vec3Register SimdNegate(Vec3Register a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+//Sums x, y and z in the same order as the scalar code, so dot products match it exactly
+inline float SimdDot3(Vec3Register a, Vec3Register b)
+{
+	Vec3Register m = _mm_mul_ps(a, b);
+	Vec3Register y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+	Vec3Register z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+	return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(m, y), z));
+}
+//rsqrtss is good to 12 bits, one Newton-Raphson step r * (1.5 - 0.5 * n * r * r) brings it to about 23
+inline float SimdRsqrt(float n)
+{
+	__m128 nn = _mm_set_ss(n);
+	__m128 r = _mm_rsqrt_ss(nn);
+	__m128 halfNRR = _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), nn), _mm_mul_ss(r, r));
+	return _mm_cvtss_f32(_mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), halfNRR)));
+}
+inline float SimdSqrt(float n) { return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(n))); }
+#else
+#define VEC3_SIMD_NAME "NEON"
+typedef float32x4_t Vec3Register;
+inline Vec3Register SimdLoad(const float* p) { return vld1q_f32(p); }
+inline void SimdStore(float* p, Vec3Register v) { vst1q_f32(p, v); }
+inline Vec3Register SimdSplat(float f) { return vdupq_n_f32(f); }
+inline Vec3Register SimdAdd(Vec3Register a, Vec3Register b) { return vaddq_f32(a, b); }
+inline Vec3Register SimdSub(Vec3Register a, Vec3Register b) { return vsubq_f32(a, b); }
+inline Vec3Register SimdMul(Vec3Register a, Vec3Register b) { return vmulq_f32(a, b); }
+inline Vec3Register SimdNegate(Vec3Register a) { return vnegq_f32(a); }
+inline float SimdDot3(Vec3Register a, Vec3Register b)
+{
+	Vec3Register m = vmulq_f32(a, b);
+	return (vgetq_lane_f32(m, 0) + vgetq_lane_f32(m, 1)) + vgetq_lane_f32(m, 2);
+}
+//vrsqrte is only good to 8 bits, it takes two Newton-Raphson steps to get close to full precision
+inline float SimdRsqrt(float n)
+{
+	float32x2_t nn = vdup_n_f32(n);
+	float32x2_t r = vrsqrte_f32(nn);
+	r = vmul_f32(r, vrsqrts_f32(vmul_f32(nn, r), r));
+	r = vmul_f32(r, vrsqrts_f32(vmul_f32(nn, r), r));
+	return vget_lane_f32(r, 0);
+}
+inline float SimdSqrt(float n) { return sqrtf(n); }
+#endif
+
+//Vec3f backed by a 4 wide register. The fourth lane lives in what used to be the padding, so the class
+//stays 16 bytes. Loads and stores are unaligned as the custom allocators only guarantee pointer alignment.
+template<>
+class Vec3<float>
+{
+public:
+	float x, y, z;
+	//Padding lane, kept at 0 by the constructors and never read by dot or length
+	float w;
+	Vec3() : x(0), y(0), z(0), w(0) {}
+	Vec3(float xx) : x(xx), y(xx), z(xx), w(0) {}
+	Vec3(float xx, float yy, float zz) : x(xx), y(yy), z(zz), w(0) {}
+	inline Vec3& normalize()
+	{
+		Vec3Register v = Load();
+		float nor2 = SimdDot3(v, v);
+		if (nor2 > 0) {
+			SimdStore(&x, SimdMul(v, SimdSplat(SimdRsqrt(nor2))));
+		}
+		return *this;
+	}
+	inline Vec3<float> operator * (const float& f) const { return Vec3<float>(SimdMul(Load(), SimdSplat(f))); }
+	inline Vec3<float> operator * (const Vec3<float>& v) const { return Vec3<float>(SimdMul(Load(), v.Load())); }
+	inline float dot(const Vec3<float>& v) const { return SimdDot3(Load(), v.Load()); }
+	inline Vec3<float> operator - (const Vec3<float>& v) const { return Vec3<float>(SimdSub(Load(), v.Load())); }
+	inline Vec3<float> operator + (const Vec3<float>& v) const { return Vec3<float>(SimdAdd(Load(), v.Load())); }
+	inline Vec3<float>& operator += (const Vec3<float>& v) { SimdStore(&x, SimdAdd(Load(), v.Load())); return *this; }
+	inline Vec3<float>& operator *= (const Vec3<float>& v) { SimdStore(&x, SimdMul(Load(), v.Load())); return *this; }
+	inline Vec3<float> operator - () const { return Vec3<float>(SimdNegate(Load())); }
+	inline float length2() const { Vec3Register v = Load(); return SimdDot3(v, v); }
+	inline float length() const { return SimdSqrt(length2()); }
+	friend std::ostream& operator << (std::ostream& os, const Vec3<float>& v)
+	{
+		os << "[" << v.x << ", " << v.y << ", " << v.z << "]";
+		return os;
+	}
+
+private:
+	explicit Vec3(Vec3Register v) { SimdStore(&x, v); }
+	inline Vec3Register Load() const { return SimdLoad(&x); }
+};
+#else
+#define VEC3_SIMD_NAME "scalar"
+#endif
+
 typedef Vec3<float> Vec3f;
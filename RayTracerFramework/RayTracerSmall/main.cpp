@@ -24,10 +24,15 @@
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <cstdint>
+#include <climits>
+#include <cstring>
 #include <thread>
 
 // Windows only
 #include <algorithm>
+#include <atomic>
+#include <new>
 #include <sstream>
 #include <string>
 
@@ -39,12 +44,30 @@
 #include "Timer.h"
 #include "Vec3.h"
 #include "Sphere.h"
+#include "Plane.h"
+#include "Scene.h"
 #include "MemoryManager.h"
 #include "HeapManager.h"
+#include "HeapTelemetry.h"
 #include "JSONReader.h"
 #include "MemoryPool.h"
 #include "ThreadManager.h"
 #include "RenderConfig.h"
+#include "PerfCounters.h"
+#include "BinaryScene.h"
+#include "Benchmark.h"
+#include "RenderManifest.h"
+#include "RenderOptions.h"
+#include "ChunkPlanner.h"
+#include "FastMath.h"
+#include "TraceFeatures.h"
+#include "RayTable.h"
+#include "AntiAliasing.h"
+#include "RenderFarm.h"
+#include "FrameRing.h"
+#include "TemporalCache.h"
+#include "ScreenTiles.h"
+#include "SelfTest.h"
 
 #if defined __linux__ || defined __APPLE__
 // "Compiled for Linux
@@ -53,22 +76,161 @@
 #define INFINITY 1e8
 #endif
 
+//PROGRAM CONTROLS
+//Resolution, threads, ray depth, container layout and allocator are runtime options, see RenderOptions.h
+
+//Frame buffer pools, only created when the pools allocator is selected
+MemoryPool* chunkPool = nullptr;
+MemoryPool* charPool = nullptr;
+//Splits each frame between the workers, kept between frames so it can balance on the last frame's timings
+ChunkPlanner* chunkPlanner = nullptr;
+//Colours and ray dependencies of the last frame, only created when temporal reuse is on
+TemporalCache* temporalCache = nullptr;
+//Spheres near each tile of the screen, only created when screen tiles are on
+ScreenTiles* screenTiles = nullptr;
+//Primary ray directions made once for every frame, only created when the ray table is on
+RayTable* rayTable = nullptr;
+
+//Step between the samples of the first progressive pass, each later pass halves it down to every pixel
+#define PROGRESSIVE_FIRST_STEP 4
+//Edge pixels a worker supersamples between checks of the progressive time budget
+#define PROGRESSIVE_AA_BLOCK 64
+
+//Bytes left free on the default heap for the small allocations of a frame when its budget sizes the frame buffers
+#define FRAME_BUDGET_RESERVE (256 * 1024)
+
+//Start of the name of every frame file. Farm workers change it so several of them can share a directory
+std::string frameFilePrefix = "./spheres";
+
+//Name of the file a frame is written to
+std::string FrameFileName(const int& iteration)
+{
+	return frameFilePrefix + std::to_string(iteration) + ".ppm";
+}
 
-// This variable controls the maximum recursion depth
-#define MAX_RAY_DEPTH 5
+//Header of the binary PPM every frame is encoded as
+std::string FrameHeader(const RenderConfig& config)
+{
+	return "P6\n" + std::to_string(config.width) + " " + std::to_string(config.height) + "\n255\n";
+}
 
-//PROGRAM CONTROLS 
-#define MAX_THREADS 8
-#define MULTIPLE_CONTAINERS
-#if defined _WIN32
-//#define USE_PARALLEL_FOR
-#endif
-#define USE_MEMORY_POOLS
+//Size of an encoded frame, header included
+size_t FrameByteCount(const RenderConfig& config)
+{
+	return FrameHeader(config).length() + (size_t)config.width * config.height * 3;
+}
 
-#ifdef USE_MEMORY_POOLS
-MemoryPool* chunkPool;
-MemoryPool* charPool;
-#endif
+//Number of lights each worker remembers an occluder for, lights past this share slots
+#define SHADOW_CACHE_SIZE 16
+
+//Last object found blocking each light. Neighbouring pixels are usually shadowed by the same object
+//so it is tested before the rest of the scene. Spheres are stored by index, planes as sphereCount + index
+struct ShadowCache {
+	int occluder[SHADOW_CACHE_SIZE];
+	ShadowCache() {
+		for (int i = 0; i < SHADOW_CACHE_SIZE; ++i) occluder[i] = -1;
+	}
+};
+//One per worker so the workers never write to each others cache
+thread_local ShadowCache shadowCache;
+
+//Tests one sphere or plane by its shadow cache index
+inline bool OccludedBy(const Scene& scene, const int& object, const Vec3f& orig, const Vec3f& dir, const float& distance)
+{
+	if (object < scene.sphereCount) return scene.spheres[object].occludes(orig, dir, distance);
+
+	float t;
+	int plane = object - scene.sphereCount;
+	return plane < scene.planeCount && scene.planes[plane].intersect(orig, dir, t) && t < distance;
+}
+
+//Any hit shadow test, stops at the first object found between the point and the light
+inline bool IsOccluded(const Scene& scene, const int& lightSlot, const int& light, const Vec3f& orig, const Vec3f& dir, const float& distance)
+{
+	int& cached = shadowCache.occluder[lightSlot % SHADOW_CACHE_SIZE];
+	if (cached >= 0 && cached != light && OccludedBy(scene, cached, orig, dir, distance)) return true;
+
+	for (int j = 0; j < scene.sphereCount; ++j) {
+		if (j == light || j == cached) continue;
+		if (scene.spheres[j].occludes(orig, dir, distance)) {
+			cached = j;
+			return true;
+		}
+	}
+	for (int j = 0; j < scene.planeCount; ++j) {
+		float t;
+		if (scene.planes[j].intersect(orig, dir, t) && t < distance) {
+			cached = scene.sphereCount + j;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//Object hit by the last primary ray the worker traced, spheres by index then planes, -1 for the background.
+//The loops copy it out for the anti aliasing edge detection
+thread_local int primaryHitId = -1;
+
+//Random number in [0, 1) made from the bits of a ray direction, so russian roulette gives the same frame
+//whatever the number of workers or the order the pixels are traced in
+inline float RouletteRandom(const Vec3f& raydir, const int& salt)
+{
+	uint32_t bits[3];
+	memcpy(&bits[0], &raydir.x, sizeof(float));
+	memcpy(&bits[1], &raydir.y, sizeof(float));
+	memcpy(&bits[2], &raydir.z, sizeof(float));
+
+	//MurmurHash3 finaliser over each word
+	uint32_t h = (uint32_t)salt * 0x9e3779b9u;
+	for (uint32_t word : bits) {
+		h ^= word;
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35u;
+		h ^= h >> 16;
+	}
+	return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+//Decides whether a secondary ray is traced. Returns 0 to drop it, otherwise the scale for its colour,
+//1 unless it survived russian roulette
+inline float ContinuationScale(const RayLimits& limits, const float& throughput, const Vec3f& raydir, const int& salt)
+{
+	if (throughput >= limits.minThroughput) return 1.0f;
+	if (!limits.russianRoulette || throughput <= 0.0f) return 0.0f;
+
+	float survival = throughput / limits.minThroughput;
+	return RouletteRandom(raydir, salt) < survival ? 1.0f / survival : 0.0f;
+}
+
+//Adds a ray of the pixel being traced to its temporal history. Secondary rays are kept as a box around
+//the segment up to their hit, or marked as escaped if they left the scene
+inline void RecordRay(const Scene& scene, const int& depth, const Vec3f& rayorig, const Vec3f& raydir, const Sphere* hitSphere, const Plane* hitPlane, const float& tnear)
+{
+	int id = -1;
+	if (hitPlane != nullptr) id = scene.sphereCount + (int)(hitPlane - scene.planes);
+	else if (hitSphere != nullptr) id = (int)(hitSphere - scene.spheres);
+
+	pixelHistory->Touch(id);
+	if (depth == 0) pixelHistory->primaryDistance = tnear;
+	else if (id < 0) pixelHistory->escaped = true;
+	else pixelHistory->AddSegment(rayorig, rayorig + raydir * tnear);
+}
+
+//Keeps the sphere if the ray hits it closer than the nearest hit so far
+inline void NearestSphere(const Sphere& object, const Vec3f& rayorig, const Vec3f& raydir, float& tnear, const Sphere*& hitSphere)
+{
+	float t0 = INFINITY, t1 = INFINITY;
+	if (object.intersect(rayorig, raydir, t0, t1)) {
+		if (t0 < 0) t0 = t1;
+		if (t0 < tnear) {
+			tnear = t0;
+			hitSphere = &object;
+		}
+	}
+}
 
 inline float mix(const float& a, const float& b, const float& mix)
 {
@@ -84,32 +246,59 @@ inline float mix(const float& a, const float& b, const float& mix)
 // The function returns a color for the ray. If the ray intersects an object that
 // is the color of the object at the intersection point, otherwise it returns
 // the background color.
+// The math mode picks the precision of the normalizes, the refraction sqrt and the Fresnel power.
+// features are the TraceFeature flags of the parts the frame needs, the others are compiled out.
+// throughput is how much the colour returned adds to the pixel, 1 for primary rays.
 //[/comment]
-Vec3f trace(const Vec3f& rayorig, const Vec3f& raydir, const Sphere* spheres, const int& depth, const int& size)
+template<MathMode mode, int features>
+Vec3f trace(const Vec3f& rayorig, const Vec3f& raydir, const Scene& scene, const int& depth, const RayLimits& limits, const float& throughput)
 {
 	//if (raydir.length() != 1) std::cerr << "Error " << raydir << std::endl;
+	const Sphere* spheres = scene.spheres;
+	const int& size = scene.sphereCount;
 	float tnear = INFINITY;
-	const Sphere* hit = nullptr;
-	// find intersection of this ray with the sphere in the scene
-	for (size_t i = 0; i < size; ++i) {
-		const Sphere& object = spheres[i];
-		float t0 = INFINITY, t1 = INFINITY;
-		if (object.intersect(rayorig, raydir, t0, t1)) {
-			if (t0 < 0) t0 = t1;
-			if (t0 < tnear) {
-				tnear = t0;
-				hit = &object;
-			}
+	const Sphere* hitSphere = nullptr;
+	const Plane* hitPlane = nullptr;
+	// find intersection of this ray with the sphere in the scene. Primary rays start at the camera, so
+	// with screen tiles they only test the spheres whose rectangle on screen covers their tile
+	int candidateCount = 0;
+	const int* candidates = depth == 0 && scene.screenTiles != nullptr ? scene.screenTiles->GetCandidates(raydir, candidateCount) : nullptr;
+	if (candidates != nullptr) {
+		for (int c = 0; c < candidateCount; ++c) NearestSphere(spheres[candidates[c]], rayorig, raydir, tnear, hitSphere);
+	}
+	else {
+		for (int i = 0; i < size; ++i) NearestSphere(spheres[i], rayorig, raydir, tnear, hitSphere);
+	}
+	// and with the planes
+	for (int i = 0; i < scene.planeCount; ++i) {
+		float t = INFINITY;
+		if (scene.planes[i].intersect(rayorig, raydir, t) && t < tnear) {
+			tnear = t;
+			hitPlane = &scene.planes[i];
+			hitSphere = nullptr;
 		}
 	}
 
+	if (depth == 0) {
+		if (hitPlane != nullptr) primaryHitId = size + (int)(hitPlane - scene.planes);
+		else primaryHitId = hitSphere != nullptr ? (int)(hitSphere - spheres) : -1;
+	}
+	if ((features & TRACE_HISTORY) && pixelHistory != nullptr) RecordRay(scene, depth, rayorig, raydir, hitSphere, hitPlane, tnear);
+
 	// if there's no intersection return black or background color
+	const Primitive* hit = hitPlane != nullptr ? (const Primitive*)hitPlane : hitSphere;
 	if (!hit) return Vec3f(2);
 
 	Vec3f surfaceColor = 0; // color of the ray/surface of the object intersected by the ray
 	Vec3f phit = rayorig + raydir * tnear; // point of intersection
-	Vec3f nhit = phit - hit->_center; // normal at the intersection point
-	nhit.normalize(); // normalize normal direction
+	Vec3f nhit; // normal at the intersection point
+	if (hitPlane != nullptr) {
+		nhit = hitPlane->_normal; // already unit length
+	}
+	else {
+		nhit = phit - hitSphere->_center;
+		Normalize<mode>(nhit); // normalize normal direction
+	}
 					  // If the normal and the view direction are not opposite to each other
 					  // reverse the normal direction. That also means we are inside the sphere so set
 					  // the inside bool to true. Finally reverse the sign of IdotN which we want
@@ -117,24 +306,35 @@ Vec3f trace(const Vec3f& rayorig, const Vec3f& raydir, const Sphere* spheres, co
 	float bias = 1e-4; // add some bias to the point from which we will be tracing
 	bool inside = false;
 	if (raydir.dot(nhit) > 0) nhit = -nhit, inside = true;
-	if (depth < MAX_RAY_DEPTH && (hit->_transparency > 0.0f || hit->_reflection > 0.0f)) {
+	if ((features & TRACE_SECONDARY) && depth < limits.maxDepth && (hit->_transparency > 0.0f || hit->_reflection > 0.0f)) {
 		float facingratio = -raydir.dot(nhit);
 		// change the mix value to tweak the effect
-		float fresneleffect = mix(pow(1.0f - facingratio, 3.0f), 1.0f, 0.1f);
+		float fresneleffect = mix(Pow3<mode>(1.0f - facingratio), 1.0f, 0.1f);
 		// compute reflection direction (not need to normalize because all vectors
 		// are already normalized)
 		Vec3f refldir = raydir - nhit * 2 * raydir.dot(nhit);
-		refldir.normalize();
-		Vec3f reflection = trace(phit + nhit * bias, refldir, spheres, depth + 1, size);
+		Normalize<mode>(refldir);
+		// what each ray can add to the pixel, the surface colour counted by its strongest channel
+		float surfaceWeight = std::max(hit->_surfaceColor.x, std::max(hit->_surfaceColor.y, hit->_surfaceColor.z));
+		float reflectionThroughput = throughput * fresneleffect * surfaceWeight;
+		float reflectionScale = ContinuationScale(limits, reflectionThroughput, refldir, depth * 2);
+		Vec3f reflection = 0;
+		if (reflectionScale > 0.0f) {
+			reflection = trace<mode, features>(phit + nhit * bias, refldir, scene, depth + 1, limits, reflectionThroughput * reflectionScale) * reflectionScale;
+		}
 		Vec3f refraction = 0;
+		float refractionThroughput = throughput * (1 - fresneleffect) * hit->_transparency * surfaceWeight;
 		// if the sphere is also transparent compute refraction ray (transmission)
-		if (hit->_transparency) {
+		if ((features & TRACE_REFRACTION) && hit->_transparency) {
 			float ior = 1.1, eta = (inside) ? ior : 1 / ior; // are we inside or outside the surface?
 			float cosi = -nhit.dot(raydir);
 			float k = 1 - eta * eta * (1 - cosi * cosi);
-			Vec3f refrdir = raydir * eta + nhit * (eta * cosi - sqrt(k));
-			refrdir.normalize();
-			refraction = trace(phit - nhit * bias, refrdir, spheres, depth + 1, size);
+			Vec3f refrdir = raydir * eta + nhit * (eta * cosi - Sqrt<mode>(k));
+			Normalize<mode>(refrdir);
+			float refractionScale = ContinuationScale(limits, refractionThroughput, refrdir, depth * 2 + 1);
+			if (refractionScale > 0.0f) {
+				refraction = trace<mode, features>(phit - nhit * bias, refrdir, scene, depth + 1, limits, refractionThroughput * refractionScale) * refractionScale;
+			}
 		}
 		// the result is a mix of reflection and refraction (if the sphere is transparent)
 		surfaceColor = (
@@ -143,358 +343,1233 @@ Vec3f trace(const Vec3f& rayorig, const Vec3f& raydir, const Sphere* spheres, co
 	}
 	else {
 		// it's a diffuse object, no need to ray trace any further
-		for (unsigned i = size - 1; i != 0; --i) {
-			if (spheres[i]._emissionColor.x > 0) {
-				// this is a light
-				Vec3f transmission = 1;
-				Vec3f lightDirection = spheres[i]._center - phit;
-				lightDirection.normalize();
-				for (unsigned j = size - 1; j != 0; --j) {
-					if (i != j) {
-						float t0, t1;
-						if (spheres[j].intersect(phit + nhit * bias, lightDirection, t0, t1)) {
-							transmission = 0;
-							break;
-						}
-					}
-				}
-				surfaceColor += hit->_surfaceColor * transmission *
-					std::max(float(0), nhit.dot(lightDirection)) * spheres[i]._emissionColor;
+		Vec3f shadowOrig = phit + nhit * bias;
+		for (int l = 0; l < (int)scene.lights.size(); ++l) {
+			// this is a light
+			int i = scene.lights[l];
+			Vec3f transmission = 1;
+			Vec3f lightDirection = spheres[i]._center - phit;
+			// anything past the centre of the light cannot shadow it
+			float lightDistance = lightDirection.length();
+			Normalize<mode>(lightDirection);
+			bool occluded = (features & TRACE_SHADOWS) && IsOccluded(scene, l, i, shadowOrig, lightDirection, lightDistance);
+			if (occluded) transmission = 0;
+			if ((features & TRACE_HISTORY) && pixelHistory != nullptr) {
+				//A blocked light only changes if its occluder moves, an unblocked one if anything moves into the way
+				pixelHistory->Touch(i);
+				if (occluded) pixelHistory->Touch(shadowCache.occluder[l % SHADOW_CACHE_SIZE]);
+				else pixelHistory->AddSegment(shadowOrig, spheres[i]._center);
 			}
+			surfaceColor += hit->_surfaceColor * transmission *
+				std::max(float(0), nhit.dot(lightDirection)) * spheres[i]._emissionColor;
 		}
 	}
 
 	return surfaceColor + hit->_emissionColor;
 }
 
+//Direction of the primary ray of pixel (x, y), from the ray table if there is one
+template<MathMode mode>
+inline Vec3f PrimaryRay(const RowRays& rays, const unsigned int& x, const unsigned int& y)
+{
+	if (rayTable != nullptr) return rayTable->GetDirection(x, y);
+
+	Vec3f raydir = rays.Direction(x);
+	Normalize<mode>(raydir);
+	return raydir;
+}
+
+//Traces one row of a sector. row and rowIds start at x = 0
+template<MathMode mode, int features>
+inline void TraceRow(const RenderConfig& config, const unsigned int& y, const unsigned int& startX, const unsigned int& endX, Vec3f* row, int* rowIds, const Scene& scene)
+{
+	const RowRays rays(config, y);
+	for (unsigned x = startX; x < endX; ++x) {
+		Vec3f raydir = PrimaryRay<mode>(rays, x, y);
+		row[x] = trace<mode, features>(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f);
+		if (rowIds != nullptr) rowIds[x] = primaryHitId;
+	}
+}
+
+//Traces one row for the temporal cache, pixels it says are unchanged keep their colour. row and rowIds start at x = 0
+template<MathMode mode, int features>
+inline void TemporalRow(const RenderConfig& config, const unsigned int& y, const unsigned int& startX, const unsigned int& endX, Vec3f* row, int* rowIds, const Scene& scene)
+{
+	const RowRays rays(config, y);
+	unsigned reused = 0;
+	for (unsigned x = startX; x < endX; ++x) {
+		PixelHistory& history = temporalCache->GetPixel(x, y);
+		Vec3f raydir = PrimaryRay<mode>(rays, x, y);
+		if (temporalCache->CanReuse(history, x, y, raydir)) {
+			reused++;
+		}
+		else {
+			history.Reset();
+			pixelHistory = &history;
+			history.color = trace<mode, features>(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f);
+			pixelHistory = nullptr;
+			history.primaryHitId = primaryHitId;
+		}
+
+		row[x] = history.color;
+		if (rowIds != nullptr) rowIds[x] = history.primaryHitId;
+	}
+	temporalCache->SetRowReused(y, reused);
+}
+
+//Output layouts for RenderRows, where each row of a sector goes in its buffers
+
+//Multiple containers, the worker's buffer starts at the first row of its sector
+struct ChunkLayout {
+	static size_t RowOffset(const unsigned int& y, const unsigned int& startY, const unsigned int& width) { return (size_t)width * (y - startY); }
+};
+
+//Singular container, every row is at its row of the frame
+struct FrameLayout {
+	static size_t RowOffset(const unsigned int& y, const unsigned int&, const unsigned int& width) { return (size_t)width * y; }
+};
+
+//Schedules for RenderRows, how the rows of a sector are shared out on the worker
+
+//One row after another on the worker's thread
+struct SerialSchedule {
+	template<typename RowFunction>
+	static void ForEachRow(const unsigned int& startY, const unsigned int& endY, const RowFunction& traceRow)
+	{
+		for (unsigned y = startY; y < endY; ++y) traceRow(y);
+	}
+};
+
 #ifdef _WIN32
-inline void MultiContainerParallel(const unsigned int& startY, const unsigned int& endY, Vec3f* image, const Sphere* spheres, const int& size, const unsigned int& startX, const unsigned int& endX, const float& invWidth, const float& invHeight, const float& aspectratio, const float& angle)
+//Rows split again with parallel_for inside the worker
+struct ParallelForSchedule {
+	template<typename RowFunction>
+	static void ForEachRow(const unsigned int& startY, const unsigned int& endY, const RowFunction& traceRow)
+	{
+		concurrency::parallel_for(startY, endY, [&traceRow](size_t y) { traceRow((unsigned)y); });
+	}
+};
+#endif
+
+//The render loop of every layout and schedule, so they all share the same row loop
+template<MathMode mode, int features, typename Layout, typename Schedule>
+void RenderRows(const RenderConfig& config, const unsigned int& startX, const unsigned int& startY, const unsigned int& endX, const unsigned int& endY, const Scene& scene, Vec3f* image, int* ids)
 {
-	concurrency::parallel_for(startY, endY, [image, &spheres, &size, &startX, &endY, &endX, &invWidth, &invHeight, &aspectratio, &startY, &angle](size_t y)
+	Schedule::ForEachRow(startY, endY, [&config, &startX, &startY, &endX, &scene, image, ids](const unsigned int& y)
 		{
-			for (unsigned x = startX; x < endX; ++x) {
-				float xx = (2 * ((x + 0.5) * invWidth) - 1) * angle * aspectratio;
-				float yy = (1 - 2 * ((y + 0.5) * invHeight)) * angle;
-				Vec3f raydir(xx, yy, -1);
-				raydir.normalize();
-				//The index is calculated as endX * (y - startY) + x. (y - startY) gets the difference between startY and y allowing us to properly cycle through multiple containers
-				image[endX * (y - startY) + x] = trace(Vec3f(0), raydir, spheres, 0, size);
-			}
+			size_t row = Layout::RowOffset(y, startY, endX);
+			int* rowIds = ids != nullptr ? ids + row : nullptr;
+			//Only the temporal loops record the rays, see FindTraceFeatures
+			if (features & TRACE_HISTORY) TemporalRow<mode, features>(config, y, startX, endX, image + row, rowIds, scene);
+			else TraceRow<mode, features>(config, y, startX, endX, image + row, rowIds, scene);
 		});
 }
-#endif
 
-inline void MultiContainerNonParallel(const unsigned int& startY, const unsigned int& endY, const unsigned int& startX, const unsigned int& endX, const float& invWidth, const float& angle, const float& aspectratio, const float& invHeight, Vec3f* image, const Sphere* spheres, const int& size)
+template<MathMode mode, int features>
+void RenderSector(const RenderConfig& config, const unsigned int& startX, const unsigned int& startY, const unsigned int& endX, const unsigned int& endY, const Scene& scene, Vec3f* image, int* ids)
 {
-	int index = 0;
-	for (unsigned y = startY; y < endY; ++y) {
-		for (unsigned x = startX; x < endX; ++x, index++) {
-			float xx = (2 * ((x + 0.5) * invWidth) - 1) * angle * aspectratio;
-			float yy = (1 - 2 * ((y + 0.5) * invHeight)) * angle;
-			Vec3f raydir(xx, yy, -1);
-			raydir.normalize();
-			image[index] = trace(Vec3f(0), raydir, spheres, 0, size);
+	if (config.containerMode == CONTAINERS_MULTIPLE) {
+#ifdef _WIN32
+		if (config.useParallelFor) {
+			RenderRows<mode, features, ChunkLayout, ParallelForSchedule>(config, startX, startY, endX, endY, scene, image, ids);
+			return;
 		}
+#endif
+		RenderRows<mode, features, ChunkLayout, SerialSchedule>(config, startX, startY, endX, endY, scene, image, ids);
+	}
+	else {
+#ifdef _WIN32
+		if (config.useParallelFor) {
+			RenderRows<mode, features, FrameLayout, ParallelForSchedule>(config, startX, startY, endX, endY, scene, image, ids);
+			return;
+		}
+#endif
+		RenderRows<mode, features, FrameLayout, SerialSchedule>(config, startX, startY, endX, endY, scene, image, ids);
 	}
 }
 
-#ifdef _WIN32
-inline void SingularContainerParallel(const unsigned int& startY, const unsigned int& endY, Vec3f* image, const Sphere* spheres, const int& size, const unsigned int& startX, const unsigned int& endX, const float& invWidth, const float& invHeight, const float& aspectratio, const float& angle)
+//The TraceFeature flags a frame needs, from its surfaces and the render settings
+int FindTraceFeatures(const RenderConfig& config, const Scene& scene)
 {
-	concurrency::parallel_for(startY, endY, [image, &spheres, &size, &startX, &endX, &invWidth, &invHeight, &aspectratio, &angle](size_t y)
-		{
-			for (unsigned x = startX; x < endX; ++x) {
-				float xx = (2 * ((x + 0.5) * invWidth) - 1) * angle * aspectratio;
-				float yy = (1 - 2 * ((y + 0.5) * invHeight)) * angle;
+	int features = 0;
+	if (config.rayLimits.maxDepth > 0 && scene.secondaryRays) features |= TRACE_SECONDARY;
+	if (scene.transparent) features |= TRACE_REFRACTION;
+	if (config.shadows) features |= TRACE_SHADOWS;
+	if (temporalCache != nullptr) features |= TRACE_HISTORY;
+	return features;
+}
+
+//RenderSector compiled for each math mode and feature set, for SelectKernel
+struct SectorKernel {
+	typedef void(*Pointer)(const RenderConfig&, const unsigned int&, const unsigned int&, const unsigned int&, const unsigned int&, const Scene&, Vec3f*, int*);
+	template<MathMode mode, int features>
+	static Pointer Get() { return RenderSector<mode, features>; }
+};
+
+//The math mode and features are chosen once per sector so trace and the loops are compiled for each set
+void RenderSector(const RenderConfig& config, const unsigned int& startX, const unsigned int& startY, const unsigned int& endX, const unsigned int& endY, const Scene& scene, Vec3f* image, int* ids)
+{
+	SectorKernel::Pointer kernel = SelectKernel<SectorKernel>(config.mathMode, FindTraceFeatures(config, scene));
+	kernel(config, startX, startY, endX, endY, scene, image, ids);
+}
+
+//Traces the extra samples of a list of pixels. The pixels index the frame, rows starts at row startY of it and
+//holds every row the pixels are on
+template<MathMode mode, int features>
+void SupersamplePixels(const RenderConfig& config, const Scene& scene, const unsigned int& startY, Vec3f* rows, const int* pixels, const unsigned int& count)
+{
+	const int n = config.aaGridSize;
+	//The centre sample already traced counts as one of the samples
+	const float weight = 1.0f / (n * n + 1);
+	const size_t first = (size_t)startY * config.width;
+	for (unsigned i = 0; i < count; ++i) {
+		int p = pixels[i];
+		unsigned x = p % config.width;
+		unsigned y = p / config.width;
+		Vec3f& pixel = rows[p - first];
+		Vec3f sum = AntiAliasing::Clamp(pixel);
+		for (int sy = 0; sy < n; ++sy) {
+			for (int sx = 0; sx < n; ++sx) {
+				float xx = (2 * ((x + AntiAliasing::GridOffset(sx, n)) * config.invWidth) - 1) * config.angle * config.aspectRatio;
+				float yy = (1 - 2 * ((y + AntiAliasing::GridOffset(sy, n)) * config.invHeight)) * config.angle;
 				Vec3f raydir(xx, yy, -1);
-				raydir.normalize();
-				image[endX * y + x] = trace(Vec3f(0), raydir, spheres, 0, size);
+				Normalize<mode>(raydir);
+				sum += AntiAliasing::Clamp(trace<mode, features>(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f));
 			}
-		});
+		}
+		pixel = sum * weight;
+	}
+}
+
+//SupersamplePixels compiled for each math mode and feature set, for SelectKernel
+struct SupersampleKernel {
+	typedef void(*Pointer)(const RenderConfig&, const Scene&, const unsigned int&, Vec3f*, const int*, const unsigned int&);
+	template<MathMode mode, int features>
+	static Pointer Get() { return SupersamplePixels<mode, features>; }
+};
+
+void SupersamplePixels(const RenderConfig& config, const Scene& scene, const unsigned int& startY, Vec3f* rows, const int* pixels, const unsigned int& count)
+{
+	//The extra samples are not part of the temporal history
+	SupersampleKernel::Pointer kernel = SelectKernel<SupersampleKernel>(config.mathMode, FindTraceFeatures(config, scene) & ~TRACE_HISTORY);
+	kernel(config, scene, startY, rows, pixels, count);
 }
-#endif
 
-inline void SingularContainerNonParallel(const unsigned int& endX, const unsigned int& startY, const unsigned int& startX, const unsigned int& endY, const float& invWidth, const float& angle, const float& aspectratio, const float& invHeight, Vec3f* image, const Sphere* spheres, const int& size)
+//Points rows startY to endY of frameRows and frameIds, the row tables AntiAliasing::FindEdges reads, at a buffer
+//holding those rows from startY
+void PointRows(const RenderConfig& config, const Vec3f* rows, const int* ids, const unsigned int& startY, const unsigned int& endY, std::vector<const Vec3f*>& frameRows, std::vector<const int*>& frameIds)
 {
-	int index = endX * startY + startX;
 	for (unsigned y = startY; y < endY; ++y) {
-		for (unsigned x = startX; x < endX; ++x, index++) {
-			float xx = (2 * ((x + 0.5) * invWidth) - 1) * angle * aspectratio;
-			float yy = (1 - 2 * ((y + 0.5) * invHeight)) * angle;
-			Vec3f raydir(xx, yy, -1);
-			raydir.normalize();
-			image[index] = trace(Vec3f(0), raydir, spheres, 0, size);
-		}
+		frameRows[y] = rows + (size_t)(y - startY) * config.width;
+		frameIds[y] = ids + (size_t)(y - startY) * config.width;
 	}
 }
 
-void RenderSector(const unsigned int& startX, const unsigned int& startY, const unsigned int& endX, const unsigned int& endY, const float& invWidth, const float& invHeight, const float& aspectratio, const Sphere* spheres, Vec3f* image, const int& size, const float& angle)
+//Supersamples the edge pixels on rows startY to endY. edges is the frame's sorted list from FindEdges, rows
+//starts at row rowsY of the frame
+void SupersampleRows(const RenderConfig& config, const Scene& scene, const std::vector<int>& edges, const unsigned int& startY, const unsigned int& endY, const unsigned int& rowsY, Vec3f* rows)
 {
+	auto first = std::lower_bound(edges.begin(), edges.end(), (int)(startY * config.width));
+	auto last = std::lower_bound(first, edges.end(), (int)(endY * config.width));
+	SupersamplePixels(config, scene, rowsY, rows, edges.data() + (first - edges.begin()), (unsigned)(last - first));
+}
 
-#ifdef _WIN32
-#ifdef MULTIPLE_CONTAINERS
-#ifdef USE_PARALLEL_FOR
-	MultiContainerParallel(startY, endY, image, spheres, size, startX, endX, invWidth, invHeight, aspectratio, angle);
-#else
-	MultiContainerNonParallel(startY, endY, startX, endX, invWidth, angle, aspectratio, invHeight, image, spheres, size);
-#endif
-#else
-#ifdef USE_PARALLEL_FOR
-	SingularContainerParallel(startY, endY, image, spheres, size, startX, endX, invWidth, invHeight, aspectratio, angle);
-#else
-	SingularContainerNonParallel(endX, startY, startX, endY, invWidth, angle, aspectratio, invHeight, image, spheres, size);
-#endif
-#endif
-#else
-#ifdef MULTIPLE_CONTAINERS
-	MultiContainerNonParallel(startY, endY, startX, endX, invWidth, angle, aspectratio, invHeight, image, spheres, size);
-#else
-	SingularContainerNonParallel(endX, startY, startX, endY, invWidth, angle, aspectratio, invHeight, image, spheres, size);
-#endif
-#endif // _WIN32
+//trace compiled for each math mode and feature set, for SelectKernel
+struct TraceKernel {
+	typedef TraceFunction Pointer;
+	template<MathMode mode, int features>
+	static Pointer Get() { return trace<mode, features>; }
+};
+
+//trace compiled for the config's math mode and the scene's features, for the loops that call it through a
+//pointer. These do not record temporal history
+TraceFunction GetTraceFunction(const RenderConfig& config, const Scene& scene)
+{
+	return SelectKernel<TraceKernel>(config.mathMode, FindTraceFeatures(config, scene) & ~TRACE_HISTORY);
 }
 
 
-#ifdef MULTIPLE_CONTAINERS 
-void WriteSector(Vec3f* chunk, int size, char* charArray) {
-	int charIndex = 0;
-	for (unsigned i = 0; i < size; ++i) {
+//Converts a chunk from its own container
+void WriteSector(Vec3f* chunk, size_t size, char* charArray) {
+	size_t charIndex = 0;
+	for (size_t i = 0; i < size; ++i) {
 		charArray[charIndex] =		(unsigned char)((1.0f < chunk[i].x ? 1.0f : chunk[i].x) * 255);
 		charArray[charIndex + 1] = (unsigned char)((1.0f < chunk[i].y ? 1.0f : chunk[i].y) * 255);
 		charArray[charIndex + 2] = (unsigned char)((1.0f < chunk[i].z ? 1.0f : chunk[i].z) * 255);
 		charIndex += 3;
 	}
 }
-#else 
-void WriteSector(Vec3f* chunk, int size, char* charArray, int startingIndex, int charStartIndex) {
-	int charIndex = charStartIndex;
-	for (unsigned i = startingIndex; i < startingIndex + size; ++i) {
+//Converts part of a singular container
+void WriteSector(Vec3f* chunk, size_t size, char* charArray, size_t startingIndex, size_t charStartIndex) {
+	size_t charIndex = charStartIndex;
+	for (size_t i = startingIndex; i < startingIndex + size; ++i) {
 		charArray[charIndex] =		(unsigned char)((1.0f < chunk[i].x ? 1.0f : chunk[i].x) * 255);
 		charArray[charIndex + 1] = (unsigned char)((1.0f < chunk[i].y ? 1.0f : chunk[i].y) * 255);
 		charArray[charIndex + 2] = (unsigned char)((1.0f < chunk[i].z ? 1.0f : chunk[i].z) * 255);
 		charIndex += 3;
 	}
 }
-#endif
+
+//Converts a worker's bands. Multiple containers hold them one after another, a singular container is indexed by
+//position in the frame
+void WriteChunks(const RenderConfig& config, const std::vector<Chunk>& chunks, Vec3f* image, char* charArray)
+{
+	if (config.containerMode == CONTAINERS_MULTIPLE) {
+		size_t pixelCount = 0;
+		for (const Chunk& chunk : chunks) pixelCount += (size_t)chunk.GetRowCount() * config.width;
+		WriteSector(image, pixelCount, charArray);
+	}
+	else {
+		for (const Chunk& chunk : chunks) {
+			size_t startingIndex = (size_t)chunk.startY * config.width;
+			WriteSector(image, (size_t)chunk.GetRowCount() * config.width, charArray, startingIndex, startingIndex * 3);
+		}
+	}
+}
+
+//Allocates a frame buffer with the allocator selected in the config
+void* AllocateBuffer(const RenderConfig& config, MemoryPool* pool, const char* heapName, size_t bytes)
+{
+	switch (config.allocatorMode) {
+	case ALLOCATOR_POOLS:
+		return pool->Alloc(bytes);
+	case ALLOCATOR_HEAPS:
+		return ::operator new[](bytes, HeapManager::GetHeap(heapName));
+	default:
+		return ::operator new[](bytes);
+	}
+}
+
+void FreeBuffer(const RenderConfig& config, MemoryPool* pool, void* buffer)
+{
+	if (config.allocatorMode == ALLOCATOR_POOLS) pool->Free(buffer);
+	else ::operator delete[](buffer);
+}
+
+//Rows of rowBytes each that fit in the heap's budget, keeping reserve bytes free. UINT_MAX if it has no budget
+unsigned RowsInBudget(const Heap& heap, size_t rowBytes, long long reserve)
+{
+	if (heap.GetBudget() == 0) return UINT_MAX;
+
+	long long available = heap.GetAvailable() - reserve;
+	if (available <= 0) return 0;
+	return (unsigned)std::min((long long)UINT_MAX - 1, available / (long long)rowBytes);
+}
+
+//Default heap bytes of each pixel the anti aliasing works on: its primary hit id and its edge list entry
+#define AA_BYTES_PER_PIXEL (sizeof(int) * 2)
+
+//Default heap bytes a frame needs besides the buffers BudgetRows sizes: the per worker arrays of Render and
+//FRAME_BUDGET_RESERVE for its strings, tasks and scene state. The edge search adds its row tables and the
+//scores of a row of tiles, and the pools leave the anti aliasing ids and edge list on the default heap for
+//every row the workers have at once
+long long FrameOverhead(const RenderConfig& config)
+{
+	long long bytes = FRAME_BUDGET_RESERVE + (long long)config.threadCount * (sizeof(PerfSample) * 2 + sizeof(void*) * 3);
+	if (config.adaptiveAA) bytes += (long long)config.height * sizeof(void*) * 2 + (long long)AA_TILE_SIZE * config.width * sizeof(float);
+	if (config.allocatorMode == ALLOCATOR_POOLS && config.adaptiveAA) {
+		const long long rows = config.containerMode == CONTAINERS_MULTIPLE ? (long long)config.threadCount * config.chunkHeight : config.height;
+		bytes += rows * config.width * AA_BYTES_PER_PIXEL;
+	}
+	return bytes;
+}
+
+//Most rows of the frame that can have buffers at once within the heap budgets. Pools are made at startup so
+//they always fit. The id buffer and the edge search of the anti aliasing come from the default heap
+unsigned BudgetRows(const RenderConfig& config)
+{
+	if (config.allocatorMode == ALLOCATOR_POOLS) return UINT_MAX;
+
+	const Heap& defaultHeap = HeapManager::GetDefaultHeap();
+	const size_t idBytes = config.adaptiveAA ? AA_BYTES_PER_PIXEL : 0;
+	if (config.allocatorMode == ALLOCATOR_NEW) {
+		return RowsInBudget(defaultHeap, config.width * (sizeof(Vec3f) + 3 + idBytes), FrameOverhead(config));
+	}
+
+	unsigned rows = std::min(RowsInBudget(*HeapManager::GetHeap("ChunkHeap"), config.width * sizeof(Vec3f), 0),
+		RowsInBudget(*HeapManager::GetHeap("CharHeap"), config.width * 3, 0));
+	if (idBytes > 0) rows = std::min(rows, RowsInBudget(defaultHeap, config.width * idBytes, FrameOverhead(config)));
+	return rows;
+}
+
+//Reports a frame that ran out of heap budget part way through, it is not written
+bool SkipFrame(const int& iteration)
+{
+	std::cout << "[ERROR: main.cpp: frame " << iteration << " does not fit in the heap budgets, skipping it" << std::endl;
+	return false;
+}
+
+//Traces the pixels of row y that are new at this step, the ones on the grid of the previous pass are already done
+void TraceProgressiveRow(const RenderConfig& config, const Scene& scene, TraceFunction trace, const unsigned int& y, const unsigned int& step, Vec3f* image, int* ids, unsigned char* traced)
+{
+	const unsigned previous = step * 2;
+	const bool onPreviousRow = step < PROGRESSIVE_FIRST_STEP && y % previous == 0;
+	const RowRays rays(config, y);
+	for (unsigned x = 0; x < config.width; x += step) {
+		if (onPreviousRow && x % previous == 0) continue;
+		//Same ray as the full resolution loops, so a pass that completes gives exactly their pixels
+		Vec3f raydir;
+		if (rayTable != nullptr) {
+			raydir = rayTable->GetDirection(x, y);
+		}
+		else {
+			raydir = rays.Direction(x);
+			Normalize(config.mathMode, raydir);
+		}
+		unsigned index = y * config.width + x;
+		image[index] = trace(Vec3f(0), raydir, scene, 0, config.rayLimits, 1.0f);
+		ids[index] = primaryHitId;
+		traced[index] = 1;
+	}
+}
+
+//The numbers 0 to count - 1 in bit reversed order, 0, half, a quarter, three quarters... Any first part of the
+//list is spread evenly over the whole range
+std::vector<unsigned> SpreadOrder(const unsigned& count)
+{
+	unsigned bits = 0;
+	while ((1u << bits) < count) bits++;
+
+	std::vector<unsigned> order;
+	order.reserve(count);
+	for (unsigned i = 0; i < (1u << bits); ++i) {
+		unsigned reversed = 0;
+		for (unsigned b = 0; b < bits; ++b) {
+			if (i & (1u << b)) reversed |= 1u << (bits - 1 - b);
+		}
+		if (reversed < count) order.push_back(reversed);
+	}
+	return order;
+}
+
+//Pixels that were not reached take the sample at the corner of their block on the finest grid that has one
+void FillProgressiveGaps(const RenderConfig& config, Vec3f* image, const unsigned char* traced)
+{
+	for (unsigned y = 0; y < config.height; ++y) {
+		for (unsigned x = 0; x < config.width; ++x) {
+			unsigned index = y * config.width + x;
+			if (traced[index]) continue;
+			for (unsigned step = 2; step <= PROGRESSIVE_FIRST_STEP; step *= 2) {
+				unsigned source = (y - y % step) * config.width + (x - x % step);
+				if (traced[source]) {
+					image[index] = image[source];
+					break;
+				}
+			}
+		}
+	}
+}
+
+//[comment]
+// Preview rendering. The frame is traced in passes, one sample per 4x4 block, then per 2x2 block, then every
+// pixel, then the anti aliasing samples if they are enabled. A pass is finished before the next starts. Its rows
+// (or edge pixel blocks) are taken from one shared list in SpreadOrder, so whichever worker gets to them and in
+// whatever order the workers run, the part of a pass done when the time budget runs out is spread evenly down
+// the frame rather than being a band at the top. On linux the workers are vfork children that run one after
+// another, so the first worker can take the whole list. The first pass always completes so there is always a
+// whole image to write.
+//[/comment]
+bool RenderProgressive(const RenderConfig& config, const Scene& scene, const int& iteration, char* frameBytes)
+{
+	Timer frameTimer;
+	Timer* budgetTimer = &frameTimer;
+	const float budget = config.progressiveBudget;
+	const unsigned threadCount = config.threadCount;
+	const unsigned pixelCount = config.width * config.height;
+	TraceFunction trace = GetTraceFunction(config, scene);
+
+	//The frame is traced into one buffer so the passes can fill it in any order
+	Vec3f* image = new Vec3f[pixelCount];
+	int* ids = new int[pixelCount];
+	unsigned char* traced = new unsigned char[pixelCount]();
+	//Rows or pixels finished by each worker, tells us whether the pass completed
+	unsigned* workDone = new unsigned[threadCount];
+	//Next entry of the pass's SpreadOrder list to hand out
+	std::atomic<unsigned> nextWork;
+	std::atomic<unsigned>* next = &nextWork;
+
+	int passCount = config.adaptiveAA ? 4 : 3;
+	int passesDone = 0;
+	bool outOfTime = false;
+	bool outOfMemory = false;
+	for (unsigned step = PROGRESSIVE_FIRST_STEP; step >= 1 && !outOfTime && !outOfMemory; step /= 2) {
+		const bool firstPass = step == PROGRESSIVE_FIRST_STEP;
+		const unsigned rowCount = (config.height + step - 1) / step;
+		const std::vector<unsigned> rowOrder = SpreadOrder(rowCount);
+		const unsigned* rows = rowOrder.data();
+		nextWork = 0;
+		for (unsigned i = 0; i < threadCount; ++i) {
+			workDone[i] = 0;
+			ThreadManager::CreateTask([config, &scene, trace, image, ids, traced, workDone, budgetTimer, budget, step, rowCount, firstPass, rows, next, i]
+				{
+					for (unsigned n = (*next)++; n < rowCount; n = (*next)++) {
+						if (!firstPass && budgetTimer->Peek() > budget) return;
+						TraceProgressiveRow(config, scene, trace, rows[n] * step, step, image, ids, traced);
+						workDone[i]++;
+					}
+				});
+		}
+		outOfMemory = !ThreadManager::WaitForAllThreads();
+
+		unsigned rowsDone = 0;
+		for (unsigned i = 0; i < threadCount; ++i) rowsDone += workDone[i];
+		if (rowsDone < rowCount) outOfTime = true;
+		else passesDone++;
+	}
+
+	//Edges can only be found once every pixel has its own sample
+	if (!outOfTime && !outOfMemory && config.adaptiveAA) {
+		std::vector<const Vec3f*> frameRows(config.height);
+		std::vector<const int*> frameIds(config.height);
+		PointRows(config, image, ids, 0, config.height, frameRows, frameIds);
+		std::vector<int> pixels;
+		AntiAliasing::FindEdges(config, frameRows.data(), frameIds.data(), 0, config.height, pixels);
+		const int* edgePixels = pixels.data();
+		const unsigned edgeCount = (unsigned)pixels.size();
+		const unsigned blockCount = (edgeCount + PROGRESSIVE_AA_BLOCK - 1) / PROGRESSIVE_AA_BLOCK;
+		const std::vector<unsigned> blockOrder = SpreadOrder(blockCount);
+		const unsigned* blocks = blockOrder.data();
+		nextWork = 0;
+
+		for (unsigned i = 0; i < threadCount; ++i) {
+			workDone[i] = 0;
+			ThreadManager::CreateTask([config, &scene, image, edgePixels, edgeCount, workDone, budgetTimer, budget, blockCount, blocks, next, i]
+				{
+					for (unsigned n = (*next)++; n < blockCount; n = (*next)++) {
+						if (budgetTimer->Peek() > budget) return;
+						unsigned begin = blocks[n] * PROGRESSIVE_AA_BLOCK;
+						unsigned count = std::min((unsigned)PROGRESSIVE_AA_BLOCK, edgeCount - begin);
+						SupersamplePixels(config, scene, 0, image, edgePixels + begin, count);
+						workDone[i] += count;
+					}
+				});
+		}
+		outOfMemory = !ThreadManager::WaitForAllThreads();
+
+		unsigned pixelsDone = 0;
+		for (unsigned i = 0; i < threadCount; ++i) pixelsDone += workDone[i];
+		if (pixelsDone == edgeCount) passesDone++;
+	}
+
+	if (outOfMemory) {
+		delete[] workDone;
+		delete[] traced;
+		delete[] ids;
+		delete[] image;
+		return false;
+	}
+
+	FillProgressiveGaps(config, image, traced);
+	float traceTime = frameTimer.Peek();
+
+	std::string line = FrameHeader(config);
+	char* charArray = frameBytes != nullptr ? frameBytes + line.length() : new char[pixelCount * 3];
+	WriteSector(image, pixelCount, charArray);
+	if (frameBytes != nullptr) {
+		memcpy(frameBytes, line.c_str(), line.length());
+	}
+	else {
+		std::ofstream ofs(FrameFileName(iteration), std::ios::out | std::ios::binary);
+		ofs.write(line.c_str(), line.length());
+		ofs.write(charArray, (size_t)pixelCount * 3);
+		ofs.close();
+		delete[] charArray;
+	}
+
+	std::cout << "Progressive frame " << iteration << ": " << passesDone << " of " << passCount << " passes in " << traceTime * 1000.0f << " ms" << std::endl;
+
+	delete[] workDone;
+	delete[] traced;
+	delete[] ids;
+	delete[] image;
+	return true;
+}
+
+//[comment]
+// Render for frames whose buffers do not fit in the heap budgets. The frame is cut into bands of bandRows rows
+// that are rendered one after another through one set of buffers, and each band is shared between the workers.
+// A band with fewer rows than there are workers leaves some of them idle, so a tight budget also means fewer
+// workers rendering at once. With anti aliasing each band also traces the row either side of it so the edge
+// search has the same neighbours as a whole frame, and is a whole number of rows of tiles where the budget
+// allows. The pixels are then the same as a normal render. Only bands shorter than a tile split the tiles'
+// supersampling budget, and can pick other edges.
+//[/comment]
+bool RenderBanded(const RenderConfig& config, const Scene& scene, const int& iteration, char* frameBytes, const unsigned& bandRows)
+{
+	const unsigned threadCount = config.threadCount;
+	const size_t bandPixels = (size_t)bandRows * config.width;
+	Vec3f* image = (Vec3f*)AllocateBuffer(config, chunkPool, "ChunkHeap", bandPixels * sizeof(Vec3f));
+	char* charArray = (char*)AllocateBuffer(config, charPool, "CharHeap", bandPixels * 3);
+	int* ids = config.adaptiveAA ? new int[bandPixels] : nullptr;
+
+	//The loops index the band from its first row, the same as a worker's buffer with multiple containers
+	RenderConfig bandConfig = config;
+	bandConfig.containerMode = CONTAINERS_MULTIPLE;
+
+	if (temporalCache != nullptr) temporalCache->BeginFrame(scene);
+
+	std::string line = FrameHeader(config);
+	std::ofstream ofs;
+	if (frameBytes != nullptr) {
+		memcpy(frameBytes, line.c_str(), line.length());
+	}
+	else {
+		ofs.open(FrameFileName(iteration), std::ios::out | std::ios::binary);
+		ofs.write(line.c_str(), line.length());
+	}
+
+	//Rows each band writes, the buffers also hold the margin rows traced either side of it for the edge search
+	const unsigned margin = config.adaptiveAA && bandRows > 2 ? 1 : 0;
+	unsigned bandStep = bandRows - margin * 2;
+	if (margin > 0 && bandStep >= AA_TILE_SIZE) bandStep -= bandStep % AA_TILE_SIZE;
+	std::vector<const Vec3f*> frameRows(config.adaptiveAA ? config.height : 0);
+	std::vector<const int*> frameIds(config.adaptiveAA ? config.height : 0);
+	std::vector<int> edges;
+
+	bool complete = true;
+	for (unsigned bandStart = 0; bandStart < config.height && complete; bandStart += bandStep) {
+		const unsigned rowCount = std::min(bandStep, config.height - bandStart);
+		const unsigned traceStart = bandStart - std::min(bandStart, margin);
+		const unsigned traceEnd = std::min(config.height, bandStart + rowCount + margin);
+		const unsigned traceCount = traceEnd - traceStart;
+		for (unsigned i = 0; i < threadCount; ++i) {
+			const unsigned startY = traceStart + traceCount * i / threadCount;
+			const unsigned endY = traceStart + traceCount * (i + 1) / threadCount;
+			if (startY == endY) continue;
+
+			ThreadManager::CreateTask([bandConfig, &scene, image, charArray, ids, traceStart, startY, endY]
+				{
+					const size_t offset = (size_t)(startY - traceStart) * bandConfig.width;
+					int* sectorIds = ids != nullptr ? ids + offset : nullptr;
+					RenderSector(bandConfig, 0, startY, bandConfig.width, endY, scene, image + offset, sectorIds);
+					//With anti aliasing the rows are written once the edges are supersampled
+					if (!bandConfig.adaptiveAA) WriteSector(image + offset, (size_t)(endY - startY) * bandConfig.width, charArray + offset * 3);
+				});
+		}
+		complete = ThreadManager::WaitForAllThreads();
+		if (!complete) break;
+
+		if (config.adaptiveAA) {
+			//The edge search reads the rows of the other workers, so it waits for every row of the band
+			std::fill(frameRows.begin(), frameRows.end(), nullptr);
+			std::fill(frameIds.begin(), frameIds.end(), nullptr);
+			PointRows(config, image, ids, traceStart, traceEnd, frameRows, frameIds);
+			AntiAliasing::FindEdges(config, frameRows.data(), frameIds.data(), bandStart, bandStart + rowCount, edges);
+			const std::vector<int>* bandEdges = &edges;
+
+			for (unsigned i = 0; i < threadCount; ++i) {
+				const unsigned startY = bandStart + rowCount * i / threadCount;
+				const unsigned endY = bandStart + rowCount * (i + 1) / threadCount;
+				if (startY == endY) continue;
+
+				ThreadManager::CreateTask([bandConfig, &scene, image, charArray, bandEdges, traceStart, startY, endY]
+					{
+						const size_t offset = (size_t)(startY - traceStart) * bandConfig.width;
+						SupersampleRows(bandConfig, scene, *bandEdges, startY, endY, traceStart, image);
+						WriteSector(image + offset, (size_t)(endY - startY) * bandConfig.width, charArray + offset * 3);
+					});
+			}
+			complete = ThreadManager::WaitForAllThreads();
+			if (!complete) break;
+		}
+
+		//Bands finish in order so the file is written straight through
+		const size_t bytes = (size_t)rowCount * config.width * 3;
+		const char* bandChars = charArray + (size_t)(bandStart - traceStart) * config.width * 3;
+		if (frameBytes != nullptr) memcpy(frameBytes + line.length() + (size_t)bandStart * config.width * 3, bandChars, bytes);
+		else ofs.write(bandChars, bytes);
+	}
+
+	if (temporalCache != nullptr) {
+		if (complete) temporalCache->EndFrame(scene);
+		else temporalCache->DiscardFrame();
+	}
+	if (ofs.is_open()) ofs.close();
+	//The bands written so far would pass for a frame file
+	if (!complete && frameBytes == nullptr) remove(FrameFileName(iteration).c_str());
+
+	delete[] ids;
+	FreeBuffer(config, charPool, charArray);
+	FreeBuffer(config, chunkPool, image);
+	return complete;
+}
 
 //[comment]
 // Main rendering function. We compute a camera ray for each pixel of the image
 // trace it and return a color. If the ray hits a sphere, we return the color of the
 // sphere at the intersection point, else we return the background color.
+// The frame is written to its frame file, or encoded into frameBytes (FrameByteCount bytes) when it is given.
+// Returns false if not even one row of the frame fits in the heap budgets, or a worker ran out of memory part
+// way through, the frame is then not written.
 //[/comment]
-void Render(const RenderConfig& config, const Sphere* spheres, const int& iteration, const int& size)
-{
-#ifdef MULTIPLE_CONTAINERS
-	Vec3f** chunkArrs = new Vec3f * [MAX_THREADS];
-	char** charArrs = new char* [MAX_THREADS];
-	RenderConfig* renderConfigs = new RenderConfig[MAX_THREADS];
-	for (int i = 0; i < MAX_THREADS; ++i) {
-		renderConfigs[i] = std::ref(config);
-#ifdef USE_MEMORY_POOLS
-		chunkArrs[i] = (Vec3f*)chunkPool->Alloc(config.vec3Size);
-		charArrs[i] = (char*)charPool->Alloc(config.charSize);
-#else
-		chunkArrs[i] = new Vec3f[config.chunkSize];
-		charArrs[i] = new char[config.charSize];
-#endif
+bool RenderFrame(const RenderConfig& config, const Scene& scene, const int& iteration, char* frameBytes)
+{
+	if (screenTiles != nullptr && scene.screenTiles == nullptr) {
+		//The tiles are binned from this frame's spheres, trace finds them through a copy of the scene
+		screenTiles->Build(scene);
+		Scene tiledScene = scene;
+		tiledScene.screenTiles = screenTiles;
+		return RenderFrame(config, tiledScene, iteration, frameBytes);
+	}
+
+	//Only the benchmarks change the camera or math mode part way through a run
+	if (rayTable != nullptr && !rayTable->Matches(config)) {
+		delete rayTable;
+		rayTable = new RayTable(config);
+	}
+
+	const bool multiple = config.containerMode == CONTAINERS_MULTIPLE;
+	const unsigned threadCount = config.threadCount;
+
+	//The progressive preview keeps the whole frame, its ids and the traced flags on the default heap
+	const size_t progressiveRowBytes = config.width * (sizeof(Vec3f) + AA_BYTES_PER_PIXEL + 1 + 3);
+	const bool progressive = config.progressiveBudget > 0.0f;
+	if (progressive && RowsInBudget(HeapManager::GetDefaultHeap(), progressiveRowBytes, FrameOverhead(config)) < config.height) {
+		std::cout << "[WARNING: main.cpp: the progressive preview of frame " << iteration << " does not fit the DefaultHeap budget, rendering it in full instead" << std::endl;
+	}
+	else if (progressive) {
+		HeapTelemetry::BeginFrame();
+		const bool complete = RenderProgressive(config, scene, iteration, frameBytes);
+		HeapTelemetry::EndFrame(iteration);
+		return complete || SkipFrame(iteration);
+	}
+
+	//Rows the buffers are sized for: a chunk for every worker, or the whole frame for the singular container
+	const unsigned plannedRows = multiple ? threadCount * config.chunkHeight : config.height;
+	const unsigned budgetRows = BudgetRows(config);
+	if (budgetRows < plannedRows) {
+		const unsigned bandRows = std::min(budgetRows, config.height);
+		if (bandRows == 0) return SkipFrame(iteration);
+
+		//Only reported when the band size changes, the budget is usually tight for every frame of a render
+		static unsigned lastBandRows = 0;
+		if (bandRows != lastBandRows) {
+			std::cout << "[WARNING: main.cpp: the frame buffers do not fit in the heap budgets, rendering in bands of " << bandRows << " rows" << std::endl;
+			lastBandRows = bandRows;
+		}
+
+		HeapTelemetry::BeginFrame();
+		const bool complete = RenderBanded(config, scene, iteration, frameBytes, bandRows);
+		HeapTelemetry::EndFrame(iteration);
+		return complete || SkipFrame(iteration);
 	}
 
-	int startY = 0;
-	int endY = config.chunkHeight;
-	for (int i = 0; i < MAX_THREADS; ++i) {
-		Vec3f* currentChunk = chunkArrs[i];
-		char* currentArr = charArrs[i];
-		RenderConfig config = renderConfigs[i];
-		ThreadManager::CreateTask([config, currentChunk, &spheres, &size, startY, endY, currentArr] 
+	HeapTelemetry::BeginFrame();
+	if (temporalCache != nullptr) temporalCache->BeginFrame(scene);
+
+	//The render counters follow the forked workers, the per worker samples are summed for the report
+	PerfCounters renderCounters(true, config.usePerfCounters);
+	PerfSample* traceSamples = new PerfSample[threadCount];
+	PerfSample* writeSamples = new PerfSample[threadCount];
+	renderCounters.Start();
+
+	//Multiple containers give each worker its own buffers, a singular container is shared by all of them
+	const unsigned bufferCount = multiple ? threadCount : 1;
+	const size_t vec3Bytes = multiple ? config.vec3Size : config.singularChunkSize * sizeof(Vec3f);
+	const size_t charBytes = multiple ? config.charSize : config.singularCharSize;
+	Vec3f** chunkArrs = new Vec3f * [bufferCount];
+	char** charArrs = new char* [bufferCount];
+	//Primary hit of every pixel for the anti aliasing, laid out the same as the chunk buffers
+	int** idArrs = new int* [bufferCount];
+	for (unsigned i = 0; i < bufferCount; ++i) {
+		chunkArrs[i] = (Vec3f*)AllocateBuffer(config, chunkPool, "ChunkHeap", vec3Bytes);
+		charArrs[i] = (char*)AllocateBuffer(config, charPool, "CharHeap", charBytes);
+		idArrs[i] = config.adaptiveAA ? new int[vec3Bytes / sizeof(Vec3f)] : nullptr;
+	}
+
+	chunkPlanner->Plan();
+	ChunkPlanner* planner = chunkPlanner;
+
+	for (unsigned i = 0; i < threadCount; ++i) {
+		Vec3f* image = chunkArrs[multiple ? i : 0];
+		char* charArray = charArrs[multiple ? i : 0];
+		int* ids = idArrs[multiple ? i : 0];
+		ThreadManager::CreateTask([config, image, charArray, ids, &scene, i, multiple, planner, traceSamples, writeSamples]
 			{
-				RenderSector(0, startY, config.width, endY, config.invWidth, config.invHeight, config.aspectRatio, spheres, currentChunk, size, config.angle);
-				WriteSector(currentChunk, config.chunkSize, currentArr);
+				const std::vector<Chunk>& chunks = planner->GetChunks(i);
+
+				//Counters are opened inside the task so they are attached to the worker
+				PerfCounters counters(false, config.usePerfCounters);
+				counters.Start();
+				//Multiple containers hold the worker's bands one after another. The singular container is indexed
+				//by position in the frame so the loops are given the start of the frame instead of the band
+				size_t chunkOffset = 0;
+				const bool timeRows = planner->IsMeasuring() && !config.useParallelFor;
+				for (const Chunk& chunk : chunks) {
+					if (!multiple) chunkOffset = (size_t)chunk.startY * config.width;
+					Vec3f* sectorImage = multiple ? image + chunkOffset : image;
+					int* sectorIds = ids != nullptr && multiple ? ids + chunkOffset : ids;
+
+					Timer chunkTimer;
+					if (timeRows) {
+						//Rendering a row at a time lets the planner see where the cost of the frame is
+						for (unsigned y = chunk.startY; y < chunk.endY; ++y) {
+							size_t row = multiple ? (size_t)(y - chunk.startY) * config.width : 0;
+							RenderSector(config, 0, y, config.width, y + 1, scene, sectorImage + row, sectorIds != nullptr ? sectorIds + row : nullptr);
+							planner->RecordRowTime(y, chunkTimer.Mark());
+						}
+					}
+					else {
+						RenderSector(config, 0, chunk.startY, config.width, chunk.endY, scene, sectorImage, sectorIds);
+					}
+
+					if (planner->IsMeasuring() && !timeRows) planner->RecordChunkTime(chunk, chunkTimer.Mark());
+
+					if (multiple) chunkOffset += (size_t)chunk.GetRowCount() * config.width;
+				}
+				traceSamples[i] = counters.Stop();
+
+				//With anti aliasing the rows are written once the edges are supersampled
+				if (config.adaptiveAA) return;
+				counters.Start();
+				WriteChunks(config, chunks, image, charArray);
+				writeSamples[i] = counters.Stop();
 			});
-		startY += config.chunkHeight;
-		endY += config.chunkHeight;
+	}
+	bool complete = ThreadManager::WaitForAllThreads();
+
+	//The edge search compares rows on either side of the workers' bands and shares the supersampling budget over
+	//fixed tiles of the frame, so it waits for every row and the edges do not depend on the plan. The extra samples
+	//are not added to the row times
+	std::vector<int> edges;
+	if (complete && config.adaptiveAA) {
+		std::vector<const Vec3f*> frameRows(config.height);
+		std::vector<const int*> frameIds(config.height);
+		for (unsigned i = 0; i < threadCount; ++i) {
+			size_t chunkOffset = 0;
+			for (const Chunk& chunk : planner->GetChunks(i)) {
+				if (!multiple) chunkOffset = (size_t)chunk.startY * config.width;
+				PointRows(config, chunkArrs[multiple ? i : 0] + chunkOffset, idArrs[multiple ? i : 0] + chunkOffset, chunk.startY, chunk.endY, frameRows, frameIds);
+				if (multiple) chunkOffset += (size_t)chunk.GetRowCount() * config.width;
+			}
+		}
+		AntiAliasing::FindEdges(config, frameRows.data(), frameIds.data(), 0, config.height, edges);
+		const std::vector<int>* frameEdges = &edges;
+
+		for (unsigned i = 0; i < threadCount; ++i) {
+			Vec3f* image = chunkArrs[multiple ? i : 0];
+			char* charArray = charArrs[multiple ? i : 0];
+			ThreadManager::CreateTask([config, image, charArray, &scene, i, multiple, planner, frameEdges, traceSamples, writeSamples]
+				{
+					const std::vector<Chunk>& chunks = planner->GetChunks(i);
+					PerfCounters counters(false, config.usePerfCounters);
+					counters.Start();
+					size_t chunkOffset = 0;
+					for (const Chunk& chunk : chunks) {
+						if (!multiple) chunkOffset = (size_t)chunk.startY * config.width;
+						SupersampleRows(config, scene, *frameEdges, chunk.startY, chunk.endY, chunk.startY, image + chunkOffset);
+						if (multiple) chunkOffset += (size_t)chunk.GetRowCount() * config.width;
+					}
+					traceSamples[i].Accumulate(counters.Stop());
+
+					counters.Start();
+					WriteChunks(config, chunks, image, charArray);
+					writeSamples[i] = counters.Stop();
+				});
+		}
+		complete = ThreadManager::WaitForAllThreads();
 	}
 
-	std::string name = "./spheres" + std::to_string(iteration) + ".ppm";
-	std::ofstream ofs(name, std::ios::out | std::ios::binary);
-	std::string line = "P6\n" + std::to_string(config.width) + " " + std::to_string(config.height) + "\n255\n";
-	ofs.write(line.c_str(), line.length());
+	std::string name = FrameFileName(iteration);
+	std::string line = FrameHeader(config);
+	std::ofstream ofs;
 
-	ThreadManager::WaitForAllThreads();
-	for (int i = 0; i < MAX_THREADS; ++i) {
-		ofs.write(charArrs[i], config.charSize);
-#ifdef USE_MEMORY_POOLS
-		chunkPool->Free(chunkArrs[i]);
-		charPool->Free(charArrs[i]);
-#else
-		delete[] chunkArrs[i];
-		delete[] charArrs[i];
-		charArrs[i] = nullptr;
-		charArrs[i] = nullptr;
-#endif // USE_MEMORY_POOLS
+	//A worker that ran out of memory left its rows unfinished, the frame is then not written
+	if (temporalCache != nullptr) {
+		if (complete) temporalCache->EndFrame(scene);
+		else temporalCache->DiscardFrame();
+	}
+	if (complete) {
+		if (frameBytes != nullptr) {
+			memcpy(frameBytes, line.c_str(), line.length());
+		}
+		else {
+			ofs.open(name, std::ios::out | std::ios::binary);
+			ofs.write(line.c_str(), line.length());
+		}
+
+		if (multiple) {
+			//A worker's bands are not always next to each other in the frame, each one is written to its own place
+			for (unsigned i = 0; i < bufferCount; ++i) {
+				const char* chunkChars = charArrs[i];
+				for (const Chunk& chunk : chunkPlanner->GetChunks(i)) {
+					size_t bytes = (size_t)chunk.GetRowCount() * config.width * 3;
+					size_t offset = line.length() + (size_t)chunk.startY * config.width * 3;
+					if (frameBytes != nullptr) {
+						memcpy(frameBytes + offset, chunkChars, bytes);
+					}
+					else {
+						ofs.seekp(offset);
+						ofs.write(chunkChars, bytes);
+					}
+					chunkChars += bytes;
+				}
+			}
+		}
+		else if (frameBytes != nullptr) {
+			memcpy(frameBytes + line.length(), charArrs[0], charBytes);
+		}
+		else {
+			ofs.write(charArrs[0], charBytes);
+		}
+	}
 
-		
+	for (unsigned i = 0; i < bufferCount; ++i) {
+		FreeBuffer(config, chunkPool, chunkArrs[i]);
+		FreeBuffer(config, charPool, charArrs[i]);
+		delete[] idArrs[i];
+		chunkArrs[i] = nullptr;
+		charArrs[i] = nullptr;
+		idArrs[i] = nullptr;
 	}
 
-	ofs.close();
+	if (ofs.is_open()) ofs.close();
 
 	delete[] charArrs;
 	delete[] chunkArrs;
-	delete[] renderConfigs;
+	delete[] idArrs;
 
 	charArrs = nullptr;
 	chunkArrs = nullptr;
-	renderConfigs = nullptr;
+	idArrs = nullptr;
 
 	name.clear();
 	line.clear();
-#else
-#ifdef USE_MEMORY_POOLS
-	Vec3f* image = (Vec3f*)chunkPool->Alloc(config.chunkSize * MAX_THREADS);
-	char* charArray = (char*)charPool->Alloc(config.charSize * MAX_THREADS);
-#else
-	Heap* chunkHeap = HeapManager::GetHeap("ChunkHeap");
-	Heap* charHeap = HeapManager::GetHeap("CharHeap");
-	Vec3f* image = ::new(chunkHeap) Vec3f[config.singularChunkSize];
-	char* charArray = ::new(charHeap) char[config.singularCharSize];
-#endif	
-
-	int startY = 0;
-	int endY = config.chunkHeight;
-	for (int i = 0; i < MAX_THREADS; ++i) {
-		ThreadManager::CreateTask([config, image, &spheres, &size, startY, endY, charArray, i] 
-			{
-				RenderSector(0, startY, config.width, endY, config.invWidth, config.invHeight, config.aspectRatio, spheres, image, size, config.angle); 
-				int startingIndex = (config.width * config.chunkHeight) * i;
-				int charStartIndex = config.width * (config.chunkHeight * 3) * i;
-				WriteSector(image, config.chunkSize, charArray, startingIndex, charStartIndex);
-			});
-		startY += config.chunkHeight;
-		endY += config.chunkHeight;
-	}
-	std::string name = "./spheres" + std::to_string(iteration) + ".ppm";
-	std::ofstream ofs(name, std::ios::out | std::ios::binary);
-	std::string line = "P6\n" + std::to_string(config.width) + " " + std::to_string(config.height) + "\n255\n";
-	ofs.write(line.c_str(), line.length());
 
-	ThreadManager::WaitForAllThreads();
+	if (config.usePerfCounters) {
+		PerfSample renderSample = renderCounters.Stop();
+		PerfSample traceTotal;
+		PerfSample writeTotal;
+		for (unsigned i = 0; i < threadCount; ++i) {
+			traceTotal.Accumulate(traceSamples[i]);
+			writeTotal.Accumulate(writeSamples[i]);
+		}
 
-	ofs.write(charArray, config.charSize * MAX_THREADS);
-	
-#ifdef USE_MEMORY_POOLS
-	chunkPool->Free(image);
-	charPool->Free(charArray);
-#else
-	delete[] image;
-	image = nullptr;
-	delete[] charArray;
-	charArray = nullptr;
-#endif
+		PerfCounters::PrintHeader(iteration);
+		PerfCounters::PrintSample("Render", renderSample);
+		PerfCounters::PrintSample("Trace", traceTotal);
+		PerfCounters::PrintSample("Write", writeTotal);
+	}
 
-	ofs.close();
+	delete[] traceSamples;
+	delete[] writeSamples;
+	HeapTelemetry::EndFrame(iteration);
+	return complete || SkipFrame(iteration);
+}
 
-	name.clear();
-	line.clear();
-#endif // MULTIPLE_CONTAINERS
+//Renders a frame with RenderFrame. The buffers are fitted to the heap budgets before the frame starts and the
+//rest of what a frame allocates was checked against the budget at startup, a std::bad_alloc the checks did not
+//foresee skips the frame rather than ending the render
+bool Render(const RenderConfig& config, const Scene& scene, const int& iteration, char* frameBytes = nullptr)
+{
+	try {
+		return RenderFrame(config, scene, iteration, frameBytes);
+	}
+	catch (const std::bad_alloc&) {
+		//Workers already started finish before the frame is given up
+		ThreadManager::WaitForAllThreads();
+		if (temporalCache != nullptr) temporalCache->DiscardFrame();
+		HeapTelemetry::EndFrame(iteration);
+		return SkipFrame(iteration);
+	}
+}
+
+//The demos share a floor plane and three spheres, spheres[0] is the one they animate
+void CreateDemoScene(Sphere* spheres, Plane* floor, Scene& scene)
+{
+	spheres[0] = Sphere(Vec3f(0.0, 0, -20), 4, Vec3f(1.00, 0.32, 0.36), 1, 0.5); // The radius paramter is the value we will change
+	spheres[1] = Sphere(Vec3f(5.0, -1, -15), 2, Vec3f(0.90, 0.76, 0.46), 1, 0.0);
+	spheres[2] = Sphere(Vec3f(5.0, 0, -25), 3, Vec3f(0.65, 0.77, 0.97), 1, 0.0);
+	//Sits where the top of the old radius 10000 ground sphere was
+	*floor = Plane(Vec3f(0.0, 1, 0), Vec3f(0.0, -4, -20), Vec3f(0.20, 0.20, 0.20), 0, 0.0);
+
+	scene.spheres = spheres;
+	scene.sphereCount = 3;
+	scene.planes = floor;
+	scene.planeCount = 1;
+	scene.FindLights();
 }
 
 void BasicRender(const RenderConfig& config)
 {
 	//Create dynamic array for spheres, more efficient than creating vector
-	Sphere* spheres = new Sphere[4];
-	spheres[0] = Sphere(Vec3f(0.0, -10004, -20), 10000, Vec3f(0.20, 0.20, 0.20), 0, 0.0);
-	spheres[1] = Sphere(Vec3f(0.0, 0, -20), 4, Vec3f(1.00, 0.32, 0.36), 1, 0.5); // The radius paramter is the value we will change
-	spheres[2] = Sphere(Vec3f(5.0, -1, -15), 2, Vec3f(0.90, 0.76, 0.46), 1, 0.0);
-	spheres[3] = Sphere(Vec3f(5.0, 0, -25), 3, Vec3f(0.65, 0.77, 0.97), 1, 0.0);
+	Sphere* spheres = new Sphere[3];
+	Plane* floor = new Plane();
+	Scene scene;
+	CreateDemoScene(spheres, floor, scene);
 
 	// This creates a file, titled 1.ppm in the current working directory
-	Render(config, spheres, 1, 4);
+	Render(config, scene, 1);
 
 	delete[] spheres;
 	spheres = nullptr;
+	delete floor;
+	floor = nullptr;
 
 }
 
 void SimpleShrinking(const RenderConfig& config)
 {
 	//Create dynamic array for spheres, more efficient than creating vector
-	Sphere* spheres = new Sphere[4];
-
-
-	spheres[0] = Sphere(Vec3f(0.0, -10004, -20), 10000, Vec3f(0.20, 0.20, 0.20), 0, 0.0);
-	spheres[1] = Sphere(Vec3f(0.0, 0, -20), 4, Vec3f(1.00, 0.32, 0.36), 1, 0.5); // The radius paramter is the value we will change
-	spheres[2] = Sphere(Vec3f(5.0, -1, -15), 2, Vec3f(0.90, 0.76, 0.46), 1, 0.0);
-	spheres[3] = Sphere(Vec3f(5.0, 0, -25), 3, Vec3f(0.65, 0.77, 0.97), 1, 0.0);
+	Sphere* spheres = new Sphere[3];
+	Plane* floor = new Plane();
+	Scene scene;
+	CreateDemoScene(spheres, floor, scene);
 
 	for (int i = 0; i < 4; ++i)
 	{
 		if (i == 0)
 		{
-			spheres[1]._radius = 4;
-			spheres[1]._radiusSqr = 4 * 4;
+			spheres[0]._radius = 4;
+			spheres[0]._radiusSqr = 4 * 4;
 		}
 		else if (i == 1)
 		{
-			spheres[1]._radius = 3;
-			spheres[1]._radiusSqr = 3 * 3;
+			spheres[0]._radius = 3;
+			spheres[0]._radiusSqr = 3 * 3;
 		}
 		else if (i == 2)
 		{
-			spheres[1]._radius = 2;
-			spheres[1]._radiusSqr = 2 * 2;
+			spheres[0]._radius = 2;
+			spheres[0]._radiusSqr = 2 * 2;
 		}
 		else if (i == 3)
 		{
-			spheres[1]._radius = 1;
-			spheres[1]._radiusSqr = 1 * 1;
+			spheres[0]._radius = 1;
+			spheres[0]._radiusSqr = 1 * 1;
 		}
 
-		Render(config, spheres, i, 4);
+		Render(config, scene, i);
 		// Dont forget to clear the Vector holding the spheres.
 	}
 
 	delete[] spheres;
 	spheres = nullptr;
+	delete floor;
+	floor = nullptr;
 }
 
 void SmoothScaling(const RenderConfig& config)
 {
 	//Create dynamic array for spheres, more efficient than creating vector
-	Sphere* spheres = new Sphere[4];
-
-	spheres[0] = Sphere(Vec3f(0.0, -10004, -20), 10000, Vec3f(0.20, 0.20, 0.20), 0, 0.0);
-	spheres[1] = Sphere(Vec3f(0.0, 0, -20), 0 / 100, Vec3f(1.00, 0.32, 0.36), 1, 0.5); // Radius++ change here
-	spheres[2] = Sphere(Vec3f(5.0, -1, -15), 2, Vec3f(0.90, 0.76, 0.46), 1, 0.0);
-	spheres[3] = Sphere(Vec3f(5.0, 0, -25), 3, Vec3f(0.65, 0.77, 0.97), 1, 0.0);
+	Sphere* spheres = new Sphere[3];
+	Plane* floor = new Plane();
+	Scene scene;
+	CreateDemoScene(spheres, floor, scene);
 
 	for (float r = 0; r <= 100; ++r)
 	{
 		float radius = r / 100;
-		spheres[1]._radius = radius;
-		spheres[1]._radiusSqr = radius * radius;
+		spheres[0]._radius = radius; // Radius++ change here
+		spheres[0]._radiusSqr = radius * radius;
 
-		Render(config, spheres, r, 4);
+		Render(config, scene, r);
 		std::cout << "Rendered and saved spheres" << r << ".ppm" << std::endl;
 	}
 
 	delete[] spheres;
 	spheres = nullptr;
+	delete floor;
+	floor = nullptr;
 }
 
-void RenderFromJSONFile(const JSONSphereInfo& info, const RenderConfig& config) {
+void RenderFromJSONFile(const JSONSphereInfo& info, const RenderConfig& config, RenderManifest* manifest) {
+	//Spheres for the frame being rendered, the starting state in info is never modified
+	Sphere* frameSpheres = new Sphere[info.sphereCount];
+	int skipped = 0;
+
+	//Planes are not animated so they are used straight from the scene info
+	Scene scene;
+	scene.spheres = frameSpheres;
+	scene.sphereCount = info.sphereCount;
+	scene.planes = info.planes.data();
+	scene.planeCount = (int)info.planes.size();
 
 	//Iterate through all the frames
 	for (int i = 0; i < info.frameCount; ++i) {
-		//Iterate through all spheres
-		for (int j = 0; j < info.sphereCount; ++j) {
-			//Change sphere position and surface color
-			info.sphereArr[j]._center += info.sphereMovementsPerFrame[j];
-			info.sphereArr[j]._surfaceColor += info.sphereColorPerFrame[j];
+		//Frames finished by an earlier run are kept as long as their file is unchanged
+		if (manifest != nullptr && manifest->IsFrameComplete(i, FrameFileName(i))) {
+			skipped++;
+			continue;
 		}
 
+		//Evaluate the animation tracks for this frame. Every frame is independent of the previous one
+		//so resuming part way through needs no replay of the earlier frames
+		info.EvaluateFrame(i, frameSpheres);
+		//Emission can be animated so the lights are found again every frame
+		scene.FindLights();
+
 		//Call render function
-		Render(config, info.sphereArr, i, info.sphereCount);
-		std::cout << "Rendered and saved spheres" << i << ".ppm" << std::endl;
+		if (!Render(config, scene, i)) continue;
+		if (manifest != nullptr) manifest->RecordFrame(i, FrameFileName(i));
+		std::cout << "Rendered and saved spheres" << i << ".ppm";
+		if (temporalCache != nullptr) std::cout << " (" << temporalCache->GetReusedShare() * 100.0f << "% of pixels reused)";
+		if (screenTiles != nullptr) std::cout << " (" << screenTiles->GetAverageCandidates() << " spheres per tile)";
+		std::cout << std::endl;
 	}
+
+	if (skipped > 0) {
+		std::cout << "Skipped " << skipped << " frames that were already rendered" << std::endl;
+	}
+
+	delete[] frameSpheres;
+	frameSpheres = nullptr;
+}
+
+//Hands every frame the manifest does not already have to farm workers and writes the frames they send back
+void CoordinateFarm(const JSONSphereInfo& info, const RenderOptions& options, RenderManifest& manifest)
+{
+	FarmCoordinator coordinator(info, options.ToConfig());
+
+	int skipped = 0;
+	for (int i = 0; i < info.frameCount; ++i) {
+		if (manifest.IsFrameComplete(i, FrameFileName(i))) skipped++;
+		else coordinator.AddFrame(i);
+	}
+	if (skipped > 0) {
+		std::cout << "Skipped " << skipped << " frames that were already rendered" << std::endl;
+	}
+
+	coordinator.Run(options.farmPort, [&manifest](int frame, const std::vector<char>& data) {
+		std::string name = FrameFileName(frame);
+		std::ofstream ofs(name, std::ios::out | std::ios::binary);
+		ofs.write(data.data(), data.size());
+		ofs.close();
+		manifest.RecordFrame(frame, name);
+	});
+}
+
+//Renders the frames a farm coordinator asks for. Each frame is written to this worker's own file, sent back and deleted
+void RenderFarmFrames(const JSONSphereInfo& info, const RenderConfig& config, FarmWorker& worker)
+{
+	Sphere* frameSpheres = new Sphere[info.sphereCount];
+
+	Scene scene;
+	scene.spheres = frameSpheres;
+	scene.sphereCount = info.sphereCount;
+	scene.planes = info.planes.data();
+	scene.planeCount = (int)info.planes.size();
+
+	int frame;
+	while ((frame = worker.NextFrame()) >= 0) {
+		info.EvaluateFrame(frame, frameSpheres);
+		scene.FindLights();
+
+		//A frame that cannot be rendered here is given to another worker once this one disconnects
+		if (!Render(config, scene, frame)) break;
+		bool sent = worker.SendFrame(frame, FrameFileName(frame));
+		remove(FrameFileName(frame).c_str());
+		if (!sent) break;
+	}
+
+	delete[] frameSpheres;
+	frameSpheres = nullptr;
+}
+
+//Renders this shard's frames that the assembler does not already have and passes each one through the ring
+void RenderShard(const JSONSphereInfo& info, const RenderConfig& config, FrameRing& ring, int shardIndex, int shardCount)
+{
+	Sphere* frameSpheres = new Sphere[info.sphereCount];
+	char* frameBytes = new char[FrameByteCount(config)];
+
+	Scene scene;
+	scene.spheres = frameSpheres;
+	scene.sphereCount = info.sphereCount;
+	scene.planes = info.planes.data();
+	scene.planeCount = (int)info.planes.size();
+
+	int rendered = 0;
+	for (int i = shardIndex; i < info.frameCount; i += shardCount) {
+		if (ring.IsFrameComplete(i)) continue;
+
+		info.EvaluateFrame(i, frameSpheres);
+		scene.FindLights();
+
+		//Frames that cannot be rendered are reported missing by the assembler
+		if (!Render(config, scene, i, frameBytes)) continue;
+		if (!ring.Push(i, frameBytes, FrameByteCount(config))) break;
+		rendered++;
+	}
+	ring.Finish();
+	std::cout << "Shard " << shardIndex << " of " << shardCount << " rendered " << rendered << " frames" << std::endl;
+
+	delete[] frameBytes;
+	delete[] frameSpheres;
+	frameSpheres = nullptr;
+}
+
+//Drains the frames of every shard from the ring into the frame files
+void AssembleShards(const JSONSphereInfo& info, const RenderConfig& config, RenderManifest& manifest, unsigned long long renderHash, int shardCount)
+{
+	bool* completeFrames = new bool[info.frameCount];
+	int skipped = 0;
+	for (int i = 0; i < info.frameCount; ++i) {
+		completeFrames[i] = manifest.IsFrameComplete(i, FrameFileName(i));
+		if (completeFrames[i]) skipped++;
+	}
+	if (skipped > 0) {
+		std::cout << "Skipped " << skipped << " frames that were already rendered" << std::endl;
+	}
+
+	FrameRing* ring = FrameRing::Create(renderHash, shardCount, info.frameCount, FrameByteCount(config), completeFrames);
+	if (ring != nullptr) {
+		std::cout << "Waiting for " << shardCount << " shards" << std::endl;
+
+		int frame;
+		const char* data;
+		size_t size;
+		while (ring->Pop(frame, data, size)) {
+			std::string name = FrameFileName(frame);
+			std::ofstream ofs(name, std::ios::out | std::ios::binary);
+			ofs.write(data, size);
+			ofs.close();
+			manifest.RecordFrame(frame, name);
+			completeFrames[frame] = true;
+			std::cout << "Assembled spheres" << frame << ".ppm" << std::endl;
+		}
+
+		int missing = 0;
+		for (int i = 0; i < info.frameCount; ++i) {
+			if (!completeFrames[i]) missing++;
+		}
+		if (missing > 0) {
+			std::cout << "[WARNING: main.cpp: " << missing << " frames are missing, run the shards again to render them" << std::endl;
+		}
+
+		delete ring;
+	}
+
+	delete[] completeFrames;
+}
+
+//The manifest and the shard ring are only valid for the same scene file rendered with the same settings. Every
+//setting that changes the pixels is hashed. The ones that only change how they are made (threads, containers,
+//allocator, balance, temporal reuse, screen tiles, ray table, huge pages, budgets) can differ between runs. The
+//one exception is a heap budget so tight that anti aliased frames are rendered in bands shorter than AA_TILE_SIZE
+unsigned long long RenderHash(const RenderOptions& options, const RenderConfig& config)
+{
+	unsigned long long renderHash = RenderManifest::HashFile(options.scenePath);
+	float settings[] = { (float)config.width, (float)config.height, config.fov, (float)config.rayLimits.maxDepth, config.rayLimits.minThroughput, (float)config.rayLimits.russianRoulette,
+		(float)config.mathMode, config.adaptiveAA ? (float)config.aaGridSize : 0.0f, config.aaBudget, config.aaThreshold, config.progressiveBudget,
+		(float)config.shadows };
+	return RenderManifest::Hash(settings, sizeof(settings), renderHash);
+}
+
+//Loads a scene, compiled binary scenes (.rtscene) are memory mapped and their spheres copied out, anything else is
+//parsed as json
+JSONSphereInfo* LoadScene(const std::string& path)
+{
+	const std::string binaryExtension = ".rtscene";
+	if (path.size() > binaryExtension.size() && path.compare(path.size() - binaryExtension.size(), binaryExtension.size(), binaryExtension) == 0) {
+		BinaryScene* scene = BinaryScene::Open(path.c_str());
+		if (scene == nullptr) return nullptr;
+
+		JSONSphereInfo* info = scene->CreateSphereInfo();
+		delete scene;
+		return info;
+	}
+
+	return JSONReader::StreamSphereInfoFromFile(path.c_str());
 }
 
 //[comment]
@@ -504,47 +1579,218 @@ void RenderFromJSONFile(const JSONSphereInfo& info, const RenderConfig& config)
 //[/comment]
 int main(int argc, char** argv)
 {
-	// This sample only allows one choice per program execution. Feel free to improve upon this
 	srand(13);
 
-	RenderConfig config = RenderConfig(640, 480, MAX_THREADS);
+	RenderOptions options;
+	if (!options.ParseCommandLine(argc, argv)) return 1;
+
+	switch (options.command) {
+	case COMMAND_HELP:
+		RenderOptions::PrintUsage();
+		return 0;
+	case COMMAND_CONVERT:
+		return BinaryScene::ConvertFromJSON(options.convertInput.c_str(), options.convertOutput.c_str()) ? 0 : 1;
+	case COMMAND_BENCH_LOAD:
+		Benchmark::SceneLoading(options.benchSphereCounts);
+		return 0;
+	case COMMAND_BENCH_PAGES:
+		Benchmark::PageSizes(options.CreateRenderConfig());
+		return 0;
+	case COMMAND_BENCH_RAYS:
+		Benchmark::RayTables(options.CreateRenderConfig(), options.benchResolutions);
+		return 0;
+	case COMMAND_SELF_TEST:
+		return SelfTest::RunAll() ? 0 : 1;
+	default:
+		break;
+	}
 
 	Timer timer;
 
+	//The scene is loaded first as its config block can change the render settings
+	JSONSphereInfo* info = nullptr;
+	const bool benchmarkTrace = options.command == COMMAND_BENCH_TRACE || options.command == COMMAND_BENCH_MATH || options.command == COMMAND_BENCH_TERMINATION ||
+		options.command == COMMAND_BENCH_LOOPS;
+	const bool sharded = options.command == COMMAND_SHARD || options.command == COMMAND_ASSEMBLE;
+	if (options.command == COMMAND_RENDER_SCENE || options.command == COMMAND_FARM_COORDINATOR || sharded || benchmarkTrace) {
+		info = LoadScene(options.scenePath);
+		if (info == nullptr) return 1;
+		if (!options.ApplySceneConfig(info->config)) return 1;
+	}
+
+	//Workers get the scene and the render settings from the coordinator
+	FarmWorker* farmWorker = nullptr;
+	if (options.command == COMMAND_FARM_WORKER) {
+		farmWorker = new FarmWorker();
+		json farmConfig;
+		info = farmWorker->Join(options.farmHost, options.farmPort, farmConfig);
+		if (info == nullptr || !options.ApplySceneConfig(farmConfig)) {
+			delete farmWorker;
+			return 1;
+		}
+		frameFilePrefix = "./worker" + std::to_string(farmWorker->GetId()) + "_spheres";
+	}
+
+	RenderConfig config = options.CreateRenderConfig();
+	options.Print();
+	if (!options.heapTelemetryPath.empty()) HeapTelemetry::Enable();
+
+	if (benchmarkTrace) {
+		Sphere* spheres = new Sphere[info->sphereCount];
+		info->EvaluateFrame(0, spheres);
+
+		Scene scene;
+		scene.spheres = spheres;
+		scene.sphereCount = info->sphereCount;
+		scene.planes = info->planes.data();
+		scene.planeCount = (int)info->planes.size();
+		scene.FindLights();
+
+		if (options.command == COMMAND_BENCH_TRACE) {
+			Benchmark::TraceThroughput(config, scene, GetTraceFunction(config, scene));
+		}
+		else if (options.command == COMMAND_BENCH_TERMINATION) {
+			Benchmark::RayTermination(config, scene, GetTraceFunction(config, scene));
+		}
+		else if (options.command == COMMAND_BENCH_LOOPS) {
+			Benchmark::RenderLoops(config, scene, RenderSector);
+		}
+		else {
+			TraceFunction traces[MATH_MODE_COUNT];
+			for (int mode = 0; mode < MATH_MODE_COUNT; ++mode) {
+				RenderConfig modeConfig = config;
+				modeConfig.mathMode = (MathMode)mode;
+				traces[mode] = GetTraceFunction(modeConfig, scene);
+			}
+			Benchmark::MathModes(config, scene, traces);
+		}
+
+		delete[] spheres;
+		info->Cleanup();
+		return 0;
+	}
+
 	Heap* chunkHeap = HeapManager::CreateHeap("ChunkHeap");
 	Heap* charHeap = HeapManager::CreateHeap("CharHeap");
 
-#ifdef USE_MEMORY_POOLS
-	//Allocate a memory pool for the four image chunks 
-#ifdef MULTIPLE_CONTAINERS
-	chunkPool = new(chunkHeap) MemoryPool(chunkHeap, MAX_THREADS, config.vec3Size);
-	charPool = new(charHeap) MemoryPool(charHeap, MAX_THREADS, config.charSize);
-#else
-	chunkPool = new(chunkHeap) MemoryPool(chunkHeap, 1, config.vec3Size * MAX_THREADS);
-	charPool = new(charHeap) MemoryPool(charHeap, 1, config.charSize * MAX_THREADS);
-#endif
-#endif
+	for (const std::pair<std::string, long long>& budget : options.heapBudgets) {
+		if (!HeapManager::SetBudget(budget.first, budget.second)) {
+			std::cout << "[ERROR: main.cpp: there is no heap called \"" << budget.first << "\" to budget, use ChunkHeap, CharHeap or DefaultHeap" << std::endl;
+			return 1;
+		}
+	}
 
-	JSONSphereInfo* info = JSONReader::LoadSphereInfoFromFile("Animations/animSample.json");
+	if (config.allocatorMode == ALLOCATOR_POOLS) {
+		//Pools that do not fit the budgets give way to buffers allocated each frame, which can be rendered in bands
+		unsigned long poolCount = config.containerMode == CONTAINERS_MULTIPLE ? config.threadCount : 1;
+		unsigned long chunkBlock = config.containerMode == CONTAINERS_MULTIPLE ? (unsigned long)config.vec3Size : config.singularChunkSize * sizeof(Vec3f);
+		unsigned long charBlock = config.containerMode == CONTAINERS_MULTIPLE ? (unsigned long)config.charSize : config.singularCharSize;
+		if (!chunkHeap->CanAllocate(MemoryPool::GetPoolSize(poolCount, chunkBlock)) || !charHeap->CanAllocate(MemoryPool::GetPoolSize(poolCount, charBlock))) {
+			std::cout << "[WARNING: main.cpp: the frame buffer pools do not fit in the heap budgets, allocating the buffers from the heaps each frame" << std::endl;
+			config.allocatorMode = ALLOCATOR_HEAPS;
+		}
+	}
+
+	//The frame buffers are fitted to the budgets each frame, what else a frame allocates has to fit from the start
+	const Heap& defaultHeap = HeapManager::GetDefaultHeap();
+	if (!defaultHeap.CanAllocate(FrameOverhead(config))) {
+		std::cout << "[ERROR: main.cpp: each frame needs " << FrameOverhead(config) << " bytes of the DefaultHeap besides its buffers, the budget leaves "
+			<< std::max(0ll, defaultHeap.GetAvailable()) << " bytes" << std::endl;
+		return 1;
+	}
 
-	//SmoothScaling(config);
-	//BasicRender(config);
-	//SimpleShrinking(config);
-	RenderFromJSONFile(*info, config);
+	if (config.hugePages && config.allocatorMode != ALLOCATOR_POOLS) {
+		std::cout << "[WARNING: main.cpp: --huge-pages only backs the frame buffer pools, ignoring it without the pools allocator" << std::endl;
+	}
+
+	if (config.allocatorMode == ALLOCATOR_POOLS) {
+		//Allocate a memory pool for the image chunks, one block per worker or one block for the whole frame
+		if (config.containerMode == CONTAINERS_MULTIPLE) {
+			chunkPool = new(chunkHeap) MemoryPool(chunkHeap, config.threadCount, config.vec3Size, config.hugePages);
+			charPool = new(charHeap) MemoryPool(charHeap, config.threadCount, config.charSize, config.hugePages);
+		}
+		else {
+			chunkPool = new(chunkHeap) MemoryPool(chunkHeap, 1, config.singularChunkSize * sizeof(Vec3f), config.hugePages);
+			charPool = new(charHeap) MemoryPool(charHeap, 1, config.singularCharSize, config.hugePages);
+		}
+
+		if (config.hugePages) {
+			if (chunkPool->GetPageKind() == PAGES_DEFAULT || charPool->GetPageKind() == PAGES_DEFAULT) {
+				std::cout << "[WARNING: main.cpp: huge pages are not available, the frame buffer pools use 4KB pages" << std::endl;
+			}
+			else {
+				std::cout << "Frame buffer pools on " << HugePages::GetKindName(chunkPool->GetPageKind()) << std::endl;
+			}
+		}
+	}
+
+	chunkPlanner = new ChunkPlanner(config);
+	if (config.temporalReuse && !defaultHeap.CanAllocate((long long)config.width * config.height * sizeof(PixelHistory) + FrameOverhead(config))) {
+		std::cout << "[WARNING: main.cpp: the temporal cache does not fit in the DefaultHeap budget, tracing every pixel" << std::endl;
+		config.temporalReuse = false;
+	}
+	if (config.temporalReuse) temporalCache = new TemporalCache(config);
+	if (config.screenTiles) screenTiles = new ScreenTiles(config);
+	if (config.rayTable && !defaultHeap.CanAllocate((long long)RayTable::GetSize(config) + FrameOverhead(config))) {
+		std::cout << "[WARNING: main.cpp: the ray table does not fit in the DefaultHeap budget, making the primary rays each frame" << std::endl;
+		config.rayTable = false;
+	}
+	if (config.rayTable) rayTable = new RayTable(config);
+
+	if (options.command == COMMAND_DEMO) {
+		if (options.demoName == "basic") BasicRender(config);
+		else if (options.demoName == "shrinking") SimpleShrinking(config);
+		else if (options.demoName == "smooth") SmoothScaling(config);
+		else std::cout << "[ERROR: main.cpp: unknown demo \"" << options.demoName << "\", use basic, shrinking or smooth" << std::endl;
+	}
+	else if (options.command == COMMAND_FARM_WORKER) {
+		RenderFarmFrames(*info, config, *farmWorker);
+	}
+	else if (options.command == COMMAND_SHARD) {
+		FrameRing* ring = FrameRing::Open(RenderHash(options, config), options.shardIndex, options.shardCount);
+		if (ring != nullptr) {
+			RenderShard(*info, config, *ring, options.shardIndex, options.shardCount);
+			delete ring;
+		}
+	}
+	else {
+		unsigned long long renderHash = RenderHash(options, config);
+		RenderManifest manifest("./render.manifest", renderHash);
+		if (options.restart) manifest.Reset();
+		else if (manifest.Load() > 0) std::cout << "Resuming render, checking frames listed in render.manifest" << std::endl;
+
+		if (options.command == COMMAND_FARM_COORDINATOR) CoordinateFarm(*info, options, manifest);
+		else if (options.command == COMMAND_ASSEMBLE) AssembleShards(*info, config, manifest, renderHash, options.shardCount);
+		else RenderFromJSONFile(*info, config, &manifest);
+	}
 
 	float timeToComplete = timer.Mark();
 	std::cout << "Time to complete: " << timeToComplete << std::endl;
 
-#ifdef USE_MEMORY_POOLS
 	delete chunkPool;
 	chunkPool = nullptr;
 
 	delete charPool;
 	charPool = nullptr;
-#endif
+
+	delete chunkPlanner;
+	chunkPlanner = nullptr;
+
+	delete temporalCache;
+	temporalCache = nullptr;
+	delete screenTiles;
+	screenTiles = nullptr;
+	delete rayTable;
+	rayTable = nullptr;
+
+	delete farmWorker;
+	farmWorker = nullptr;
 
 	//Cleans the animation info
-	info->Cleanup();
+	if (info != nullptr) info->Cleanup();
+
+	if (HeapTelemetry::IsEnabled()) HeapTelemetry::Export(options.heapTelemetryPath);
+	if (!options.heapBudgets.empty()) HeapManager::PrintBudgets();
 
 	//Debugs all heaps
 	std::cout << "\n\n" << "HEAP DUMP" << "\n\n";
@@ -559,4 +1805,4 @@ int main(int argc, char** argv)
 
 	return 0;
 
-}
\ No newline at end of file
+}